@@ -0,0 +1,200 @@
+#include "AssetLoader.h"
+
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "Texture.h"
+#include "Shared.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+enum class ASSET_TYPE
+{
+	MESH,
+	TEXTURE,
+};
+
+// finished work from a loader thread, waiting for the render thread
+struct AssetLoadResult
+{
+	ASSET_TYPE							type					= ASSET_TYPE::MESH;
+	size_t								index					= 0;		// index into the manifest list of this type
+	std::unique_ptr<Mesh>				mesh;
+	std::unique_ptr<TextureData>		texture;
+	double								load_time				= 0.0;
+	size_t								vertices_removed		= 0;
+	size_t								lod_count				= 0;
+	bool								success					= false;
+};
+
+double MillisecondsSince( std::chrono::steady_clock::time_point start_time )
+{
+	return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start_time ).count();
+}
+
+AssetLoader::AssetLoader( Renderer * renderer )
+{
+	assert( nullptr != renderer );
+	_ref_renderer		= renderer;
+}
+
+AssetLoader::~AssetLoader()
+{
+}
+
+void AssetLoader::Load( const AssetManifest & manifest )
+{
+	auto start_time				= std::chrono::steady_clock::now();
+
+	size_t job_count			= manifest.meshes.size() + manifest.textures.size();
+	_timings.clear();
+	_timings.resize( job_count );
+	if( 0 == job_count ) {
+		_total_time				= 0.0;
+		return;
+	}
+
+	// jobs [ 0, mesh count ) are meshes, the rest are textures
+	std::atomic<size_t>			next_job( 0 );
+	std::mutex					results_mutex;
+	std::condition_variable		results_ready;
+	std::deque<AssetLoadResult>	results;
+
+	auto Worker = [ & ]() {
+		for( size_t job = next_job++; job < job_count; job = next_job++ ) {
+			auto job_start_time	= std::chrono::steady_clock::now();
+
+			AssetLoadResult result;
+			if( job < manifest.meshes.size() ) {
+				result.type		= ASSET_TYPE::MESH;
+				result.index	= job;
+				result.mesh		= std::unique_ptr<Mesh>( new Mesh );
+				result.mesh->Load( manifest.meshes[ job ] );
+				result.success	= !result.mesh->vertices.empty() && !result.mesh->triangles.empty();
+				if( result.success && manifest.weld_meshes ) {
+					MeshWeldStatistics weld;
+					result.mesh->WeldVertices( &weld );
+					result.vertices_removed	= weld.vertices_before - weld.vertices_after;
+				}
+				if( result.success && manifest.generate_lods && result.mesh->lods.empty() ) {
+					result.mesh->GenerateLODs( manifest.lod_settings );
+				}
+				if( result.success ) result.lod_count = result.mesh->lods.size();
+			} else {
+				result.type		= ASSET_TYPE::TEXTURE;
+				result.index	= job - manifest.meshes.size();
+				result.texture	= std::unique_ptr<TextureData>( new TextureData );
+				result.success	= LoadTextureData( manifest.textures[ result.index ], *result.texture );
+			}
+			result.load_time	= MillisecondsSince( job_start_time );
+
+			std::lock_guard<std::mutex> lock( results_mutex );
+			results.push_back( std::move( result ) );
+			results_ready.notify_one();
+		}
+	};
+
+	size_t thread_count			= std::max<size_t>( 1, std::min<size_t>( std::thread::hardware_concurrency(), job_count ) );
+	std::vector<std::thread> workers;
+	workers.reserve( thread_count );
+	for( size_t i=0; i < thread_count; ++i ) {
+		workers.emplace_back( Worker );
+	}
+
+	// upload results on this thread as they come in, Vulkan objects are created here only
+	for( size_t finished = 0; finished < job_count; ++finished ) {
+		AssetLoadResult result;
+		{
+			std::unique_lock<std::mutex> lock( results_mutex );
+			results_ready.wait( lock, [ &results ]() { return !results.empty(); } );
+			result = std::move( results.front() );
+			results.pop_front();
+		}
+
+		if( ASSET_TYPE::MESH == result.type ) {
+			auto & path					= manifest.meshes[ result.index ];
+			auto & timing				= _timings[ result.index ];
+			timing.name					= path;
+			timing.load_time			= result.load_time;
+			timing.vertices_removed		= result.vertices_removed;
+			timing.lod_count			= result.lod_count;
+			timing.success				= result.success;
+			if( result.success ) {
+				_meshes[ path ]			= std::move( result.mesh );
+			}
+		} else {
+			auto & path					= manifest.textures[ result.index ];
+			auto & timing				= _timings[ manifest.meshes.size() + result.index ];
+			timing.name					= std::string( path.begin(), path.end() );		// only used for printing
+			timing.load_time			= result.load_time;
+			timing.success				= result.success;
+			if( result.success ) {
+				auto upload_start_time	= std::chrono::steady_clock::now();
+				_textures[ path ]		= std::unique_ptr<Texture>( new Texture( _ref_renderer, *result.texture ) );
+				timing.upload_time		= MillisecondsSince( upload_start_time );
+			} else {
+				std::cout << "Couldn't load image: " << timing.name << std::endl;
+			}
+		}
+	}
+
+	for( auto & w : workers ) {
+		w.join();
+	}
+	_total_time					= MillisecondsSince( start_time );
+}
+
+std::unique_ptr<Mesh> AssetLoader::TakeMesh( std::string path )
+{
+	auto it = _meshes.find( path );
+	if( it == _meshes.end() ) {
+		std::cout << "Mesh not loaded: " << path << std::endl;
+		return nullptr;
+	}
+	auto mesh = std::move( it->second );
+	_meshes.erase( it );
+	return mesh;
+}
+
+Texture * AssetLoader::GetTexture( std::wstring path )
+{
+	auto it = _textures.find( path );
+	if( it != _textures.end() ) return it->second.get();
+
+	// surfaces always need an image to bind, a missing one shows up as plain white instead of a crash
+	std::cout << "Texture not loaded: " << std::string( path.begin(), path.end() ) << std::endl;
+	if( nullptr == _fallback_texture ) {
+		TextureData data;
+		MakeWhiteTextureData( data );
+		_fallback_texture	= std::unique_ptr<Texture>( new Texture( _ref_renderer, data ) );
+	}
+	return _fallback_texture.get();
+}
+
+const std::vector<AssetLoadTiming> & AssetLoader::GetTimings() const
+{
+	return _timings;
+}
+
+double AssetLoader::GetTotalTime() const
+{
+	return _total_time;
+}
+
+void AssetLoader::PrintTimings( std::ostream & stream ) const
+{
+	for( auto & t : _timings ) {
+		stream << "  " << t.name << ": load " << t.load_time << " ms, upload " << t.upload_time << " ms";
+		if( t.vertices_removed ) stream << ", welded " << t.vertices_removed << " vertices";
+		if( t.lod_count ) stream << ", " << t.lod_count << " levels of detail";
+		if( !t.success ) stream << " (FAILED)";
+		stream << std::endl;
+	}
+	stream << "Asset load time: " << _total_time << " ms" << std::endl;
+}
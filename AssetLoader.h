@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Platform.h"
+#include "MeshSimplifier.h"
+
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class Renderer;
+class Mesh;
+class Texture;
+
+// list of files to load in one batch
+struct AssetManifest
+{
+	std::vector<std::string>			meshes;
+	std::vector<std::wstring>			textures;
+	bool								weld_meshes				= false;	// merge identical vertices of meshes after loading
+	bool								generate_lods			= false;	// simplified levels of detail for meshes that don't have them yet
+	MeshLODSettings						lod_settings;
+};
+
+struct AssetLoadTiming
+{
+	std::string							name;
+	double								load_time				= 0.0;		// file I/O and decoding on a worker thread, in milliseconds
+	double								upload_time				= 0.0;		// GPU upload on the render thread, in milliseconds
+	size_t								vertices_removed		= 0;		// by welding
+	size_t								lod_count				= 0;		// levels of detail after the full detail mesh
+	bool								success					= false;
+};
+
+// Loads a batch of assets in parallel.
+// File I/O, ME3D parsing and image decoding are done on a pool of worker threads, finished
+// CPU side data is handed back to the calling thread which uploads it while the workers
+// keep on decoding the rest. Meshes stay on the CPU, they get their GPU buffers when
+// a scene object is created from them.
+class AssetLoader
+{
+public:
+	AssetLoader( Renderer * renderer );
+	~AssetLoader();
+
+	// blocks until every asset in the manifest has been loaded, call from the render thread
+	void								Load( const AssetManifest & manifest );
+
+	std::unique_ptr<Mesh>				TakeMesh( std::string path );			// ownership moves to the caller, reports and returns nullptr if not loaded
+	Texture							*	GetTexture( std::wstring path );		// owned by the loader, reports and returns a white 1x1 texture if not loaded
+
+	const std::vector<AssetLoadTiming>&	GetTimings() const;
+	double								GetTotalTime() const;					// wall clock time of the last Load() in milliseconds
+	void								PrintTimings( std::ostream & stream ) const;
+
+private:
+	Renderer						*	_ref_renderer			= nullptr;
+
+	std::map<std::string, std::unique_ptr<Mesh>>		_meshes;
+	std::map<std::wstring, std::unique_ptr<Texture>>	_textures;
+	std::unique_ptr<Texture>							_fallback_texture;		// created when first needed
+
+	std::vector<AssetLoadTiming>		_timings;
+	double								_total_time				= 0.0;
+};
@@ -0,0 +1,98 @@
+#include "BufferAllocator.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <iterator>
+
+BufferAllocator::BufferAllocator( uint64_t capacity )
+{
+	Grow( capacity );
+}
+
+BufferAllocator::~BufferAllocator()
+{
+}
+
+bool BufferAllocator::Allocate( uint64_t size, uint64_t alignment, uint64_t * offset )
+{
+	assert( nullptr != offset );
+	assert( alignment > 0 );
+	if( 0 == size ) {
+		*offset		= 0;
+		return true;
+	}
+
+	for( auto it = _free_ranges.begin(); it != _free_ranges.end(); ++it ) {
+		uint64_t range_offset	= it->first;
+		uint64_t range_end		= it->first + it->second;
+		uint64_t aligned		= ( range_offset + alignment - 1 ) / alignment * alignment;
+		if( aligned + size > range_end ) continue;
+
+		// whatever the alignment skipped stays free in front, the rest after
+		_free_ranges.erase( it );
+		if( aligned > range_offset ) _free_ranges[ range_offset ] = aligned - range_offset;
+		if( aligned + size < range_end ) _free_ranges[ aligned + size ] = range_end - aligned - size;
+
+		_used_size		+= size;
+		*offset			= aligned;
+		return true;
+	}
+	return false;
+}
+
+void BufferAllocator::Free( uint64_t offset, uint64_t size )
+{
+	if( 0 == size ) return;
+	assert( offset + size <= _capacity );
+	assert( _used_size >= size );
+	_used_size			-= size;
+	_AddFreeRange( offset, size );
+}
+
+void BufferAllocator::Grow( uint64_t new_capacity )
+{
+	assert( new_capacity >= _capacity );
+	if( new_capacity == _capacity ) return;
+	uint64_t old_capacity	= _capacity;
+	_capacity				= new_capacity;
+	_AddFreeRange( old_capacity, new_capacity - old_capacity );
+}
+
+uint64_t BufferAllocator::GetCapacity() const
+{
+	return _capacity;
+}
+
+uint64_t BufferAllocator::GetUsedSize() const
+{
+	return _used_size;
+}
+
+uint64_t BufferAllocator::GetLargestFreeRange() const
+{
+	uint64_t largest = 0;
+	for( auto & r : _free_ranges ) largest = std::max( largest, r.second );
+	return largest;
+}
+
+void BufferAllocator::_AddFreeRange( uint64_t offset, uint64_t size )
+{
+	auto next = _free_ranges.lower_bound( offset );
+	assert( next == _free_ranges.end() || next->first >= offset + size );
+
+	// merge with the range right after
+	if( next != _free_ranges.end() && next->first == offset + size ) {
+		size			+= next->second;
+		next			= _free_ranges.erase( next );
+	}
+	// and the one right before
+	if( next != _free_ranges.begin() ) {
+		auto previous	= std::prev( next );
+		assert( previous->first + previous->second <= offset );
+		if( previous->first + previous->second == offset ) {
+			previous->second	+= size;
+			return;
+		}
+	}
+	_free_ranges[ offset ] = size;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+// Free-list sub-allocator handing out ranges of one big buffer. Only does the bookkeeping,
+// the buffer itself belongs to the user. First fit, neighbouring free ranges are merged on free.
+class BufferAllocator
+{
+public:
+	BufferAllocator( uint64_t capacity = 0 );
+	~BufferAllocator();
+
+	// offset is a multiple of alignment, which doesn't need to be a power of two ( eg. vertex strides ).
+	// Returns false if no free range is large enough.
+	bool								Allocate( uint64_t size, uint64_t alignment, uint64_t * offset );
+	void								Free( uint64_t offset, uint64_t size );
+
+	// adds free space to the end, existing allocations keep their offsets
+	void								Grow( uint64_t new_capacity );
+
+	uint64_t							GetCapacity() const;
+	uint64_t							GetUsedSize() const;
+	uint64_t							GetLargestFreeRange() const;
+
+private:
+	void								_AddFreeRange( uint64_t offset, uint64_t size );
+
+	std::map<uint64_t, uint64_t>		_free_ranges;			// offset, size
+	uint64_t							_capacity				= 0;
+	uint64_t							_used_size				= 0;
+};
@@ -0,0 +1,156 @@
+#include "CommandLineTools.h"
+
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "ME3DFile.h"
+#include "ME3DDecode.h"
+#include "ME3DBenchmark.h"
+#include "TransformBenchmark.h"
+#include "VertexLayout.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+constexpr uint32_t COOK_BENCHMARK_ITERATIONS			= 10;
+constexpr uint64_t ME3D_BENCHMARK_MAX_TRIANGLES			= 50000000;
+
+// average wall clock time of Mesh::Load in milliseconds
+double MeasureMeshLoadTime( std::string path, uint32_t iterations )
+{
+	namespace chrono	= std::chrono;
+	auto start_time		= chrono::steady_clock::now();
+	for( uint32_t i=0; i < iterations; ++i ) {
+		Mesh mesh;
+		mesh.Load( path );
+	}
+	return chrono::duration<double, std::milli>( chrono::steady_clock::now() - start_time ).count() / iterations;
+}
+
+int RunCookTool( std::string input_path, std::string output_path, bool optimize, bool generate_lods, VERTEX_LAYOUT vertex_layout )
+{
+	Mesh mesh;
+	mesh.Load( input_path );
+	if( mesh.vertices.empty() || mesh.triangles.empty() ) {
+		std::cout << "Couldn't load mesh: " << input_path << std::endl;
+		return 1;
+	}
+	if( optimize ) {
+		MeshWeldStatistics weld;
+		mesh.WeldVertices( &weld );
+		std::cout << "Welded vertices: " << weld.vertices_before << " -> " << weld.vertices_after << std::endl;
+
+		MeshOptimizationReport report;
+		mesh.Optimize( &report );
+		report.Print( std::cout );
+	}
+	if( generate_lods ) {
+		mesh.GenerateLODs( MeshLODSettings() );
+		for( auto & lod : mesh.lods ) {
+			std::cout << "LOD: " << lod.triangles.size() << " triangles, error " << lod.error << std::endl;
+		}
+	}
+	if( !mesh.SaveCooked( output_path, vertex_layout ) ) {
+		std::cout << "Couldn't save cooked mesh: " << output_path << std::endl;
+		return 1;
+	}
+	std::cout << "Cooked " << input_path << " -> " << output_path
+		<< " ( " << mesh.vertices.size() << " vertices, " << mesh.triangles.size() << " triangles, " << VertexLayout_GetName( vertex_layout ) << " )" << std::endl;
+
+	// see how much we gained, first loads warm up the file cache for both
+	MeasureMeshLoadTime( input_path, 1 );
+	MeasureMeshLoadTime( output_path, 1 );
+	double raw_time		= MeasureMeshLoadTime( input_path, COOK_BENCHMARK_ITERATIONS );
+	double cooked_time	= MeasureMeshLoadTime( output_path, COOK_BENCHMARK_ITERATIONS );
+	std::cout << "Raw load time: " << raw_time << " ms" << std::endl;
+	std::cout << "Cooked load time: " << cooked_time << " ms" << std::endl;
+	return 0;
+}
+
+int RunCompressTool( std::string input_path, std::string output_path )
+{
+	ME3D_File file( input_path );
+	if( !file.IsLoaded() ) {
+		std::cout << "Couldn't load ME3D file: " << input_path << std::endl;
+		return 1;
+	}
+	if( !file.Save( output_path ) ) {
+		std::cout << "Couldn't save ME3D file: " << output_path << std::endl;
+		return 1;
+	}
+	std::cout << "Compressed " << input_path << " -> " << output_path << std::endl;
+	return 0;
+}
+
+int RunME3DBenchmarkTool( std::string directory, uint64_t max_triangles )
+{
+	int failures = RunME3DBenchmark( directory, max_triangles, std::cout );
+	if( failures ) {
+		std::cout << "# " << failures << " benchmark loads failed" << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+int RunTransformBenchmarkTool()
+{
+	int failures = RunTransformBenchmark( std::cout );
+	if( failures ) {
+		std::cout << "# " << failures << " sizes had mismatching matrices" << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+int RunME3DDecodeCheckTool( const std::vector<std::string> & paths )
+{
+	int failures = RunME3DDecodeCheck( paths, std::cout );
+	if( failures ) {
+		std::cout << "# " << failures << " decode checks failed" << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+bool RunCommandLineTool( int argc, char ** argv, int * exit_code )
+{
+	if( argc < 2 ) return false;
+
+	std::string tool = argv[ 1 ];
+	if( tool == "--cook" && argc >= 4 ) {
+		bool optimize		= false;
+		bool generate_lods	= false;
+		auto vertex_layout	= VERTEX_LAYOUT::COMPACT_SNORM16;		// what the renderer draws loaded models with
+		for( int i=4; i < argc; ++i ) {
+			std::string option = argv[ i ];
+			if( option == "--optimize" )	optimize		= true;
+			else if( option == "--lods" )	generate_lods	= true;
+			else if( option == "--layout" && i + 1 < argc ) {
+				if( !VertexLayout_FromName( argv[ ++i ], &vertex_layout ) ) return false;
+			}
+			else return false;
+		}
+		*exit_code = RunCookTool( argv[ 2 ], argv[ 3 ], optimize, generate_lods, vertex_layout );
+		return true;
+	}
+	if( tool == "--compress" && argc == 4 ) {
+		*exit_code = RunCompressTool( argv[ 2 ], argv[ 3 ] );
+		return true;
+	}
+	if( tool == "--benchmark-me3d" && ( argc == 3 || argc == 4 ) ) {
+		uint64_t max_triangles = argc == 4 ? std::stoull( argv[ 3 ] ) : ME3D_BENCHMARK_MAX_TRIANGLES;
+		*exit_code = RunME3DBenchmarkTool( argv[ 2 ], max_triangles );
+		return true;
+	}
+	if( tool == "--benchmark-transforms" && argc == 2 ) {
+		*exit_code = RunTransformBenchmarkTool();
+		return true;
+	}
+	if( tool == "--check-me3d-decode" ) {
+		*exit_code = RunME3DDecodeCheckTool( std::vector<std::string>( argv + 2, argv + argc ) );
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+// Offline tools that run instead of the renderer when requested on the command line:
+//
+// --cook <input.me3d> <output.me3d> [--optimize] [--lods] [--layout <float32|compact_half|compact_snorm16>]
+//											Writes vertices, indices and clusters exactly as GPUMesh
+//											uploads them for the layout, compact_snorm16 by default,
+//											and compares raw and cooked load times. --optimize welds
+//											identical vertices and reorders them for the vertex cache
+//											and overdraw first. --lods stores simplified levels of
+//											detail with the mesh.
+// --compress <input.me3d> <output.me3d>	Rewrites a model as a compressed ME3D version 2 file.
+// --benchmark-me3d <directory> [max triangles]
+//											Generates synthetic ME3D files into directory and prints
+//											their load times as CSV, see ME3DBenchmark.h.
+// --benchmark-transforms					Compares per object and batched matrix calculation for
+//											1K, 10K and 100K objects as CSV, see TransformBenchmark.h.
+// --check-me3d-decode [model.me3d ...]		Checks that the SIMD and threaded vertex decoders give the
+//											same bits as the scalar one on synthetic data and on the
+//											given version 1 models, see ME3DDecode.h.
+
+// returns true if a tool was requested, exit_code receives the result of the tool
+bool RunCommandLineTool( int argc, char ** argv, int * exit_code );
@@ -0,0 +1,184 @@
+#include "FrustumCulling.h"
+
+#include <assert.h>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define FRUSTUM_CULLING_SSE2	1
+#include <emmintrin.h>
+#else
+#define FRUSTUM_CULLING_SSE2	0
+#endif
+
+#if FRUSTUM_CULLING_SSE2 && defined( __AVX__ )
+#define FRUSTUM_CULLING_AVX		1
+#include <immintrin.h>
+#else
+#define FRUSTUM_CULLING_AVX		0
+#endif
+
+Frustum Frustum_FromMatrix( const glm::mat4 & view_projection )
+{
+	// straight from the clip matrix rows, depth goes from 0 to 1
+	auto & m = view_projection;
+	glm::vec4 rows[ 4 ];
+	for( int r=0; r < 4; ++r ) {
+		rows[ r ] = glm::vec4( m[ 0 ][ r ], m[ 1 ][ r ], m[ 2 ][ r ], m[ 3 ][ r ] );
+	}
+	Frustum frustum;
+	frustum.planes[ 0 ]	= rows[ 3 ] + rows[ 0 ];
+	frustum.planes[ 1 ]	= rows[ 3 ] - rows[ 0 ];
+	frustum.planes[ 2 ]	= rows[ 3 ] + rows[ 1 ];
+	frustum.planes[ 3 ]	= rows[ 3 ] - rows[ 1 ];
+	frustum.planes[ 4 ]	= rows[ 2 ];
+	frustum.planes[ 5 ]	= rows[ 3 ] - rows[ 2 ];
+	for( auto & p : frustum.planes ) {
+		p /= glm::length( glm::vec3( p ) );
+	}
+	return frustum;
+}
+
+size_t BoundingSphereBatch::GetCount() const
+{
+	return radius.size();
+}
+
+void BoundingSphereBatch::Clear()
+{
+	for( auto & c : center ) c.clear();
+	radius.clear();
+}
+
+void BoundingSphereBatch::Add( const glm::vec3 & center, float radius )
+{
+	for( int c=0; c < 3; ++c ) {
+		this->center[ c ].push_back( center[ c ] );
+	}
+	this->radius.push_back( radius );
+}
+
+// One float per sphere, the kernel is written once against these and runs at every width.
+// LessMask has bit n set when lane n of a is less than lane n of b.
+struct CullLanes1
+{
+	static constexpr size_t			WIDTH			= 1;
+	float							v;
+
+	static CullLanes1				Load( const float * src )	{ return { *src }; }
+	static CullLanes1				Splat( float value )		{ return { value }; }
+	static uint32_t					LessMask( CullLanes1 a, CullLanes1 b )	{ return a.v < b.v ? 1 : 0; }
+};
+inline CullLanes1 operator+( CullLanes1 a, CullLanes1 b ) { return { a.v + b.v }; }
+inline CullLanes1 operator-( CullLanes1 a, CullLanes1 b ) { return { a.v - b.v }; }
+inline CullLanes1 operator*( CullLanes1 a, CullLanes1 b ) { return { a.v * b.v }; }
+
+#if FRUSTUM_CULLING_SSE2
+
+struct CullLanes4
+{
+	static constexpr size_t			WIDTH			= 4;
+	__m128							v;
+
+	static CullLanes4				Load( const float * src )	{ return { _mm_loadu_ps( src ) }; }
+	static CullLanes4				Splat( float value )		{ return { _mm_set1_ps( value ) }; }
+	static uint32_t					LessMask( CullLanes4 a, CullLanes4 b )	{ return uint32_t( _mm_movemask_ps( _mm_cmplt_ps( a.v, b.v ) ) ); }
+};
+inline CullLanes4 operator+( CullLanes4 a, CullLanes4 b ) { return { _mm_add_ps( a.v, b.v ) }; }
+inline CullLanes4 operator-( CullLanes4 a, CullLanes4 b ) { return { _mm_sub_ps( a.v, b.v ) }; }
+inline CullLanes4 operator*( CullLanes4 a, CullLanes4 b ) { return { _mm_mul_ps( a.v, b.v ) }; }
+
+#endif // FRUSTUM_CULLING_SSE2
+
+#if FRUSTUM_CULLING_AVX
+
+struct CullLanes8
+{
+	static constexpr size_t			WIDTH			= 8;
+	__m256							v;
+
+	static CullLanes8				Load( const float * src )	{ return { _mm256_loadu_ps( src ) }; }
+	static CullLanes8				Splat( float value )		{ return { _mm256_set1_ps( value ) }; }
+	static uint32_t					LessMask( CullLanes8 a, CullLanes8 b )	{ return uint32_t( _mm256_movemask_ps( _mm256_cmp_ps( a.v, b.v, _CMP_LT_OQ ) ) ); }
+};
+inline CullLanes8 operator+( CullLanes8 a, CullLanes8 b ) { return { _mm256_add_ps( a.v, b.v ) }; }
+inline CullLanes8 operator-( CullLanes8 a, CullLanes8 b ) { return { _mm256_sub_ps( a.v, b.v ) }; }
+inline CullLanes8 operator*( CullLanes8 a, CullLanes8 b ) { return { _mm256_mul_ps( a.v, b.v ) }; }
+
+#endif // FRUSTUM_CULLING_AVX
+
+// Culls as many whole batches of Lanes::WIDTH spheres as fit in [ begin, end ), returns where it stopped
+// and adds the visible ones to visible_count. Every plane is tested, branching per lane costs more than the planes.
+template<typename Lanes>
+size_t Frustum_CullSpheresRange( const Frustum & frustum, const BoundingSphereBatch & spheres, size_t begin, size_t end,
+	const FrustumCullSizeCutoff & size_cutoff, FRUSTUM_CULL_RESULT * results, size_t * visible_count )
+{
+	Lanes planes[ 6 ][ 4 ];
+	for( int p=0; p < 6; ++p ) {
+		for( int c=0; c < 4; ++c ) {
+			planes[ p ][ c ]	= Lanes::Splat( frustum.planes[ p ][ c ] );
+		}
+	}
+	// compared squared so there's no square root, diameter * pixel_scale < min_projected_size * distance
+	bool size_culling		= size_cutoff.min_projected_size > 0.0f;
+	const Lanes zero		= Lanes::Splat( 0.0f );
+	const Lanes camera[ 3 ]	= {
+		Lanes::Splat( size_cutoff.camera_position.x ),
+		Lanes::Splat( size_cutoff.camera_position.y ),
+		Lanes::Splat( size_cutoff.camera_position.z ) };
+	const Lanes diameter_scale	= Lanes::Splat( 2.0f * size_cutoff.pixel_scale );
+	const Lanes min_size		= Lanes::Splat( size_cutoff.min_projected_size );
+
+	size_t i = begin;
+	for( ; i + Lanes::WIDTH <= end; i += Lanes::WIDTH ) {
+		Lanes x				= Lanes::Load( spheres.center[ 0 ].data() + i );
+		Lanes y				= Lanes::Load( spheres.center[ 1 ].data() + i );
+		Lanes z				= Lanes::Load( spheres.center[ 2 ].data() + i );
+		Lanes radius		= Lanes::Load( spheres.radius.data() + i );
+		Lanes negative_radius	= zero - radius;
+
+		uint32_t outside	= 0;
+		for( int p=0; p < 6; ++p ) {
+			Lanes distance	= planes[ p ][ 0 ] * x + planes[ p ][ 1 ] * y + planes[ p ][ 2 ] * z + planes[ p ][ 3 ];
+			outside			|= Lanes::LessMask( distance, negative_radius );
+		}
+
+		uint32_t too_small	= 0;
+		if( size_culling ) {
+			Lanes dx		= x - camera[ 0 ];
+			Lanes dy		= y - camera[ 1 ];
+			Lanes dz		= z - camera[ 2 ];
+			Lanes size		= radius * diameter_scale;
+			Lanes min		= min_size * min_size * ( dx * dx + dy * dy + dz * dz );
+			too_small		= Lanes::LessMask( size * size, min );
+		}
+
+		for( size_t l=0; l < Lanes::WIDTH; ++l ) {
+			FRUSTUM_CULL_RESULT result	= FRUSTUM_CULL_RESULT::VISIBLE;
+			if( outside & ( 1u << l ) ) {
+				result		= FRUSTUM_CULL_RESULT::OUTSIDE;
+			} else if( too_small & ( 1u << l ) ) {
+				result		= FRUSTUM_CULL_RESULT::TOO_SMALL;
+			} else {
+				++*visible_count;
+			}
+			results[ i + l ]	= result;
+		}
+	}
+	return i;
+}
+
+size_t Frustum_CullSpheres( const Frustum & frustum, const BoundingSphereBatch & spheres,
+	const FrustumCullSizeCutoff & size_cutoff, FRUSTUM_CULL_RESULT * results )
+{
+	assert( nullptr != results || 0 == spheres.GetCount() );
+	size_t end				= spheres.GetCount();
+	size_t visible_count	= 0;
+	size_t i				= 0;
+#if FRUSTUM_CULLING_AVX
+	i = Frustum_CullSpheresRange<CullLanes8>( frustum, spheres, i, end, size_cutoff, results, &visible_count );
+#endif
+#if FRUSTUM_CULLING_SSE2
+	i = Frustum_CullSpheresRange<CullLanes4>( frustum, spheres, i, end, size_cutoff, results, &visible_count );
+#endif
+	Frustum_CullSpheresRange<CullLanes1>( frustum, spheres, i, end, size_cutoff, results, &visible_count );
+	return visible_count;
+}
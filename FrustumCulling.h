@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Platform.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Planes of a view projection matrix's frustum, normalized and facing inwards. Points in front of
+// every plane are inside. Depth goes from 0 to 1 like the projection matrices of SceneObject_Camera.
+struct Frustum
+{
+	glm::vec4						planes[ 6 ];
+};
+
+// planes are in whatever space the matrix transforms from, eg. mesh space for a model view projection matrix
+Frustum Frustum_FromMatrix( const glm::mat4 & view_projection );
+
+// Bounding spheres of many objects as structure of arrays, so the culling kernel
+// can test 4 or 8 of them against a plane at once.
+struct BoundingSphereBatch
+{
+	std::vector<float>				center[ 3 ];
+	std::vector<float>				radius;
+
+	size_t							GetCount() const;
+	void							Clear();
+	void							Add( const glm::vec3 & center, float radius );
+};
+
+enum class FRUSTUM_CULL_RESULT : uint8_t
+{
+	VISIBLE,
+	OUTSIDE,						// entirely behind one of the planes
+	TOO_SMALL,						// inside, but smaller on screen than the minimum projected size
+};
+
+// Optional cutoff for objects too small to matter, nothing is culled for being small while min_projected_size is 0.
+struct FrustumCullSizeCutoff
+{
+	glm::vec3						camera_position					= glm::vec3( 0.0f );
+	float							pixel_scale						= 0.0f;			// see SceneObject_Camera::CalculateProjectedPixelScale()
+	float							min_projected_size				= 0.0f;			// diameter in pixels
+};
+
+// Writes a FRUSTUM_CULL_RESULT for each of the spheres to results and returns how many are visible.
+// The projected size is the sphere diameter over its center's distance from the camera. Runs 8 spheres
+// at a time with AVX, 4 with SSE2 and the rest one at a time, see TransformBatch for the same setup.
+size_t Frustum_CullSpheres( const Frustum & frustum, const BoundingSphereBatch & spheres,
+	const FrustumCullSizeCutoff & size_cutoff, FRUSTUM_CULL_RESULT * results );
@@ -0,0 +1,175 @@
+#include "GPUCulling.h"
+
+#include "Shared.h"
+#include "Renderer.h"
+#include "FrustumCulling.h"
+
+#include <array>
+#include <fstream>
+#include <vector>
+
+GPUCulling::GPUCulling( Renderer * renderer )
+{
+	assert( nullptr != renderer );
+	_ref_renderer		= renderer;
+
+#if defined( VK_KHR_draw_indirect_count )
+	if( _ref_renderer->IsDeviceExtensionEnabled( VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME ) ) {
+		_draw_indexed_indirect_count = vkGetDeviceProcAddr( _ref_renderer->GetVulkanDevice(), "vkCmdDrawIndexedIndirectCountKHR" );
+	}
+#endif
+
+	_InitPipeline();
+	_descriptor_set		= _ref_renderer->AllocateDescriptorSet( DESCRIPTOR_SET_TYPE::CULLING );
+}
+
+GPUCulling::~GPUCulling()
+{
+	_ref_renderer->FreeDescriptorSet( _descriptor_set );
+	_DeInitPipeline();
+}
+
+bool GPUCulling::CanCompact() const
+{
+	return nullptr != _draw_indexed_indirect_count;
+}
+
+void GPUCulling::CmdCull( VkCommandBuffer command_buffer, const GPUCullingBuffers & buffers, uint32_t object_count, uint32_t group_count, const glm::mat4 & view_projection, bool compact )
+{
+	assert( !compact || CanCompact() );
+	if( 0 == object_count ) return;
+
+	_UpdateDescriptorSet( buffers );
+
+	if( compact ) {
+		vkCmdFillBuffer( command_buffer, buffers.draw_counts, 0, group_count * sizeof( uint32_t ), 0 );
+
+		VkMemoryBarrier memory_barrier {};
+		memory_barrier.sType			= VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memory_barrier.srcAccessMask	= VK_ACCESS_TRANSFER_WRITE_BIT;
+		memory_barrier.dstAccessMask	= VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier( command_buffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0,
+			1, &memory_barrier,
+			0, nullptr,
+			0, nullptr );
+	}
+
+	// frustum planes in world space
+	PushConstants_Cull push_constants {};
+	auto frustum						= Frustum_FromMatrix( view_projection );
+	for( int p=0; p < 6; ++p ) {
+		push_constants.Frustum_Planes[ p ]	= frustum.planes[ p ];
+	}
+	push_constants.Object_Count			= object_count;
+	push_constants.Compact				= compact ? 1 : 0;
+
+	vkCmdBindPipeline( command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline );
+	vkCmdBindDescriptorSets( command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline_layout, 0, 1, &_descriptor_set, 0, nullptr );
+	vkCmdPushConstants( command_buffer, _pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( push_constants ), &push_constants );
+	vkCmdDispatch( command_buffer, ( object_count + GPU_CULLING_WORKGROUP_SIZE - 1 ) / GPU_CULLING_WORKGROUP_SIZE, 1, 1 );
+
+	// culled commands and draw counts are read by the indirect draws that follow
+	VkMemoryBarrier memory_barrier {};
+	memory_barrier.sType			= VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memory_barrier.srcAccessMask	= VK_ACCESS_SHADER_WRITE_BIT;
+	memory_barrier.dstAccessMask	= VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	vkCmdPipelineBarrier( command_buffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+		0,
+		1, &memory_barrier,
+		0, nullptr,
+		0, nullptr );
+}
+
+void GPUCulling::CmdDrawIndexedIndirectCount( VkCommandBuffer command_buffer, VkBuffer buffer, VkDeviceSize offset, VkBuffer count_buffer, VkDeviceSize count_offset, uint32_t max_draw_count, uint32_t stride )
+{
+	assert( CanCompact() );
+#if defined( VK_KHR_draw_indirect_count )
+	reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>( _draw_indexed_indirect_count )( command_buffer, buffer, offset, count_buffer, count_offset, max_draw_count, stride );
+#endif
+}
+
+void GPUCulling::_InitPipeline()
+{
+	auto device = _ref_renderer->GetVulkanDevice();
+	{
+		std::ifstream file( "shaders/cull.comp.spv", std::ifstream::binary | std::ifstream::ate );
+		assert( file.is_open() );
+
+		size_t file_size = file.tellg();
+		std::vector<char> file_data( file_size );
+		file.seekg( 0 );
+		file.read( file_data.data(), file_size );
+
+		VkShaderModuleCreateInfo shader_module_create_info {};
+		shader_module_create_info.sType			= VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		shader_module_create_info.codeSize		= file_data.size();
+		shader_module_create_info.pCode			= reinterpret_cast<uint32_t*>( file_data.data() );
+
+		ErrorCheck( vkCreateShaderModule( device, &shader_module_create_info, nullptr, &_shader_module ) );
+	}
+
+	std::array<VkDescriptorSetLayout, 1> descriptor_set_layouts { _ref_renderer->GetVulkanCullingDescriptorSetLayout() };
+
+	std::array<VkPushConstantRange, 1> push_constant_ranges {};
+	push_constant_ranges[ 0 ].stageFlags	= VK_SHADER_STAGE_COMPUTE_BIT;
+	push_constant_ranges[ 0 ].offset		= 0;
+	push_constant_ranges[ 0 ].size			= sizeof( PushConstants_Cull );
+
+	VkPipelineLayoutCreateInfo pipeline_layout_create_info {};
+	pipeline_layout_create_info.sType					= VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipeline_layout_create_info.setLayoutCount			= uint32_t( descriptor_set_layouts.size() );
+	pipeline_layout_create_info.pSetLayouts				= descriptor_set_layouts.data();
+	pipeline_layout_create_info.pushConstantRangeCount	= uint32_t( push_constant_ranges.size() );
+	pipeline_layout_create_info.pPushConstantRanges		= push_constant_ranges.data();
+	ErrorCheck( vkCreatePipelineLayout( device, &pipeline_layout_create_info, nullptr, &_pipeline_layout ) );
+
+	VkComputePipelineCreateInfo pipeline_create_info {};
+	pipeline_create_info.sType					= VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipeline_create_info.stage.sType			= VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipeline_create_info.stage.stage			= VK_SHADER_STAGE_COMPUTE_BIT;
+	pipeline_create_info.stage.module			= _shader_module;
+	pipeline_create_info.stage.pName			= "main";
+	pipeline_create_info.layout					= _pipeline_layout;
+	pipeline_create_info.basePipelineHandle		= VK_NULL_HANDLE;
+	pipeline_create_info.basePipelineIndex		= -1;
+	ErrorCheck( vkCreateComputePipelines( device, VK_NULL_HANDLE, 1, &pipeline_create_info, nullptr, &_pipeline ) );
+}
+
+void GPUCulling::_DeInitPipeline()
+{
+	auto device = _ref_renderer->GetVulkanDevice();
+	vkDestroyPipeline( device, _pipeline, nullptr );
+	vkDestroyPipelineLayout( device, _pipeline_layout, nullptr );
+	vkDestroyShaderModule( device, _shader_module, nullptr );
+}
+
+void GPUCulling::_UpdateDescriptorSet( const GPUCullingBuffers & buffers )
+{
+	std::array<VkBuffer, 5> buffer_list { buffers.objects, buffers.instance_matrices, buffers.commands, buffers.culled_commands, buffers.draw_counts };
+
+	// frames don't overlap, nothing can be using the set anymore
+	std::array<VkDescriptorBufferInfo, 5> buffer_infos {};
+	std::array<VkWriteDescriptorSet, 5> write_sets {};
+	for( uint32_t i=0; i < buffer_list.size(); ++i ) {
+		assert( VK_NULL_HANDLE != buffer_list[ i ] );
+		buffer_infos[ i ].buffer			= buffer_list[ i ];
+		buffer_infos[ i ].offset			= 0;
+		buffer_infos[ i ].range				= VK_WHOLE_SIZE;
+
+		write_sets[ i ].sType				= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write_sets[ i ].dstSet				= _descriptor_set;
+		write_sets[ i ].dstBinding			= i;
+		write_sets[ i ].dstArrayElement		= 0;
+		write_sets[ i ].descriptorCount		= 1;
+		write_sets[ i ].descriptorType		= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		write_sets[ i ].pImageInfo			= nullptr;
+		write_sets[ i ].pBufferInfo			= &buffer_infos[ i ];
+		write_sets[ i ].pTexelBufferView	= nullptr;
+	}
+	vkUpdateDescriptorSets( _ref_renderer->GetVulkanDevice(), uint32_t( write_sets.size() ), write_sets.data(), 0, nullptr );
+}
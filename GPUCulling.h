@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Platform.h"
+
+class Renderer;
+
+// objects handled by one workgroup of shaders/cull.comp
+constexpr uint32_t GPU_CULLING_WORKGROUP_SIZE					= 64;
+
+// One object to cull, matches CullObject in shaders/cull.comp. The object's model matrix is
+// read from the instance matrices at the same index.
+struct GPUCullingObject
+{
+	float							bounding_sphere[ 4 ]			= { 0.0f, 0.0f, 0.0f, 0.0f };	// center and radius before the model matrix
+	uint32_t						first_command					= 0;
+	uint32_t						command_count					= 0;
+	uint32_t						group_first_command				= 0;		// where compacted commands of the object's group start
+	uint32_t						group							= 0;		// draw count of the group when compacting
+};
+
+struct PushConstants_Cull
+{
+	glm::vec4						Frustum_Planes[ 6 ];
+	uint32_t						Object_Count;
+	uint32_t						Compact;
+};
+
+// Storage buffers a culling dispatch reads and writes.
+struct GPUCullingBuffers
+{
+	VkBuffer						objects							= VK_NULL_HANDLE;		// GPUCullingObject
+	VkBuffer						instance_matrices				= VK_NULL_HANDLE;		// glm::mat4
+	VkBuffer						commands						= VK_NULL_HANDLE;		// VkDrawIndexedIndirectCommand
+	VkBuffer						culled_commands					= VK_NULL_HANDLE;		// same size as commands
+	VkBuffer						draw_counts						= VK_NULL_HANDLE;		// uint32_t per group
+};
+
+// Frustum culls indirect draw commands in a compute shader so the CPU never looks at object bounds.
+// Visible objects' commands are compacted per group behind draw counts when the device has
+// VK_KHR_draw_indirect_count, otherwise culled objects keep their commands with zero instances.
+class GPUCulling
+{
+public:
+	GPUCulling( Renderer * renderer );
+	~GPUCulling();
+
+	bool							CanCompact() const;
+
+	// Records the dispatch and the barriers that make its results readable by indirect draws,
+	// has to go outside of render passes. Clears group_count draw counts first when compacting.
+	void							CmdCull( VkCommandBuffer command_buffer, const GPUCullingBuffers & buffers, uint32_t object_count, uint32_t group_count, const glm::mat4 & view_projection, bool compact );
+
+	// vkCmdDrawIndexedIndirectCountKHR, only when CanCompact()
+	void							CmdDrawIndexedIndirectCount( VkCommandBuffer command_buffer, VkBuffer buffer, VkDeviceSize offset, VkBuffer count_buffer, VkDeviceSize count_offset, uint32_t max_draw_count, uint32_t stride );
+
+private:
+	void							_InitPipeline();
+	void							_DeInitPipeline();
+	void							_UpdateDescriptorSet( const GPUCullingBuffers & buffers );
+
+	Renderer					*	_ref_renderer					= nullptr;
+
+	VkShaderModule					_shader_module					= VK_NULL_HANDLE;
+	VkPipelineLayout				_pipeline_layout				= VK_NULL_HANDLE;
+	VkPipeline						_pipeline						= VK_NULL_HANDLE;
+
+	// written again every dispatch, a reallocated buffer may come back with the same handle
+	VkDescriptorSet					_descriptor_set					= VK_NULL_HANDLE;
+
+	PFN_vkVoidFunction				_draw_indexed_indirect_count	= nullptr;
+};
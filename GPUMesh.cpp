@@ -0,0 +1,221 @@
+#include "GPUMesh.h"
+
+#include "Shared.h"
+#include "Renderer.h"
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+GPUMesh::GPUMesh( Renderer * renderer, std::shared_ptr<const Mesh> mesh, VERTEX_LAYOUT vertex_layout, GPU_MESH_STORAGE storage )
+{
+	assert( nullptr != renderer );
+	assert( nullptr != mesh );
+	_ref_renderer		= renderer;
+	_mesh				= std::move( mesh );
+	_vertex_layout		= vertex_layout;
+	_storage			= storage;
+
+	_InitBuffers();
+}
+
+GPUMesh::~GPUMesh()
+{
+	_DeInitBuffers();
+}
+
+void GPUMesh::UploadVertices()
+{
+	if( GPU_MESH_STORAGE::STATIC == _storage ) {
+		assert( _mesh->GetVertexRevision() == _vertex_revision && "Static mesh was changed after its buffers were created." );
+		assert( _mesh->GetTriangleRevision() == _triangle_revision && "Static mesh was changed after its buffers were created." );
+		return;
+	}
+
+	size_t first_vertex		= 0;
+	size_t vertex_count		= 0;
+	bool vertices_changed	= _mesh->GetVerticesChangedSince( _vertex_revision, &first_vertex, &vertex_count );
+	if( !vertices_changed && _mesh->GetTriangleRevision() == _triangle_revision ) return;
+
+	size_t stride			= VertexLayout_GetStride( _vertex_layout );
+	if( _mesh->GetTriangleRevision() != _triangle_revision || _mesh->vertices.size() * stride != _vertex_buffer_data.size() ) {
+		// old indices may point past fewer vertices, indices, levels of detail and draw ranges are all built again.
+		// Frames don't overlap and this runs before the mesh is drawn in this frame, nothing uses the old buffers anymore
+		_DeInitBuffers();
+		_InitBuffers();
+		++_index_revision;
+		return;
+	}
+	_vertex_revision		= _mesh->GetVertexRevision();
+
+	if( !VertexLayout_EncodeRange( _vertex_layout, _mesh->vertices, first_vertex, vertex_count, _vertex_buffer_data, _vertex_dequantization ) ) {
+		// out of the quantization box, new dequantization reaches shaders through the model matrix
+		VertexLayout_Encode( _vertex_layout, _mesh->vertices, _vertex_buffer_data, &_vertex_dequantization );
+		first_vertex		= 0;
+		vertex_count		= _mesh->vertices.size();
+	}
+
+	_WriteVertexBuffer( first_vertex * stride, vertex_count * stride );
+}
+
+void GPUMesh::CmdDraw( VkCommandBuffer command_buffer, const std::vector<MeshDrawRange> & ranges, uint32_t instance_count )
+{
+	if( ranges.empty() || 0 == instance_count ) return;
+
+	CmdBindBuffers( command_buffer );
+	for( auto & range : ranges ) {
+		vkCmdDrawIndexed( command_buffer, range.index_count, instance_count, _heap_range.first_index + range.first_index, _heap_range.base_vertex + range.vertex_offset, 0 );
+	}
+}
+
+void GPUMesh::CmdBindBuffers( VkCommandBuffer command_buffer )
+{
+	if( GPU_MESH_STORAGE::STATIC == _storage ) {
+		_ref_renderer->GetGeometryHeap()->CmdBindBuffers( command_buffer, _index_type );
+	} else {
+		VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers( command_buffer, 0, 1, &_vbo, &offset );
+		vkCmdBindIndexBuffer( command_buffer, _ibo, 0, _index_type );
+		// the next heap mesh has to bind its buffers again
+		_ref_renderer->GetGeometryHeap()->ResetBindings();
+	}
+}
+
+void GPUMesh::GetIndirectCommands( const std::vector<MeshDrawRange> & ranges, uint32_t first_instance, VkDrawIndexedIndirectCommand * commands ) const
+{
+	for( size_t i=0; i < ranges.size(); ++i ) {
+		commands[ i ].indexCount		= ranges[ i ].index_count;
+		commands[ i ].instanceCount		= 1;
+		commands[ i ].firstIndex		= _heap_range.first_index + ranges[ i ].first_index;
+		commands[ i ].vertexOffset		= _heap_range.base_vertex + ranges[ i ].vertex_offset;
+		commands[ i ].firstInstance		= first_instance;
+	}
+}
+
+const Mesh & GPUMesh::GetMesh() const
+{
+	return *_mesh;
+}
+
+VERTEX_LAYOUT GPUMesh::GetVertexLayout() const
+{
+	return _vertex_layout;
+}
+
+GPU_MESH_STORAGE GPUMesh::GetStorage() const
+{
+	return _storage;
+}
+
+VkIndexType GPUMesh::GetIndexType() const
+{
+	return _index_type;
+}
+
+const VertexDequantization & GPUMesh::GetVertexDequantization() const
+{
+	return _vertex_dequantization;
+}
+
+const std::vector<GPUMeshLOD> & GPUMesh::GetLODs() const
+{
+	return _lods;
+}
+
+uint64_t GPUMesh::GetIndexRevision() const
+{
+	return _index_revision;
+}
+
+glm::vec3 GPUMesh::GetBoundingCenter() const
+{
+	auto & bounds			= _mesh->GetBounds();
+	return glm::vec3( bounds.center[ 0 ], bounds.center[ 1 ], bounds.center[ 2 ] );
+}
+
+float GPUMesh::GetBoundingRadius() const
+{
+	return _mesh->GetBounds().radius;
+}
+
+glm::vec4 GPUMesh::GetEncodedBoundingSphere() const
+{
+	// flat axes have no scale and the center sits at 0 on them anyway
+	auto & bounds				= _mesh->GetBounds();
+	glm::vec4 sphere			= glm::vec4( 0.0f );
+	float min_scale				= std::numeric_limits<float>::max();
+	for( int c=0; c < 3; ++c ) {
+		float scale				= _vertex_dequantization.scale[ c ];
+		sphere[ c ]				= scale > 0.0f ? ( bounds.center[ c ] - _vertex_dequantization.offset[ c ] ) / scale : 0.0f;
+		if( scale > 0.0f ) min_scale = std::min( min_scale, scale );
+	}
+	// encoded positions stretch the most along the axis with the smallest scale, the sphere has to reach that far.
+	// Whoever uses it scales the radius by the longest model matrix axis, which is at least min_scale times the
+	// longest axis without the dequantization, so the sphere still covers the mesh for non-uniform sizes
+	sphere.w					= min_scale < std::numeric_limits<float>::max() ? bounds.radius / min_scale : 0.0f;
+	return sphere;
+}
+
+void GPUMesh::_InitBuffers()
+{
+	_vertex_revision		= _mesh->GetVertexRevision();
+	_triangle_revision		= _mesh->GetTriangleRevision();
+
+	// meshes loaded from files cooked for this layout come with everything ready, see MeshGPUData.h.
+	// Vertices of dynamic meshes move, cluster bounds would go stale so they get none and are never cluster culled
+	bool is_static			= GPU_MESH_STORAGE::STATIC == _storage;
+	MeshGPUData built;
+	auto data				= is_static ? _mesh->GetCookedGPUData( _vertex_layout ) : nullptr;
+	if( nullptr == data ) {
+		MeshGPUData_Build( *_mesh, _vertex_layout, is_static, &built );
+		data				= &built;
+	}
+	_vertex_dequantization	= data->dequantization;
+	_index_type				= INDEX_TYPE::UINT16 == data->index_type ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	_lods					= data->lods;
+
+	if( is_static ) {
+		// the GPU reads these every frame, the heap is device local which keeps the reads off the bus on discrete GPUs.
+		// Nothing can change the mesh, no encoded copy is kept
+		_heap_range		= _ref_renderer->GetGeometryHeap()->Add( data->vertex_data, VertexLayout_GetStride( _vertex_layout ), data->index_data, MeshIndices_GetIndexSize( data->index_type ) );
+	} else {
+		_vertex_buffer_data			= data->vertex_data;
+		auto & memory_properties	= _ref_renderer->GetVulkanPhysicalDeviceMemoryProperties();
+		CreateBuffer( _ref_renderer->GetVulkanDevice(), &memory_properties, data->index_data.size(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &_ibo, &_ibo_memory );
+		_InitDynamicVertexBuffer();
+
+		uint8_t * mapped = nullptr;
+		ErrorCheck( vkMapMemory( _ref_renderer->GetVulkanDevice(), _ibo_memory, 0, data->index_data.size(), 0, (void**)&mapped ) );
+		std::memcpy( mapped, data->index_data.data(), data->index_data.size() );
+		vkUnmapMemory( _ref_renderer->GetVulkanDevice(), _ibo_memory );
+	}
+}
+
+void GPUMesh::_InitDynamicVertexBuffer()
+{
+	auto & memory_properties	= _ref_renderer->GetVulkanPhysicalDeviceMemoryProperties();
+	CreateBuffer( _ref_renderer->GetVulkanDevice(), &memory_properties, _vertex_buffer_data.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &_vbo, &_vbo_memory );
+	_WriteVertexBuffer( 0, _vertex_buffer_data.size() );
+}
+
+void GPUMesh::_WriteVertexBuffer( size_t byte_offset, size_t byte_size )
+{
+	if( 0 == byte_size ) return;
+	uint8_t * mapped = nullptr;
+	ErrorCheck( vkMapMemory( _ref_renderer->GetVulkanDevice(), _vbo_memory, byte_offset, byte_size, 0, (void**)&mapped ) );
+	std::memcpy( mapped, _vertex_buffer_data.data() + byte_offset, byte_size );
+	vkUnmapMemory( _ref_renderer->GetVulkanDevice(), _vbo_memory );
+}
+
+void GPUMesh::_DeInitBuffers()
+{
+	if( GPU_MESH_STORAGE::STATIC == _storage ) {
+		_ref_renderer->GetGeometryHeap()->Remove( _heap_range );
+		return;
+	}
+	vkDestroyBuffer( _ref_renderer->GetVulkanDevice(), _ibo, nullptr );
+	vkDestroyBuffer( _ref_renderer->GetVulkanDevice(), _vbo, nullptr );
+	vkFreeMemory( _ref_renderer->GetVulkanDevice(), _ibo_memory, nullptr );
+	vkFreeMemory( _ref_renderer->GetVulkanDevice(), _vbo_memory, nullptr );
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Platform.h"
+#include "MeshGPUData.h"
+#include "GeometryHeap.h"
+
+#include <memory>
+#include <vector>
+
+class Renderer;
+class Mesh;
+
+enum class GPU_MESH_STORAGE
+{
+	STATIC,						// in the device local geometry heap, filled once through a staging buffer, the mesh must not change
+	DYNAMIC,					// host visible and coherent buffers, changed vertices are written on the next draw, no clusters
+};
+
+// Vertex and index buffers of a mesh encoded for one vertex layout, shared by every scene object
+// drawing that mesh with pipelines of that layout. Get these from MeshRegistry so they are shared.
+class GPUMesh
+{
+public:
+	GPUMesh( Renderer * renderer, std::shared_ptr<const Mesh> mesh, VERTEX_LAYOUT vertex_layout, GPU_MESH_STORAGE storage );
+	~GPUMesh();
+
+	// writes vertices changed in the mesh since the last upload, nothing if it wasn't touched or is static.
+	// A dynamic mesh whose vertex count or triangles changed gets all of its buffers built again, see GetIndexRevision()
+	void								UploadVertices();
+	// binds the buffers when needed and draws mesh relative ranges, eg. from GetLODs(),
+	// only vertex buffer binding 0 is touched so instance data can stay bound in binding 1
+	void								CmdDraw( VkCommandBuffer command_buffer, const std::vector<MeshDrawRange> & ranges, uint32_t instance_count = 1 );
+
+	// for indirect draws, binds like CmdDraw does and writes ranges.size() commands with the buffer offsets added in
+	void								CmdBindBuffers( VkCommandBuffer command_buffer );
+	void								GetIndirectCommands( const std::vector<MeshDrawRange> & ranges, uint32_t first_instance, VkDrawIndexedIndirectCommand * commands ) const;
+
+	const Mesh						&	GetMesh() const;
+	VERTEX_LAYOUT						GetVertexLayout() const;
+	GPU_MESH_STORAGE					GetStorage() const;
+	VkIndexType							GetIndexType() const;
+	const VertexDequantization		&	GetVertexDequantization() const;
+	const std::vector<GPUMeshLOD>	&	GetLODs() const;			// full detail first
+	uint64_t							GetIndexRevision() const;	// changes when UploadVertices() built GetLODs() again, ranges taken from it are stale then
+	glm::vec3							GetBoundingCenter() const;	// in mesh units, see Mesh::GetBounds()
+	float								GetBoundingRadius() const;
+	// bounding sphere before the vertex dequantization, for model matrices that start from encoded positions
+	glm::vec4							GetEncodedBoundingSphere() const;
+
+private:
+	void								_InitBuffers();
+	void								_DeInitBuffers();
+	void								_InitDynamicVertexBuffer();								// sized for and filled from _vertex_buffer_data
+	void								_WriteVertexBuffer( size_t byte_offset, size_t byte_size );	// dynamic storage, from _vertex_buffer_data
+
+	Renderer						*	_ref_renderer								= nullptr;
+	std::shared_ptr<const Mesh>			_mesh;
+
+	// static meshes live in the renderer's geometry heap, dynamic ones have buffers of their own
+	GeometryHeapRange					_heap_range;
+	VkBuffer							_vbo										= VK_NULL_HANDLE;
+	VkBuffer							_ibo										= VK_NULL_HANDLE;
+
+	VkDeviceMemory						_vbo_memory									= VK_NULL_HANDLE;
+	VkDeviceMemory						_ibo_memory									= VK_NULL_HANDLE;
+
+	VERTEX_LAYOUT						_vertex_layout								= VERTEX_LAYOUT::FLOAT32;
+	GPU_MESH_STORAGE					_storage									= GPU_MESH_STORAGE::STATIC;
+	std::vector<uint8_t>				_vertex_buffer_data;						// only kept for dynamic storage
+	VertexDequantization				_vertex_dequantization;
+	uint64_t							_vertex_revision							= 0;		// of the mesh vertices in the buffer
+	uint64_t							_triangle_revision							= 0;		// of the mesh triangles in the index buffer
+	uint64_t							_index_revision								= 0;
+
+	// 16 bit whenever the mesh allows it, large meshes are drawn in several ranges
+	VkIndexType							_index_type									= VK_INDEX_TYPE_UINT32;
+
+	// every level of detail has its own part of the index buffer
+	std::vector<GPUMeshLOD>				_lods;
+};
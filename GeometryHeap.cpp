@@ -0,0 +1,228 @@
+#include "GeometryHeap.h"
+
+#include "Shared.h"
+#include "Renderer.h"
+
+#include <algorithm>
+#include <cstring>
+
+GeometryHeap::GeometryHeap( Renderer * renderer, VkDeviceSize vertex_bytes, VkDeviceSize index_bytes )
+{
+	assert( nullptr != renderer );
+	_ref_renderer		= renderer;
+
+	VkCommandPoolCreateInfo pool_create_info {};
+	pool_create_info.sType				= VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_create_info.flags				= VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	pool_create_info.queueFamilyIndex	= _ref_renderer->GetVulkanGraphicsQueueFamilyIndex();
+	ErrorCheck( vkCreateCommandPool( _ref_renderer->GetVulkanDevice(), &pool_create_info, nullptr, &_transfer_command_pool ) );
+
+	_Grow( vertex_bytes, index_bytes );
+}
+
+GeometryHeap::~GeometryHeap()
+{
+	// every mesh should have removed itself by now
+	assert( 0 == _vertex_allocator.GetUsedSize() );
+	assert( 0 == _index_allocator.GetUsedSize() );
+
+	auto device = _ref_renderer->GetVulkanDevice();
+	vkDestroyBuffer( device, _vertex_buffer, nullptr );
+	vkDestroyBuffer( device, _index_buffer, nullptr );
+	vkFreeMemory( device, _vertex_memory, nullptr );
+	vkFreeMemory( device, _index_memory, nullptr );
+	vkDestroyCommandPool( device, _transfer_command_pool, nullptr );
+}
+
+GeometryHeapRange GeometryHeap::Add( const std::vector<uint8_t> & vertex_data, size_t vertex_stride, const std::vector<uint8_t> & index_data, size_t index_size )
+{
+	assert( vertex_stride > 0 && 0 == vertex_data.size() % vertex_stride );
+	assert( ( 2 == index_size || 4 == index_size ) && 0 == index_data.size() % index_size );
+
+	GeometryHeapRange range;
+	_Reserve( vertex_data.size(), vertex_stride, index_data.size(), index_size, &range );
+	_Upload( range, vertex_data, index_data );
+	return range;
+}
+
+void GeometryHeap::Remove( const GeometryHeapRange & range )
+{
+	_vertex_allocator.Free( range.vertex_offset, range.vertex_size );
+	_index_allocator.Free( range.index_offset, range.index_size );
+}
+
+void GeometryHeap::CmdBindBuffers( VkCommandBuffer command_buffer, VkIndexType index_type )
+{
+	if( _bound_command_buffer == command_buffer && _bound_index_type == index_type ) return;
+
+	// the vertex buffer stays bound when only the index type changes
+	if( _bound_command_buffer != command_buffer ) {
+		VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers( command_buffer, 0, 1, &_vertex_buffer, &offset );
+	}
+	vkCmdBindIndexBuffer( command_buffer, _index_buffer, 0, index_type );
+	_bound_command_buffer	= command_buffer;
+	_bound_index_type		= index_type;
+}
+
+void GeometryHeap::ResetBindings()
+{
+	_bound_command_buffer	= VK_NULL_HANDLE;
+}
+
+VkDeviceSize GeometryHeap::GetVertexBytesUsed() const
+{
+	return _vertex_allocator.GetUsedSize();
+}
+
+VkDeviceSize GeometryHeap::GetIndexBytesUsed() const
+{
+	return _index_allocator.GetUsedSize();
+}
+
+void GeometryHeap::_Reserve( VkDeviceSize vertex_bytes, size_t vertex_stride, VkDeviceSize index_bytes, size_t index_size, GeometryHeapRange * range )
+{
+	range->vertex_size		= vertex_bytes;
+	range->index_size		= index_bytes;
+	bool vertices_fit		= _vertex_allocator.Allocate( vertex_bytes, vertex_stride, &range->vertex_offset );
+	bool indices_fit		= _index_allocator.Allocate( index_bytes, index_size, &range->index_offset );
+	if( !vertices_fit || !indices_fit ) {
+		if( vertices_fit ) _vertex_allocator.Free( range->vertex_offset, vertex_bytes );
+		if( indices_fit ) _index_allocator.Free( range->index_offset, index_bytes );
+
+		// double until it fits even if the free space at the end is fragmented
+		VkDeviceSize vertex_capacity	= _vertex_allocator.GetCapacity();
+		VkDeviceSize index_capacity		= _index_allocator.GetCapacity();
+		if( !vertices_fit ) vertex_capacity	= std::max( vertex_capacity * 2, vertex_capacity + vertex_bytes + vertex_stride );
+		if( !indices_fit ) index_capacity	= std::max( index_capacity * 2, index_capacity + index_bytes + index_size );
+		_Grow( vertex_capacity, index_capacity );
+
+		vertices_fit	= _vertex_allocator.Allocate( vertex_bytes, vertex_stride, &range->vertex_offset );
+		indices_fit		= _index_allocator.Allocate( index_bytes, index_size, &range->index_offset );
+		assert( vertices_fit && indices_fit );
+	}
+	range->base_vertex		= int32_t( range->vertex_offset / vertex_stride );
+	range->first_index		= uint32_t( range->index_offset / index_size );
+}
+
+void GeometryHeap::_Grow( VkDeviceSize vertex_capacity, VkDeviceSize index_capacity )
+{
+	auto device					= _ref_renderer->GetVulkanDevice();
+	auto & memory_properties	= _ref_renderer->GetVulkanPhysicalDeviceMemoryProperties();
+
+	VkBuffer		vertex_buffer		= VK_NULL_HANDLE;
+	VkBuffer		index_buffer		= VK_NULL_HANDLE;
+	VkDeviceMemory	vertex_memory		= VK_NULL_HANDLE;
+	VkDeviceMemory	index_memory		= VK_NULL_HANDLE;
+	CreateBuffer( device, &memory_properties, vertex_capacity,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &vertex_buffer, &vertex_memory );
+	CreateBuffer( device, &memory_properties, index_capacity,
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &index_buffer, &index_memory );
+
+	// everything already in the heap keeps its offsets
+	if( VK_NULL_HANDLE != _vertex_buffer ) {
+		auto command_buffer		= _BeginTransfer();
+		VkBufferCopy copy {};
+		copy.size				= _vertex_allocator.GetCapacity();
+		vkCmdCopyBuffer( command_buffer, _vertex_buffer, vertex_buffer, 1, &copy );
+		copy.size				= _index_allocator.GetCapacity();
+		vkCmdCopyBuffer( command_buffer, _index_buffer, index_buffer, 1, &copy );
+		_EndTransfer( command_buffer );
+
+		vkDestroyBuffer( device, _vertex_buffer, nullptr );
+		vkDestroyBuffer( device, _index_buffer, nullptr );
+		vkFreeMemory( device, _vertex_memory, nullptr );
+		vkFreeMemory( device, _index_memory, nullptr );
+	}
+	_vertex_buffer		= vertex_buffer;
+	_index_buffer		= index_buffer;
+	_vertex_memory		= vertex_memory;
+	_index_memory		= index_memory;
+	_vertex_allocator.Grow( vertex_capacity );
+	_index_allocator.Grow( index_capacity );
+	ResetBindings();
+}
+
+void GeometryHeap::_Upload( const GeometryHeapRange & range, const std::vector<uint8_t> & vertex_data, const std::vector<uint8_t> & index_data )
+{
+	if( vertex_data.empty() && index_data.empty() ) return;
+	auto device = _ref_renderer->GetVulkanDevice();
+
+	// vertices and indices share one staging buffer and one submit
+	VkBuffer		staging_buffer			= VK_NULL_HANDLE;
+	VkDeviceMemory	staging_buffer_memory	= VK_NULL_HANDLE;
+	CreateBuffer( device, &_ref_renderer->GetVulkanPhysicalDeviceMemoryProperties(), vertex_data.size() + index_data.size(),
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, &staging_buffer, &staging_buffer_memory );
+	{
+		uint8_t * mapped = nullptr;
+		ErrorCheck( vkMapMemory( device, staging_buffer_memory, 0, VK_WHOLE_SIZE, 0, (void**)&mapped ) );
+		std::memcpy( mapped, vertex_data.data(), vertex_data.size() );
+		std::memcpy( mapped + vertex_data.size(), index_data.data(), index_data.size() );
+		vkUnmapMemory( device, staging_buffer_memory );
+	}
+
+	auto command_buffer = _BeginTransfer();
+	if( !vertex_data.empty() ) {
+		VkBufferCopy vertex_copy {};
+		vertex_copy.srcOffset		= 0;
+		vertex_copy.dstOffset		= range.vertex_offset;
+		vertex_copy.size			= vertex_data.size();
+		vkCmdCopyBuffer( command_buffer, staging_buffer, _vertex_buffer, 1, &vertex_copy );
+	}
+	if( !index_data.empty() ) {
+		VkBufferCopy index_copy {};
+		index_copy.srcOffset		= vertex_data.size();
+		index_copy.dstOffset		= range.index_offset;
+		index_copy.size				= index_data.size();
+		vkCmdCopyBuffer( command_buffer, staging_buffer, _index_buffer, 1, &index_copy );
+	}
+	_EndTransfer( command_buffer );
+
+	vkDestroyBuffer( device, staging_buffer, nullptr );
+	vkFreeMemory( device, staging_buffer_memory, nullptr );
+}
+
+VkCommandBuffer GeometryHeap::_BeginTransfer()
+{
+	VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+	VkCommandBufferAllocateInfo buffer_allocate_info {};
+	buffer_allocate_info.sType				= VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	buffer_allocate_info.commandPool		= _transfer_command_pool;
+	buffer_allocate_info.level				= VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	buffer_allocate_info.commandBufferCount	= 1;
+	ErrorCheck( vkAllocateCommandBuffers( _ref_renderer->GetVulkanDevice(), &buffer_allocate_info, &command_buffer ) );
+
+	VkCommandBufferBeginInfo buffer_begin_info {};
+	buffer_begin_info.sType					= VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	buffer_begin_info.flags					= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	ErrorCheck( vkBeginCommandBuffer( command_buffer, &buffer_begin_info ) );
+	return command_buffer;
+}
+
+void GeometryHeap::_EndTransfer( VkCommandBuffer command_buffer )
+{
+	// make the copies visible to vertex input of every later draw
+	VkMemoryBarrier memory_barrier {};
+	memory_barrier.sType			= VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memory_barrier.srcAccessMask	= VK_ACCESS_TRANSFER_WRITE_BIT;
+	memory_barrier.dstAccessMask	= VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+	vkCmdPipelineBarrier( command_buffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+		0,
+		1, &memory_barrier,
+		0, nullptr,
+		0, nullptr );
+	ErrorCheck( vkEndCommandBuffer( command_buffer ) );
+
+	VkSubmitInfo submit_info {};
+	submit_info.sType				= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.commandBufferCount	= 1;
+	submit_info.pCommandBuffers		= &command_buffer;
+	ErrorCheck( vkQueueSubmit( _ref_renderer->GetVulkanQueue(), 1, &submit_info, VK_NULL_HANDLE ) );
+	vkQueueWaitIdle( _ref_renderer->GetVulkanQueue() );
+
+	vkFreeCommandBuffers( _ref_renderer->GetVulkanDevice(), _transfer_command_pool, 1, &command_buffer );
+}
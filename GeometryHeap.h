@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Platform.h"
+#include "BufferAllocator.h"
+
+#include <vector>
+
+class Renderer;
+
+// default sizes, the heap grows when a mesh doesn't fit
+constexpr VkDeviceSize GEOMETRY_HEAP_INITIAL_VERTEX_BYTES		= 32 * 1024 * 1024;
+constexpr VkDeviceSize GEOMETRY_HEAP_INITIAL_INDEX_BYTES		= 16 * 1024 * 1024;
+
+// Where one mesh lives inside the heap. base_vertex and first_index are in elements of the
+// vertex stride and index size, added to the mesh relative draw ranges at draw time.
+struct GeometryHeapRange
+{
+	VkDeviceSize					vertex_offset					= 0;		// in bytes
+	VkDeviceSize					vertex_size						= 0;
+	VkDeviceSize					index_offset					= 0;
+	VkDeviceSize					index_size						= 0;
+	int32_t							base_vertex						= 0;
+	uint32_t						first_index						= 0;
+};
+
+// One device local vertex buffer and one index buffer shared by every static mesh, so drawing
+// many objects doesn't rebind buffers and doesn't need two memory allocations per mesh.
+// Meshes of every vertex layout and index type share the buffers, ranges are aligned to their stride.
+// Growing replaces the buffers, do it outside of command buffer recording.
+class GeometryHeap
+{
+public:
+	GeometryHeap( Renderer * renderer, VkDeviceSize vertex_bytes = GEOMETRY_HEAP_INITIAL_VERTEX_BYTES, VkDeviceSize index_bytes = GEOMETRY_HEAP_INITIAL_INDEX_BYTES );
+	~GeometryHeap();
+
+	// reserves space and copies the data in through a staging buffer
+	GeometryHeapRange				Add( const std::vector<uint8_t> & vertex_data, size_t vertex_stride, const std::vector<uint8_t> & index_data, size_t index_size );
+	void							Remove( const GeometryHeapRange & range );
+
+	// binds only when something else was bound since, call ResetBindings() when starting a new command buffer
+	void							CmdBindBuffers( VkCommandBuffer command_buffer, VkIndexType index_type );
+	void							ResetBindings();
+
+	VkDeviceSize					GetVertexBytesUsed() const;
+	VkDeviceSize					GetIndexBytesUsed() const;
+
+private:
+	void							_Reserve( VkDeviceSize vertex_bytes, size_t vertex_stride, VkDeviceSize index_bytes, size_t index_size, GeometryHeapRange * range );
+	void							_Grow( VkDeviceSize vertex_capacity, VkDeviceSize index_capacity );
+	void							_Upload( const GeometryHeapRange & range, const std::vector<uint8_t> & vertex_data, const std::vector<uint8_t> & index_data );
+	VkCommandBuffer					_BeginTransfer();
+	void							_EndTransfer( VkCommandBuffer command_buffer );		// waits until the copies are done
+
+	Renderer					*	_ref_renderer					= nullptr;
+
+	VkBuffer						_vertex_buffer					= VK_NULL_HANDLE;
+	VkBuffer						_index_buffer					= VK_NULL_HANDLE;
+	VkDeviceMemory					_vertex_memory					= VK_NULL_HANDLE;
+	VkDeviceMemory					_index_memory					= VK_NULL_HANDLE;
+
+	VkCommandPool					_transfer_command_pool			= VK_NULL_HANDLE;
+
+	BufferAllocator					_vertex_allocator;
+	BufferAllocator					_index_allocator;
+
+	VkCommandBuffer					_bound_command_buffer			= VK_NULL_HANDLE;
+	VkIndexType						_bound_index_type				= VK_INDEX_TYPE_UINT32;
+};
@@ -0,0 +1,224 @@
+#include "ME3DBenchmark.h"
+
+#include "ME3DFile.h"
+#include "Mesh.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#if defined( _WIN32 )
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+constexpr uint64_t ME3D_BENCHMARK_SIZES[]				= { 10000, 100000, 1000000, 10000000, 50000000 };
+constexpr uint32_t ME3D_BENCHMARK_WARM_ITERATIONS		= 3;
+constexpr uint32_t ME3D_BENCHMARK_SEAM_SPACING			= 16;		// a uv seam every this many columns, seams are made of vertex copies
+
+// shorter records like older exporters wrote them, vertices lose their material index and
+// vertex copies their padding, this way neither one can be read in one go or used in-place
+constexpr size_t ME3D_BENCHMARK_SHORT_VERTEX_SIZE		= sizeof( ME3D_Vertex ) - sizeof( int16_t );
+constexpr size_t ME3D_BENCHMARK_SHORT_COPY_SIZE			= offsetof( ME3D_VertexCopy, material_index ) + sizeof( int16_t );
+
+struct ME3D_BenchmarkFile
+{
+	std::string		path;
+	std::string		records;			// "full" or "short"
+	size_t			vert_size			= 0;
+	size_t			vert_copy_size		= 0;
+	ME3D_Header		head				= {};
+};
+
+// Writes a grid of quads with roughly triangle_count triangles as a version 1 file.
+// Records are streamed into the file one grid row at a time so even the largest meshes
+// never have to fit in memory.
+bool ME3D_WriteBenchmarkFile( ME3D_BenchmarkFile & file, uint64_t triangle_count )
+{
+	size_t vert_size			= file.vert_size;
+	size_t vert_copy_size		= file.vert_copy_size;
+	uint32_t width				= std::max( uint32_t( 1 ), uint32_t( std::sqrt( double( triangle_count / 2 ) ) ) );
+	uint32_t height				= std::max( uint32_t( 1 ), uint32_t( triangle_count / 2 / width ) );
+	uint32_t seam_count			= ( width - 1 ) / ME3D_BENCHMARK_SEAM_SPACING;
+	size_t vert_count			= size_t( width + 1 ) * ( height + 1 );
+	size_t vert_copy_count		= size_t( seam_count ) * ( height + 1 );
+	size_t polygon_count		= size_t( width ) * height * 2;
+
+	if( !ME3D_MakeHeader( &file.head, vert_count, vert_size, vert_copy_count, vert_copy_size, polygon_count, sizeof( ME3D_Polygon ) ) ) return false;
+
+	std::ofstream out( file.path, std::ofstream::binary | std::ofstream::trunc );
+	if( !out.is_open() ) return false;
+	out.write( (const char*)&file.head, sizeof( file.head ) );
+
+	auto GridIndex = [ width ]( uint32_t x, uint32_t y ) {
+		return int32_t( size_t( y ) * ( width + 1 ) + x );
+	};
+	auto CopyIndex = [ vert_count, height ]( uint32_t seam, uint32_t y ) {
+		return int32_t( vert_count + size_t( seam - 1 ) * ( height + 1 ) + y );
+	};
+
+	std::vector<uint8_t> row;
+	for( uint32_t y=0; y <= height; ++y ) {
+		row.resize( size_t( width + 1 ) * vert_size );
+		for( uint32_t x=0; x <= width; ++x ) {
+			ME3D_Vertex v {};
+			v.position[ 0 ]			= float( x ) / width;
+			v.position[ 1 ]			= float( y ) / height;
+			v.position[ 2 ]			= 0.05f * std::sin( float( x + y ) );
+			v.normals[ 2 ]			= int16_t( ME3D_FloatToShort( 1.0f ) );
+			uint32_t tile_x			= x % ME3D_BENCHMARK_SEAM_SPACING;
+			v.uvs[ 0 ]				= int16_t( ME3D_FloatToShort( ( tile_x == 0 && x > 0 ) ? 1.0f : float( tile_x ) / ME3D_BENCHMARK_SEAM_SPACING ) );
+			v.uvs[ 1 ]				= int16_t( ME3D_FloatToShort( float( y ) / height ) );
+			std::memcpy( &row[ x * vert_size ], &v, vert_size );
+		}
+		out.write( (const char*)row.data(), row.size() );
+	}
+
+	// copies restart the uv tile at every seam
+	for( uint32_t seam=1; seam <= seam_count; ++seam ) {
+		row.resize( size_t( height + 1 ) * vert_copy_size );
+		for( uint32_t y=0; y <= height; ++y ) {
+			ME3D_VertexCopy c {};
+			c.copy_from_index		= GridIndex( seam * ME3D_BENCHMARK_SEAM_SPACING, y );
+			c.uvs[ 0 ]				= 0;
+			c.uvs[ 1 ]				= int16_t( ME3D_FloatToShort( float( y ) / height ) );
+			std::memcpy( &row[ y * vert_copy_size ], &c, vert_copy_size );
+		}
+		out.write( (const char*)row.data(), row.size() );
+	}
+
+	std::vector<ME3D_Polygon> polygons( size_t( width ) * 2 );
+	for( uint32_t y=0; y < height; ++y ) {
+		for( uint32_t x=0; x < width; ++x ) {
+			// quads starting at a seam use the copies on their left edge
+			bool on_seam			= x > 0 && x % ME3D_BENCHMARK_SEAM_SPACING == 0;
+			int32_t top_left		= on_seam ? CopyIndex( x / ME3D_BENCHMARK_SEAM_SPACING, y ) : GridIndex( x, y );
+			int32_t bottom_left		= on_seam ? CopyIndex( x / ME3D_BENCHMARK_SEAM_SPACING, y + 1 ) : GridIndex( x, y + 1 );
+			int32_t top_right		= GridIndex( x + 1, y );
+			int32_t bottom_right	= GridIndex( x + 1, y + 1 );
+			polygons[ x * 2 + 0 ]	= { { top_left, bottom_left, top_right } };
+			polygons[ x * 2 + 1 ]	= { { top_right, bottom_left, bottom_right } };
+		}
+		out.write( (const char*)polygons.data(), polygons.size() * sizeof( ME3D_Polygon ) );
+	}
+	return out.good();
+}
+
+// Drops the file from the operating system file cache so the next read has to come from the disk.
+// returns false if the platform refused, cold results are then really warm ones
+bool ME3D_EvictFromFileCache( std::string path )
+{
+#if defined( _WIN32 )
+	// opening a file without buffering flushes and purges its cached pages
+	HANDLE file = CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, nullptr );
+	if( INVALID_HANDLE_VALUE == file ) return false;
+	CloseHandle( file );
+	return true;
+#else
+	int file_descriptor = open( path.c_str(), O_RDONLY );
+	if( file_descriptor < 0 ) return false;
+	// dirty pages can't be dropped, make sure everything we wrote is on the disk first
+	fdatasync( file_descriptor );
+	bool evicted = posix_fadvise( file_descriptor, 0, 0, POSIX_FADV_DONTNEED ) == 0;
+	close( file_descriptor );
+	return evicted;
+#endif
+}
+
+// loads the file once with the selected loader, returns wall clock time in milliseconds or a negative value on failure
+double ME3D_MeasureLoad( const ME3D_BenchmarkFile & file, bool use_mesh )
+{
+	namespace chrono	= std::chrono;
+	size_t vertex_count	= size_t( file.head.vert_count ) + size_t( file.head.vert_copy_count );
+	size_t triangles	= size_t( file.head.polygon_count );
+
+	auto start_time		= chrono::steady_clock::now();
+	bool success		= false;
+	if( use_mesh ) {
+		Mesh mesh;
+		mesh.Load( file.path );
+		success			= mesh.vertices.size() == vertex_count && mesh.triangles.size() == triangles;
+	} else {
+		ME3D_File me3d( file.path );
+		success			= me3d.IsLoaded() && me3d.GetVertices().size() == vertex_count && me3d.GetPolygons().size() == triangles;
+	}
+	double time			= chrono::duration<double, std::milli>( chrono::steady_clock::now() - start_time ).count();
+	return success ? time : -1.0;
+}
+
+void ME3D_ReportLoad( std::ostream & report, const ME3D_BenchmarkFile & file, const char * loader, const char * cache, double milliseconds )
+{
+	double seconds		= std::max( milliseconds, 0.000001 ) / 1000.0;
+	double megabytes	= double( file.head.file_size ) / ( 1024.0 * 1024.0 );
+	report << loader << ","
+		<< file.records << ","
+		<< file.head.polygon_count << ","
+		<< file.head.vert_count << ","
+		<< file.head.vert_copy_count << ","
+		<< file.head.file_size << ","
+		<< cache << ","
+		<< milliseconds << ","
+		<< megabytes / seconds << ","
+		<< double( file.head.polygon_count ) / seconds << std::endl;
+}
+
+int RunME3DBenchmark( std::string directory, uint64_t max_triangles, std::ostream & report )
+{
+	int failures = 0;
+
+	report << "loader,records,triangles,vertices,vertex_copies,file_bytes,cache,milliseconds,mb_per_second,triangles_per_second" << std::endl;
+	for( auto triangle_count : ME3D_BENCHMARK_SIZES ) {
+		if( triangle_count > max_triangles ) break;
+
+		ME3D_BenchmarkFile files[ 2 ];
+		files[ 0 ].records			= "full";
+		files[ 0 ].vert_size		= sizeof( ME3D_Vertex );
+		files[ 0 ].vert_copy_size	= sizeof( ME3D_VertexCopy );
+		files[ 1 ].records			= "short";
+		files[ 1 ].vert_size		= ME3D_BENCHMARK_SHORT_VERTEX_SIZE;
+		files[ 1 ].vert_copy_size	= ME3D_BENCHMARK_SHORT_COPY_SIZE;
+		for( auto & file : files ) {
+			file.path		= directory + "/benchmark_" + std::to_string( triangle_count ) + "_" + file.records + ".me3d";
+			if( !ME3D_WriteBenchmarkFile( file, triangle_count ) ) {
+				report << "# couldn't write " << file.path << std::endl;
+				++failures;
+				std::remove( file.path.c_str() );
+				continue;
+			}
+
+			for( auto use_mesh : { false, true } ) {
+				const char * loader = use_mesh ? "Mesh" : "ME3D_File";
+
+				bool evicted	= ME3D_EvictFromFileCache( file.path );
+				double cold		= ME3D_MeasureLoad( file, use_mesh );
+				if( !evicted ) report << "# couldn't evict " << file.path << " from the file cache, cold result is warm" << std::endl;
+
+				// first load warms up the cache again, the rest are averaged
+				double warm		= ME3D_MeasureLoad( file, use_mesh );
+				if( warm >= 0.0 ) {
+					warm		= 0.0;
+					for( uint32_t i=0; i < ME3D_BENCHMARK_WARM_ITERATIONS && warm >= 0.0; ++i ) {
+						double time = ME3D_MeasureLoad( file, use_mesh );
+						warm	= time < 0.0 ? time : warm + time / ME3D_BENCHMARK_WARM_ITERATIONS;
+					}
+				}
+
+				if( cold < 0.0 || warm < 0.0 ) {
+					report << "# " << loader << " couldn't load " << file.path << std::endl;
+					++failures;
+					continue;
+				}
+				ME3D_ReportLoad( report, file, loader, "cold", cold );
+				ME3D_ReportLoad( report, file, loader, "warm", warm );
+			}
+			std::remove( file.path.c_str() );
+		}
+	}
+	return failures;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Generates synthetic ME3D files from 10K triangles up to max_triangles into directory and
+// measures how fast ME3D_File::Load and Mesh::Load get through them with a cold and a warm
+// page cache. Every size is written once with full size records and once with shorter,
+// unaligned records that force the per-record read paths.
+//
+// Results are written to report as CSV, one row per measurement:
+// loader,records,triangles,vertices,vertex_copies,file_bytes,cache,milliseconds,mb_per_second,triangles_per_second
+// Lines starting with # are comments. Returns the number of failed loads, 0 on success.
+int RunME3DBenchmark( std::string directory, uint64_t max_triangles, std::ostream & report );
@@ -0,0 +1,198 @@
+#include "ME3DCompression.h"
+
+#include <assert.h>
+#include <cstring>
+
+constexpr uint32_t ME3D_RANS_PROBABILITY_BITS			= 12;
+constexpr uint32_t ME3D_RANS_PROBABILITY_SCALE			= 1 << ME3D_RANS_PROBABILITY_BITS;
+constexpr uint32_t ME3D_RANS_LOWER_BOUND				= 1 << 23;		// renormalization interval is [ L, 256 * L )
+constexpr size_t ME3D_RANS_HEADER_SIZE					= sizeof( uint32_t ) + 256 * sizeof( uint16_t );
+
+constexpr size_t ME3D_DELTA_MAX_COMPONENTS				= 4;
+
+inline uint32_t ME3D_ZigZagEncode( int32_t value )
+{
+	return ( uint32_t( value ) << 1 ) ^ uint32_t( value >> 31 );
+}
+
+inline int32_t ME3D_ZigZagDecode( uint32_t value )
+{
+	return int32_t( value >> 1 ) ^ -int32_t( value & 1 );
+}
+
+template<typename T>
+void ME3D_EncodeDeltaVarint( const T * values, size_t count, size_t components, std::vector<uint8_t> & out )
+{
+	assert( components > 0 && components <= ME3D_DELTA_MAX_COMPONENTS );
+
+	uint32_t previous[ ME3D_DELTA_MAX_COMPONENTS ] {};
+	out.reserve( out.size() + count * components * 2 );
+	for( size_t i=0; i < count; ++i ) {
+		for( size_t c=0; c < components; ++c ) {
+			// wrapping 32 bit arithmetic keeps this lossless for every T
+			uint32_t current		= uint32_t( int32_t( values[ i * components + c ] ) );
+			uint32_t z				= ME3D_ZigZagEncode( int32_t( current - previous[ c ] ) );
+			previous[ c ]			= current;
+			while( z >= 0x80 ) {
+				out.push_back( uint8_t( z | 0x80 ) );
+				z >>= 7;
+			}
+			out.push_back( uint8_t( z ) );
+		}
+	}
+}
+
+template<typename T>
+bool ME3D_DecodeDeltaVarint( const uint8_t * data, size_t size, T * out, size_t count, size_t components )
+{
+	assert( components > 0 && components <= ME3D_DELTA_MAX_COMPONENTS );
+
+	const uint8_t * ptr		= data;
+	const uint8_t * end		= data + size;
+	uint32_t previous[ ME3D_DELTA_MAX_COMPONENTS ] {};
+	for( size_t i=0; i < count; ++i ) {
+		for( size_t c=0; c < components; ++c ) {
+			if( ptr >= end ) return false;
+			uint32_t z		= *ptr++;
+			if( z >= 0x80 ) {
+				// multi byte value, most deltas of coherent meshes fit in one byte so this is the cold path
+				z				&= 0x7f;
+				uint32_t shift	= 7;
+				uint8_t byte	= 0;
+				do {
+					if( ptr >= end || shift > 28 ) return false;
+					byte		= *ptr++;
+					z			|= uint32_t( byte & 0x7f ) << shift;
+					shift		+= 7;
+				} while( byte & 0x80 );
+			}
+			previous[ c ]					+= uint32_t( ME3D_ZigZagDecode( z ) );
+			out[ i * components + c ]		= T( previous[ c ] );
+		}
+	}
+	return ptr == end;
+}
+
+template void ME3D_EncodeDeltaVarint<int16_t>( const int16_t * values, size_t count, size_t components, std::vector<uint8_t> & out );
+template void ME3D_EncodeDeltaVarint<uint16_t>( const uint16_t * values, size_t count, size_t components, std::vector<uint8_t> & out );
+template void ME3D_EncodeDeltaVarint<int32_t>( const int32_t * values, size_t count, size_t components, std::vector<uint8_t> & out );
+template bool ME3D_DecodeDeltaVarint<int16_t>( const uint8_t * data, size_t size, int16_t * out, size_t count, size_t components );
+template bool ME3D_DecodeDeltaVarint<uint16_t>( const uint8_t * data, size_t size, uint16_t * out, size_t count, size_t components );
+template bool ME3D_DecodeDeltaVarint<int32_t>( const uint8_t * data, size_t size, int32_t * out, size_t count, size_t components );
+
+bool ME3D_EncodeRANS( const uint8_t * data, size_t size, std::vector<uint8_t> & out )
+{
+	if( 0 == size || size > UINT32_MAX ) return false;
+
+	// normalize symbol frequencies so that they sum up to the probability scale
+	// and every symbol that appears in the data gets at least 1
+	uint32_t counts[ 256 ] {};
+	for( size_t i=0; i < size; ++i ) {
+		++counts[ data[ i ] ];
+	}
+	uint32_t frequencies[ 256 ] {};
+	uint32_t frequency_sum		= 0;
+	uint32_t largest			= 0;
+	for( uint32_t s=0; s < 256; ++s ) {
+		if( 0 == counts[ s ] ) continue;
+		frequencies[ s ]		= uint32_t( uint64_t( counts[ s ] ) * ME3D_RANS_PROBABILITY_SCALE / size );
+		if( 0 == frequencies[ s ] ) frequencies[ s ] = 1;
+		frequency_sum			+= frequencies[ s ];
+		if( counts[ s ] > counts[ largest ] ) largest = s;
+	}
+	if( frequency_sum < ME3D_RANS_PROBABILITY_SCALE ) {
+		frequencies[ largest ]	+= ME3D_RANS_PROBABILITY_SCALE - frequency_sum;
+	}
+	while( frequency_sum > ME3D_RANS_PROBABILITY_SCALE ) {
+		// too many rare symbols got rounded up, take the excess away from the most common ones
+		uint32_t s = 0;
+		for( uint32_t i=1; i < 256; ++i ) {
+			if( frequencies[ i ] > frequencies[ s ] ) s = i;
+		}
+		--frequencies[ s ];
+		--frequency_sum;
+	}
+	uint32_t starts[ 256 ] {};
+	for( uint32_t s=1; s < 256; ++s ) {
+		starts[ s ]				= starts[ s - 1 ] + frequencies[ s - 1 ];
+	}
+
+	// rANS encodes in reverse, so we write the stream backwards into a scratch buffer
+	std::vector<uint8_t> stream( size + size / 2 + 16 );
+	uint8_t * ptr				= stream.data() + stream.size();
+	uint32_t state				= ME3D_RANS_LOWER_BOUND;
+	for( size_t i = size; i > 0; --i ) {
+		uint8_t symbol			= data[ i - 1 ];
+		uint32_t frequency		= frequencies[ symbol ];
+		uint32_t state_max		= ( ( ME3D_RANS_LOWER_BOUND >> ME3D_RANS_PROBABILITY_BITS ) << 8 ) * frequency;
+		while( state >= state_max ) {
+			if( ptr == stream.data() + 4 ) return false;	// incompressible, not worth it
+			*--ptr				= uint8_t( state & 0xff );
+			state				>>= 8;
+		}
+		state					= ( ( state / frequency ) << ME3D_RANS_PROBABILITY_BITS ) + ( state % frequency ) + starts[ symbol ];
+	}
+	ptr -= 4;
+	ptr[ 0 ]					= uint8_t( state >> 0 );
+	ptr[ 1 ]					= uint8_t( state >> 8 );
+	ptr[ 2 ]					= uint8_t( state >> 16 );
+	ptr[ 3 ]					= uint8_t( state >> 24 );
+
+	size_t stream_size			= size_t( stream.data() + stream.size() - ptr );
+	size_t offset				= out.size();
+	out.resize( offset + ME3D_RANS_HEADER_SIZE + stream_size );
+	uint32_t decoded_size		= uint32_t( size );
+	std::memcpy( &out[ offset ], &decoded_size, sizeof( uint32_t ) );
+	for( uint32_t s=0; s < 256; ++s ) {
+		uint16_t frequency		= uint16_t( frequencies[ s ] );
+		std::memcpy( &out[ offset + sizeof( uint32_t ) + s * sizeof( uint16_t ) ], &frequency, sizeof( uint16_t ) );
+	}
+	std::memcpy( &out[ offset + ME3D_RANS_HEADER_SIZE ], ptr, stream_size );
+	return true;
+}
+
+size_t ME3D_GetRANSDecodedSize( const uint8_t * data, size_t size )
+{
+	if( size < ME3D_RANS_HEADER_SIZE ) return 0;
+	uint32_t decoded_size		= 0;
+	std::memcpy( &decoded_size, data, sizeof( uint32_t ) );
+	return decoded_size;
+}
+
+bool ME3D_DecodeRANS( const uint8_t * data, size_t size, uint8_t * out, size_t out_size )
+{
+	if( size < ME3D_RANS_HEADER_SIZE + 4 ) return false;
+	size_t decoded_size			= ME3D_GetRANSDecodedSize( data, size );
+	if( decoded_size > out_size ) return false;
+
+	uint32_t frequencies[ 256 ] {};
+	uint32_t starts[ 256 ] {};
+	uint8_t symbols[ ME3D_RANS_PROBABILITY_SCALE ];
+	uint32_t start				= 0;
+	for( uint32_t s=0; s < 256; ++s ) {
+		uint16_t frequency		= 0;
+		std::memcpy( &frequency, data + sizeof( uint32_t ) + s * sizeof( uint16_t ), sizeof( uint16_t ) );
+		if( start + frequency > ME3D_RANS_PROBABILITY_SCALE ) return false;
+		frequencies[ s ]		= frequency;
+		starts[ s ]				= start;
+		std::memset( symbols + start, int( s ), frequency );
+		start					+= frequency;
+	}
+	if( start != ME3D_RANS_PROBABILITY_SCALE ) return false;
+
+	const uint8_t * ptr			= data + ME3D_RANS_HEADER_SIZE;
+	const uint8_t * end			= data + size;
+	uint32_t state				= uint32_t( ptr[ 0 ] ) | uint32_t( ptr[ 1 ] ) << 8 | uint32_t( ptr[ 2 ] ) << 16 | uint32_t( ptr[ 3 ] ) << 24;
+	ptr += 4;
+	for( size_t i=0; i < decoded_size; ++i ) {
+		uint32_t slot			= state & ( ME3D_RANS_PROBABILITY_SCALE - 1 );
+		uint8_t symbol			= symbols[ slot ];
+		out[ i ]				= symbol;
+		state					= frequencies[ symbol ] * ( state >> ME3D_RANS_PROBABILITY_BITS ) + slot - starts[ symbol ];
+		while( state < ME3D_RANS_LOWER_BOUND ) {
+			if( ptr >= end ) return false;
+			state				= ( state << 8 ) | *ptr++;
+		}
+	}
+	return ptr == end;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Stream coders used by ME3D version 2 sections.
+//
+// Integer streams are stored interleaved, eg. x, y, z, x, y, z... Each component is
+// delta coded against the same component of the previous element, the deltas are
+// zigzag mapped to unsigned values and written as LEB128 variable length integers.
+// The resulting bytes can additionally be entropy coded with an order-0 rANS coder.
+
+// every value takes at least 1 byte, deltas are 32 bit so never more than this
+constexpr size_t ME3D_DELTA_VARINT_MAX_BYTES			= 5;
+
+// T can be int16_t, uint16_t or int32_t
+template<typename T>
+void ME3D_EncodeDeltaVarint( const T * values, size_t count, size_t components, std::vector<uint8_t> & out );
+
+// returns false if the stream is corrupted or doesn't contain exactly count * components values
+template<typename T>
+bool ME3D_DecodeDeltaVarint( const uint8_t * data, size_t size, T * out, size_t count, size_t components );
+
+// returns false if the data can't be entropy coded, eg. it's empty
+bool ME3D_EncodeRANS( const uint8_t * data, size_t size, std::vector<uint8_t> & out );
+
+// returns the decoded size, out must be at least ME3D_GetRANSDecodedSize() bytes
+size_t ME3D_GetRANSDecodedSize( const uint8_t * data, size_t size );
+bool ME3D_DecodeRANS( const uint8_t * data, size_t size, uint8_t * out, size_t out_size );
@@ -0,0 +1,422 @@
+#include "ME3DDecode.h"
+
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define ME3D_DECODE_SSE2	1
+#include <emmintrin.h>
+#else
+#define ME3D_DECODE_SSE2	0
+#endif
+
+#if ME3D_DECODE_SSE2 && defined( __AVX__ )
+#define ME3D_DECODE_AVX		1
+#include <immintrin.h>
+#else
+#define ME3D_DECODE_AVX		0
+#endif
+
+// SIMD kernels process this many elements at a time, chunks given to threads are multiples of this
+constexpr size_t ME3D_DECODE_BATCH_SIZE						= 4;
+
+// Kernels are picked at compile time, the self check runs each one this build has against the scalar path.
+enum class ME3D_DECODE_KERNEL
+{
+	SCALAR,
+	SSE2,
+	AVX,						// SSE2 with 32 byte vertex stores
+};
+
+#if ME3D_DECODE_AVX
+constexpr ME3D_DECODE_KERNEL ME3D_DECODE_BEST_KERNEL		= ME3D_DECODE_KERNEL::AVX;
+#elif ME3D_DECODE_SSE2
+constexpr ME3D_DECODE_KERNEL ME3D_DECODE_BEST_KERNEL		= ME3D_DECODE_KERNEL::SSE2;
+#else
+constexpr ME3D_DECODE_KERNEL ME3D_DECODE_BEST_KERNEL		= ME3D_DECODE_KERNEL::SCALAR;
+#endif
+
+void ME3D_DecodeParallel( size_t count, const std::function<void( size_t begin, size_t end )> & job )
+{
+	size_t thread_count		= std::thread::hardware_concurrency();
+	if( count < ME3D_DECODE_PARALLEL_THRESHOLD || thread_count < 2 ) {
+		job( 0, count );
+		return;
+	}
+	// don't bother threads with tiny chunks, starting a thread costs more than decoding a few thousand vertices
+	thread_count			= std::min( thread_count, count / ( ME3D_DECODE_PARALLEL_THRESHOLD / 4 ) );
+	size_t chunk_size		= ( count + thread_count - 1 ) / thread_count;
+	chunk_size				= ( chunk_size + ME3D_DECODE_BATCH_SIZE - 1 ) / ME3D_DECODE_BATCH_SIZE * ME3D_DECODE_BATCH_SIZE;
+
+	std::vector<std::thread> workers;
+	workers.reserve( thread_count );
+	for( size_t begin = chunk_size; begin < count; begin += chunk_size ) {
+		size_t end = std::min( begin + chunk_size, count );
+		workers.emplace_back( [ &job, begin, end ]() { job( begin, end ); } );
+	}
+	job( 0, std::min( chunk_size, count ) );
+	for( auto & w : workers ) {
+		w.join();
+	}
+}
+
+template<ME3D_DECODE_KERNEL Kernel>
+void ME3D_ResolveVertexCopiesRange( ME3D_Vertex * vertices, int32_t vertex_count, const ME3D_VertexCopy * copies, size_t begin, size_t end )
+{
+	static_assert( sizeof( ME3D_Vertex ) == 24, "ME3D_Vertex layout changed, update the copy kernel." );
+	for( size_t i = begin; i < end; ++i ) {
+		auto & copy		= copies[ i ];
+		// same as ME3D_DecodeVertexCopiesRange, copies of vertices outside of the mesh are left as they are
+		if( copy.copy_from_index < 0 || copy.copy_from_index >= vertex_count ) continue;
+		auto & src		= vertices[ copy.copy_from_index ];
+		auto & dst		= vertices[ vertex_count + i ];
+#if ME3D_DECODE_SSE2
+		if( ME3D_DECODE_KERNEL::SCALAR != Kernel ) {
+			// position and first 2 normals in one move, last normal comes from the source, uvs and material from the copy
+			_mm_storeu_si128( (__m128i*)&dst, _mm_loadu_si128( (const __m128i*)&src ) );
+			dst.normals[ 2 ]	= src.normals[ 2 ];
+		} else
+#endif
+		{
+			dst.position[ 0 ]	= src.position[ 0 ];
+			dst.position[ 1 ]	= src.position[ 1 ];
+			dst.position[ 2 ]	= src.position[ 2 ];
+			dst.normals[ 0 ]	= src.normals[ 0 ];
+			dst.normals[ 1 ]	= src.normals[ 1 ];
+			dst.normals[ 2 ]	= src.normals[ 2 ];
+		}
+		dst.uvs[ 0 ]			= copy.uvs[ 0 ];
+		dst.uvs[ 1 ]			= copy.uvs[ 1 ];
+		dst.material_index		= copy.material_index;
+	}
+}
+
+void ME3D_ResolveVertexCopies( ME3D_Vertex * vertices, int32_t vertex_count, const ME3D_VertexCopy * copies, int32_t copy_count )
+{
+	if( copy_count <= 0 ) return;
+	ME3D_DecodeParallel( size_t( copy_count ), [ = ]( size_t begin, size_t end ) {
+		ME3D_ResolveVertexCopiesRange<ME3D_DECODE_BEST_KERNEL>( vertices, vertex_count, copies, begin, end );
+	} );
+}
+
+void ME3D_DecodeVertex( Vertex & dst, const ME3D_Vertex & src )
+{
+	dst.position[ 0 ]			= src.position[ 0 ];
+	dst.position[ 1 ]			= src.position[ 1 ];
+	dst.position[ 2 ]			= src.position[ 2 ];
+	dst.color[ 0 ]				= 0.5f;
+	dst.color[ 1 ]				= 0.5f;
+	dst.color[ 2 ]				= 0.5f;
+	dst.uv[ 0 ]					= ME3D_ShortToFloat( src.uvs[ 0 ] );
+	dst.uv[ 1 ]					= ME3D_ShortToFloat( src.uvs[ 1 ] );
+}
+
+#if ME3D_DECODE_SSE2
+
+// converts 4 packed uv pairs, returns { u0, v0, u1, v1 } and { u2, v2, u3, v3 }
+// uvs are treated as unsigned 16 bit values to match ME3D_ShortToFloat() exactly
+inline void ME3D_DecodeUVs4( const uint32_t packed_uvs[ 4 ], __m128 & uv01, __m128 & uv23 )
+{
+	const __m128i	zero			= _mm_setzero_si128();
+	const __m128	short_to_float	= _mm_set1_ps( ME3D_SHORT_TO_FLOAT );
+	__m128i			uvs				= _mm_loadu_si128( (const __m128i*)packed_uvs );
+	uv01			= _mm_mul_ps( _mm_cvtepi32_ps( _mm_unpacklo_epi16( uvs, zero ) ), short_to_float );
+	uv23			= _mm_mul_ps( _mm_cvtepi32_ps( _mm_unpackhi_epi16( uvs, zero ) ), short_to_float );
+}
+
+// writes a full 32 byte Vertex from its two halves: { position, color r } and { color g, color b, uv }
+template<ME3D_DECODE_KERNEL Kernel>
+inline void ME3D_StoreVertex( Vertex & dst, __m128 head, __m128 tail )
+{
+	static_assert( sizeof( Vertex ) == 32, "Vertex layout changed, update the decode kernels." );
+#if ME3D_DECODE_AVX
+	if( ME3D_DECODE_KERNEL::AVX == Kernel ) {
+		_mm256_storeu_ps( (float*)&dst, _mm256_insertf128_ps( _mm256_castps128_ps256( head ), tail, 1 ) );
+		return;
+	}
+#endif
+	_mm_storeu_ps( (float*)&dst, head );
+	_mm_storeu_ps( (float*)&dst + 4, tail );
+}
+
+#endif // ME3D_DECODE_SSE2
+
+template<ME3D_DECODE_KERNEL Kernel>
+void ME3D_DecodeVerticesRange( Vertex * dst, const ME3D_Vertex * src, size_t begin, size_t end )
+{
+	size_t i = begin;
+#if ME3D_DECODE_SSE2
+	const __m128	half			= _mm_set1_ps( 0.5f );
+	const __m128	half_w			= _mm_set_ps( 0.5f, 0.0f, 0.0f, 0.0f );
+	const __m128	position_mask	= _mm_castsi128_ps( _mm_set_epi32( 0, -1, -1, -1 ) );
+	for( ; ME3D_DECODE_KERNEL::SCALAR != Kernel && i + ME3D_DECODE_BATCH_SIZE <= end; i += ME3D_DECODE_BATCH_SIZE ) {
+		uint32_t packed_uvs[ 4 ];
+		for( size_t k=0; k < 4; ++k ) {
+			std::memcpy( &packed_uvs[ k ], src[ i + k ].uvs, sizeof( uint32_t ) );
+		}
+		__m128 uv01, uv23;
+		ME3D_DecodeUVs4( packed_uvs, uv01, uv23 );
+
+		__m128 tails[ 4 ] = {
+			_mm_movelh_ps( half, uv01 ),
+			_mm_movehl_ps( uv01, half ),
+			_mm_movelh_ps( half, uv23 ),
+			_mm_movehl_ps( uv23, half ),
+		};
+		for( size_t k=0; k < 4; ++k ) {
+			// loads 4 floats, the last one is actually the first normals, masked away and replaced with color
+			__m128 head = _mm_or_ps( _mm_and_ps( _mm_loadu_ps( src[ i + k ].position ), position_mask ), half_w );
+			ME3D_StoreVertex<Kernel>( dst[ i + k ], head, tails[ k ] );
+		}
+	}
+#endif
+	for( ; i < end; ++i ) {
+		ME3D_DecodeVertex( dst[ i ], src[ i ] );
+	}
+}
+
+void ME3D_DecodeVertices( Vertex * dst, const ME3D_View<ME3D_Vertex> & src )
+{
+	auto data = src.Data();
+	if( nullptr != data ) {
+		ME3D_DecodeParallel( src.Size(), [ = ]( size_t begin, size_t end ) {
+			ME3D_DecodeVerticesRange<ME3D_DECODE_BEST_KERNEL>( dst, data, begin, end );
+		} );
+	} else {
+		// records are padded differently from ours, go through them one at a time
+		ME3D_DecodeParallel( src.Size(), [ dst, &src ]( size_t begin, size_t end ) {
+			for( size_t i = begin; i < end; ++i ) {
+				ME3D_DecodeVertex( dst[ i ], src.Get( i ) );
+			}
+		} );
+	}
+}
+
+template<ME3D_DECODE_KERNEL Kernel>
+void ME3D_DecodeVertexCopiesRange( Vertex * dst, size_t vertex_count, const ME3D_View<ME3D_VertexCopy> & copies, size_t begin, size_t end )
+{
+	auto IsValid = [ vertex_count ]( const ME3D_VertexCopy & copy ) {
+		return copy.copy_from_index >= 0 && size_t( copy.copy_from_index ) < vertex_count;
+	};
+
+	size_t i = begin;
+#if ME3D_DECODE_SSE2
+	for( ; ME3D_DECODE_KERNEL::SCALAR != Kernel && i + ME3D_DECODE_BATCH_SIZE <= end; i += ME3D_DECODE_BATCH_SIZE ) {
+		ME3D_VertexCopy batch[ 4 ] = { copies.Get( i ), copies.Get( i + 1 ), copies.Get( i + 2 ), copies.Get( i + 3 ) };
+		if( !IsValid( batch[ 0 ] ) || !IsValid( batch[ 1 ] ) || !IsValid( batch[ 2 ] ) || !IsValid( batch[ 3 ] ) ) break;
+
+		uint32_t packed_uvs[ 4 ];
+		for( size_t k=0; k < 4; ++k ) {
+			std::memcpy( &packed_uvs[ k ], batch[ k ].uvs, sizeof( uint32_t ) );
+		}
+		__m128 uv01, uv23;
+		ME3D_DecodeUVs4( packed_uvs, uv01, uv23 );
+
+		__m128 uvs[ 4 ] = { uv01, uv01, uv23, uv23 };
+		for( size_t k=0; k < 4; ++k ) {
+			const float * src	= (const float*)&dst[ batch[ k ].copy_from_index ];
+			__m128 head			= _mm_loadu_ps( src );
+			__m128 tail			= _mm_loadu_ps( src + 4 );
+			// keep source colors, replace uvs with the copy's own
+			tail				= ( k & 1 ) ? _mm_shuffle_ps( tail, uvs[ k ], _MM_SHUFFLE( 3, 2, 1, 0 ) ) : _mm_shuffle_ps( tail, uvs[ k ], _MM_SHUFFLE( 1, 0, 1, 0 ) );
+			ME3D_StoreVertex<Kernel>( dst[ vertex_count + i + k ], head, tail );
+		}
+	}
+#endif
+	for( ; i < end; ++i ) {
+		auto copy = copies.Get( i );
+		if( !IsValid( copy ) ) continue;
+		auto & out = dst[ vertex_count + i ];
+		out				= dst[ copy.copy_from_index ];
+		out.uv[ 0 ]		= ME3D_ShortToFloat( copy.uvs[ 0 ] );
+		out.uv[ 1 ]		= ME3D_ShortToFloat( copy.uvs[ 1 ] );
+	}
+}
+
+void ME3D_DecodeVertexCopies( Vertex * dst, size_t vertex_count, const ME3D_View<ME3D_VertexCopy> & copies )
+{
+	ME3D_DecodeParallel( copies.Size(), [ dst, vertex_count, &copies ]( size_t begin, size_t end ) {
+		ME3D_DecodeVertexCopiesRange<ME3D_DECODE_BEST_KERNEL>( dst, vertex_count, copies, begin, end );
+	} );
+}
+
+// Vertices and copies of one mesh for the self check, in arrays of our own so every kernel reads the same memory
+struct ME3D_DecodeCheckData
+{
+	std::vector<ME3D_Vertex>		vertices;
+	std::vector<ME3D_VertexCopy>	copies;
+};
+
+// covers tails, worker threads, every uv bit pattern worth testing and copies pointing outside of the mesh
+void ME3D_DecodeCheck_Generate( ME3D_DecodeCheckData & data )
+{
+	size_t vertex_count		= ME3D_DECODE_PARALLEL_THRESHOLD * 3 + 3;
+	size_t copy_count		= ME3D_DECODE_PARALLEL_THRESHOLD * 2 + 1;
+	const int16_t edge_uvs[]	= { 0, 1, -1, INT16_MAX, INT16_MIN, 0x7FFE, -2 };
+
+	std::mt19937 generator( 2 );
+	std::uniform_real_distribution<float> position( -1000.0f, 1000.0f );
+	std::uniform_int_distribution<int> short_value( INT16_MIN, INT16_MAX );
+	std::uniform_int_distribution<int> edge_uv( 0, int( sizeof( edge_uvs ) / sizeof( edge_uvs[ 0 ] ) ) - 1 );
+	std::uniform_int_distribution<int32_t> copy_from( -16, int32_t( vertex_count ) + 16 );
+
+	data.vertices.resize( vertex_count );
+	for( size_t i=0; i < vertex_count; ++i ) {
+		auto & v			= data.vertices[ i ];
+		for( int c=0; c < 3; ++c ) {
+			v.position[ c ]	= position( generator );
+			v.normals[ c ]	= int16_t( short_value( generator ) );
+		}
+		for( int c=0; c < 2; ++c ) {
+			v.uvs[ c ]		= int16_t( i % 8 == 0 ? edge_uvs[ edge_uv( generator ) ] : short_value( generator ) );
+		}
+		v.material_index	= int16_t( short_value( generator ) );
+	}
+	data.copies.resize( copy_count );
+	for( size_t i=0; i < copy_count; ++i ) {
+		auto & c			= data.copies[ i ];
+		c.copy_from_index	= copy_from( generator );
+		c.uvs[ 0 ]			= int16_t( short_value( generator ) );
+		c.uvs[ 1 ]			= int16_t( short_value( generator ) );
+		c.material_index	= int16_t( short_value( generator ) );
+	}
+}
+
+bool ME3D_DecodeCheck_Load( const std::string & path, ME3D_DecodeCheckData & data )
+{
+	ME3D_MappedFile file( path );
+	if( !file.IsOpen() ) return false;
+	auto vertices			= file.GetVertices();
+	auto copies				= file.GetCopyVertices();
+	if( 0 == vertices.Size() ) return false;
+	data.vertices.resize( vertices.Size() );
+	for( size_t i=0; i < vertices.Size(); ++i ) data.vertices[ i ] = vertices.Get( i );
+	data.copies.resize( copies.Size() );
+	for( size_t i=0; i < copies.Size(); ++i ) data.copies[ i ] = copies.Get( i );
+	return true;
+}
+
+// one way of decoding a mesh, mesh vertices first and their copies behind them
+typedef std::function<void( const ME3D_DecodeCheckData & data, Vertex * dst )> ME3D_DecodeCheckPath;
+
+template<ME3D_DECODE_KERNEL Kernel>
+void ME3D_DecodeCheck_DecodeWith( const ME3D_DecodeCheckData & data, Vertex * dst )
+{
+	ME3D_View<ME3D_VertexCopy> copies( (const uint8_t*)data.copies.data(), data.copies.size(), sizeof( ME3D_VertexCopy ) );
+	ME3D_DecodeVerticesRange<Kernel>( dst, data.vertices.data(), 0, data.vertices.size() );
+	ME3D_DecodeVertexCopiesRange<Kernel>( dst, data.vertices.size(), copies, 0, data.copies.size() );
+}
+
+// compares every kernel to ME3D_DecodeVertex, untouched vertices ( invalid copies ) have to stay untouched too
+bool ME3D_DecodeCheck_Compare( const ME3D_DecodeCheckData & data, const ME3D_DecodeCheckPath & path )
+{
+	size_t count		= data.vertices.size() + data.copies.size();
+	std::vector<Vertex> expected( count );
+	std::vector<Vertex> decoded( count );
+	std::memset( expected.data(), 0xCD, count * sizeof( Vertex ) );
+	std::memset( decoded.data(), 0xCD, count * sizeof( Vertex ) );
+
+	for( size_t i=0; i < data.vertices.size(); ++i ) {
+		ME3D_DecodeVertex( expected[ i ], data.vertices[ i ] );
+	}
+	for( size_t i=0; i < data.copies.size(); ++i ) {
+		auto & copy		= data.copies[ i ];
+		if( copy.copy_from_index < 0 || size_t( copy.copy_from_index ) >= data.vertices.size() ) continue;
+		auto & out		= expected[ data.vertices.size() + i ];
+		out				= expected[ copy.copy_from_index ];
+		out.uv[ 0 ]		= ME3D_ShortToFloat( copy.uvs[ 0 ] );
+		out.uv[ 1 ]		= ME3D_ShortToFloat( copy.uvs[ 1 ] );
+	}
+
+	path( data, decoded.data() );
+	return 0 == std::memcmp( expected.data(), decoded.data(), count * sizeof( Vertex ) );
+}
+
+template<ME3D_DECODE_KERNEL Kernel>
+void ME3D_DecodeCheck_ResolveWith( ME3D_Vertex * vertices, int32_t vertex_count, const ME3D_VertexCopy * copies, int32_t copy_count )
+{
+	ME3D_ResolveVertexCopiesRange<Kernel>( vertices, vertex_count, copies, 0, size_t( copy_count ) );
+}
+
+typedef void ( *ME3D_DecodeCheckResolvePath )( ME3D_Vertex * vertices, int32_t vertex_count, const ME3D_VertexCopy * copies, int32_t copy_count );
+
+bool ME3D_DecodeCheck_CompareResolve( const ME3D_DecodeCheckData & data, ME3D_DecodeCheckResolvePath path )
+{
+	auto & copies			= data.copies;
+	std::vector<ME3D_Vertex> expected( data.vertices );
+	expected.resize( data.vertices.size() + copies.size() );
+	std::vector<ME3D_Vertex> resolved( expected );
+	int32_t vertex_count	= int32_t( data.vertices.size() );
+	ME3D_ResolveVertexCopiesRange<ME3D_DECODE_KERNEL::SCALAR>( expected.data(), vertex_count, copies.data(), 0, copies.size() );
+	path( resolved.data(), vertex_count, copies.data(), int32_t( copies.size() ) );
+	return 0 == std::memcmp( expected.data(), resolved.data(), expected.size() * sizeof( ME3D_Vertex ) );
+}
+
+int RunME3DDecodeCheck( const std::vector<std::string> & paths, std::ostream & report )
+{
+	struct NamedPath
+	{
+		const char				*	name;
+		ME3D_DecodeCheckPath		path;
+	};
+	struct NamedResolvePath
+	{
+		const char				*	name;
+		ME3D_DecodeCheckResolvePath	path;
+	};
+	std::vector<NamedPath> decode_paths;
+	std::vector<NamedResolvePath> resolve_paths;
+#if ME3D_DECODE_SSE2
+	decode_paths.push_back( { "sse2", ME3D_DecodeCheck_DecodeWith<ME3D_DECODE_KERNEL::SSE2> } );
+	resolve_paths.push_back( { "resolve_sse2", ME3D_DecodeCheck_ResolveWith<ME3D_DECODE_KERNEL::SSE2> } );
+#endif
+#if ME3D_DECODE_AVX
+	decode_paths.push_back( { "avx", ME3D_DecodeCheck_DecodeWith<ME3D_DECODE_KERNEL::AVX> } );
+#endif
+	// the public functions, worker threads with the best kernel
+	decode_paths.push_back( { "threaded", []( const ME3D_DecodeCheckData & data, Vertex * dst ) {
+		ME3D_View<ME3D_Vertex> vertices( (const uint8_t*)data.vertices.data(), data.vertices.size(), sizeof( ME3D_Vertex ) );
+		ME3D_View<ME3D_VertexCopy> copies( (const uint8_t*)data.copies.data(), data.copies.size(), sizeof( ME3D_VertexCopy ) );
+		ME3D_DecodeVertices( dst, vertices );
+		ME3D_DecodeVertexCopies( dst, data.vertices.size(), copies );
+	} } );
+	resolve_paths.push_back( { "resolve_threaded", ME3D_ResolveVertexCopies } );
+
+	int failures = 0;
+	auto Check = [ & ]( const std::string & name, const ME3D_DecodeCheckData & data ) {
+		for( auto & p : decode_paths ) {
+			bool matches	= ME3D_DecodeCheck_Compare( data, p.path );
+			report << name << "," << p.name << "," << data.vertices.size() << "," << data.copies.size() << "," << ( matches ? "match" : "MISMATCH" ) << std::endl;
+			if( !matches ) ++failures;
+		}
+		// resolving copies in ME3D_Vertex form only has an SSE2 kernel
+		for( auto & p : resolve_paths ) {
+			bool matches	= ME3D_DecodeCheck_CompareResolve( data, p.path );
+			report << name << "," << p.name << "," << data.vertices.size() << "," << data.copies.size() << "," << ( matches ? "match" : "MISMATCH" ) << std::endl;
+			if( !matches ) ++failures;
+		}
+	};
+
+	report << "# compared to ME3D_DecodeVertex bit for bit, widest kernel in this build: "
+		<< ( ME3D_DECODE_KERNEL::AVX == ME3D_DECODE_BEST_KERNEL ? "AVX" : ME3D_DECODE_KERNEL::SSE2 == ME3D_DECODE_BEST_KERNEL ? "SSE2" : "scalar" ) << std::endl;
+	report << "data,path,vertices,copies,result" << std::endl;
+
+	ME3D_DecodeCheckData synthetic;
+	ME3D_DecodeCheck_Generate( synthetic );
+	Check( "synthetic", synthetic );
+	for( auto & path : paths ) {
+		ME3D_DecodeCheckData model;
+		if( !ME3D_DecodeCheck_Load( path, model ) ) {
+			report << "# couldn't load version 1 vertices from " << path << std::endl;
+			++failures;
+			continue;
+		}
+		Check( path, model );
+	}
+	return failures;
+}
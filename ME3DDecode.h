@@ -0,0 +1,34 @@
+#pragma once
+
+#include "ME3DFile.h"
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct Vertex;
+
+// Meshes with fewer elements than this are decoded on the calling thread,
+// larger ones are split into chunks and spread over worker threads.
+constexpr size_t ME3D_DECODE_PARALLEL_THRESHOLD			= 1 << 16;
+
+// Calls job( begin, end ) for sub ranges of [ 0, count ), in parallel if count is large enough.
+void ME3D_DecodeParallel( size_t count, const std::function<void( size_t begin, size_t end )> & job );
+
+// Fills vertices[ vertex_count + i ] from copies[ i ] and the vertex it copies,
+// copies of vertices outside of [ 0, vertex_count ) are skipped.
+void ME3D_ResolveVertexCopies( ME3D_Vertex * vertices, int32_t vertex_count, const ME3D_VertexCopy * copies, int32_t copy_count );
+
+// Converts ME3D vertices into the final mesh vertex format.
+void ME3D_DecodeVertices( Vertex * dst, const ME3D_View<ME3D_Vertex> & src );
+
+// Same as ME3D_ResolveVertexCopies but for already decoded mesh vertices,
+// dst[ 0 .. vertex_count ) must have been decoded before calling this.
+void ME3D_DecodeVertexCopies( Vertex * dst, size_t vertex_count, const ME3D_View<ME3D_VertexCopy> & copies );
+
+// Decodes synthetic vertices and the version 1 models in paths with every SIMD kernel this build has and
+// with worker threads, and compares the results bit for bit with ME3D_DecodeVertex. Results are written to
+// report as CSV: data,path,vertices,copies,result. Returns the number of mismatches and unloadable files.
+int RunME3DDecodeCheck( const std::vector<std::string> & paths, std::ostream & report );
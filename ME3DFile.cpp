@@ -1,12 +1,26 @@
 #include "ME3DFile.h"
+#include "ME3DDecode.h"
+#include "ME3DCompression.h"
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <assert.h>
 
-constexpr uint32_t ME3D_FILE_ID						= 1144210765;
+#if defined( _WIN32 )
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-constexpr float ME3D_FLOAT_TO_SHORT					= 32767.0f;
-constexpr float ME3D_SHORT_TO_FLOAT					= 1 / ME3D_FLOAT_TO_SHORT;
+constexpr uint32_t ME3D_FILE_ID						= 1144210765;		// "ME3D"
+constexpr uint32_t ME3D_FILE_ID_V2					= 842220877;		// "ME32"
+constexpr int32_t ME3D_VERSION_2					= 2;
+
+constexpr float ME3D_POSITION_QUANTIZATION_MAX		= 65535.0f;
 
 typedef		uint16_t		me3d_str_size_t;		// 16 bits is enough to handle character strings used by me3d
 
@@ -34,6 +48,169 @@ std::string ME3D_ReadString( std::ifstream * file )
 	return str;
 }
 
+// reads a string written by ME3D_WriteString from memory, advances data past it
+std::string ME3D_ReadString( const uint8_t ** data, const uint8_t * end )
+{
+	assert( nullptr != data );
+
+	me3d_str_size_t		str_size		= 0;
+	if( size_t( end - *data ) < sizeof( me3d_str_size_t ) ) return std::string();
+	std::memcpy( &str_size, *data, sizeof( me3d_str_size_t ) );
+	*data += sizeof( me3d_str_size_t );
+	if( size_t( end - *data ) < str_size ) str_size = me3d_str_size_t( end - *data );
+	std::string			str( (const char*)*data, str_size );
+	*data += str_size;
+
+	return str;
+}
+
+bool ME3D_ValidateHeader( const ME3D_Header & head, size_t file_size )
+{
+	if( ME3D_FILE_ID != head.file_id )						return false;
+	if( head.file_size != file_size )						return false;
+	if( head.head_size != sizeof( ME3D_Header ) )			return false;
+	if( head.vert_size > sizeof( ME3D_Vertex ) )			return false;
+	if( head.vert_copy_size > sizeof( ME3D_VertexCopy ) )	return false;
+	if( head.polygon_size > sizeof( ME3D_Polygon ) )		return false;
+	// if we got here we can be pretty sure we are reading a compatible file
+	return true;
+}
+
+bool ME3D_ValidateHeaderV2( const ME3D_HeaderV2 & head, size_t file_size )
+{
+	if( ME3D_FILE_ID_V2 != head.file_id )					return false;
+	if( head.file_size != file_size )						return false;
+	if( head.head_size != sizeof( ME3D_HeaderV2 ) )			return false;
+	if( head.version != ME3D_VERSION_2 )					return false;
+	if( head.vert_count < 0 || head.polygon_count < 0 )		return false;
+	if( head.section_count < 0 )							return false;
+	if( head.section_table_location < 0 )					return false;
+	if( head.section_table_location % alignof( ME3D_Section ) != 0 )	return false;
+	if( size_t( head.section_table_location ) + size_t( head.section_count ) * sizeof( ME3D_Section ) > file_size )	return false;
+	return true;
+}
+
+int32_t ME3D_GetFileVersion( const uint8_t * data, size_t size )
+{
+	int32_t file_id = 0;
+	if( size < sizeof( ME3D_Header ) ) return 0;
+	std::memcpy( &file_id, data, sizeof( file_id ) );
+	if( ME3D_FILE_ID == file_id ) return 1;
+	if( ME3D_FILE_ID_V2 == file_id ) {
+		int32_t version = 0;
+		std::memcpy( &version, data + 3 * sizeof( int32_t ), sizeof( version ) );		// ME3D_HeaderV2::version
+		return version;
+	}
+	return 0;
+}
+
+bool ME3D_MakeHeader( ME3D_Header * head, size_t vert_count, size_t vert_size, size_t vert_copy_count, size_t vert_copy_size, size_t polygon_count, size_t polygon_size )
+{
+	assert( nullptr != head );
+	assert( vert_size <= sizeof( ME3D_Vertex ) && vert_copy_size <= sizeof( ME3D_VertexCopy ) && polygon_size <= sizeof( ME3D_Polygon ) );
+
+	size_t vert_location		= sizeof( ME3D_Header );
+	size_t vert_copy_location	= vert_location + vert_count * vert_size;
+	size_t polygon_location		= vert_copy_location + vert_copy_count * vert_copy_size;
+	size_t file_size			= polygon_location + polygon_count * polygon_size;
+	if( file_size > size_t( INT32_MAX ) ) return false;
+
+	*head						= {};
+	head->file_id				= ME3D_FILE_ID;
+	head->head_size				= int32_t( sizeof( ME3D_Header ) );
+	head->file_size				= int32_t( file_size );
+	head->vert_count			= int32_t( vert_count );
+	head->vert_size				= int32_t( vert_size );
+	head->vert_location			= int32_t( vert_location );
+	head->vert_copy_count		= int32_t( vert_copy_count );
+	head->vert_copy_size		= int32_t( vert_copy_size );
+	head->vert_copy_location	= int32_t( vert_copy_location );
+	head->polygon_count			= int32_t( polygon_count );
+	head->polygon_size			= int32_t( polygon_size );
+	head->polygon_location		= int32_t( polygon_location );
+	return true;
+}
+
+// layout of the decoded data of each section type
+bool ME3D_GetSectionFormat( ME3D_SECTION_TYPE type, size_t * components, size_t * value_size )
+{
+	switch( type ) {
+	case ME3D_SECTION_TYPE::POSITIONS:
+		*components		= 3;
+		*value_size		= sizeof( uint16_t );
+		return true;
+	case ME3D_SECTION_TYPE::NORMALS:
+		*components		= 3;
+		*value_size		= sizeof( int16_t );
+		return true;
+	case ME3D_SECTION_TYPE::UVS:
+		*components		= 2;
+		*value_size		= sizeof( int16_t );
+		return true;
+	case ME3D_SECTION_TYPE::MATERIALS:
+		*components		= 1;
+		*value_size		= sizeof( int16_t );
+		return true;
+	case ME3D_SECTION_TYPE::INDICES:
+		*components		= 3;
+		*value_size		= sizeof( int32_t );
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool ME3D_DecodeSectionValues( ME3D_SECTION_TYPE type, const uint8_t * src, size_t src_size, void * dst, size_t element_count )
+{
+	switch( type ) {
+	case ME3D_SECTION_TYPE::POSITIONS:
+		return ME3D_DecodeDeltaVarint( src, src_size, (uint16_t*)dst, element_count, 3 );
+	case ME3D_SECTION_TYPE::NORMALS:
+		return ME3D_DecodeDeltaVarint( src, src_size, (int16_t*)dst, element_count, 3 );
+	case ME3D_SECTION_TYPE::UVS:
+		return ME3D_DecodeDeltaVarint( src, src_size, (int16_t*)dst, element_count, 2 );
+	case ME3D_SECTION_TYPE::MATERIALS:
+		return ME3D_DecodeDeltaVarint( src, src_size, (int16_t*)dst, element_count, 1 );
+	case ME3D_SECTION_TYPE::INDICES:
+		return ME3D_DecodeDeltaVarint( src, src_size, (int32_t*)dst, element_count, 3 );
+	default:
+		return false;
+	}
+}
+
+// picks the smallest of the available encodings for a stream
+template<typename T>
+void ME3D_EncodeSection( ME3D_SECTION_TYPE type, const std::vector<T> & values, size_t element_count, ME3D_Section * section, std::vector<uint8_t> * payload )
+{
+	// from the format and not from the values, empty meshes still get a valid section
+	size_t components		= 0;
+	size_t value_size		= 0;
+	bool known_format		= ME3D_GetSectionFormat( type, &components, &value_size );
+	assert( known_format && sizeof( T ) == value_size && values.size() == element_count * components );
+	size_t raw_size			= values.size() * sizeof( T );
+
+	std::vector<uint8_t> delta;
+	ME3D_EncodeDeltaVarint( values.data(), element_count, components, delta );
+	std::vector<uint8_t> entropy;
+	bool has_entropy		= ME3D_EncodeRANS( delta.data(), delta.size(), entropy );
+
+	section->type			= type;
+	section->decoded_size	= int32_t( raw_size );
+	section->element_count	= int32_t( element_count );
+	if( has_entropy && entropy.size() < delta.size() && entropy.size() < raw_size ) {
+		section->encoding	= ME3D_SECTION_ENCODING::DELTA_VARINT_RANS;
+		*payload			= std::move( entropy );
+	} else if( delta.size() < raw_size ) {
+		section->encoding	= ME3D_SECTION_ENCODING::DELTA_VARINT;
+		*payload			= std::move( delta );
+	} else {
+		section->encoding	= ME3D_SECTION_ENCODING::RAW;
+		payload->resize( raw_size );
+		if( raw_size ) std::memcpy( payload->data(), values.data(), raw_size );
+	}
+	section->byte_size		= int32_t( payload->size() );
+}
+
 void ME3D_WriteString( std::ofstream * file, std::string str )
 {
 	assert( nullptr != file );
@@ -75,13 +252,13 @@ bool ME3D_File::Load( std::string path )
 	file.seekg( 0 );
 	file.read( (char*)&head, sizeof( head ) );
 
-	if( ME3D_FILE_ID != head.file_id )						return false;
-	if( head.file_size != file_size )						return false;
-	if( head.head_size != sizeof( ME3D_Header ) )			return false;
-	if( head.vert_size > sizeof( ME3D_Vertex ) )			return false;
-	if( head.vert_copy_size > sizeof( ME3D_VertexCopy ) )	return false;
-	if( head.polygon_size > sizeof( ME3D_Polygon ) )		return false;
-	// if we got here we can be pretty sure we are reading a compatible file
+	// version 2 files are read through memory mapping, sections are decoded straight from there
+	if( ME3D_FILE_ID_V2 == head.file_id ) {
+		file.close();
+		return _LoadV2( path );
+	}
+
+	if( !ME3D_ValidateHeader( head, file_size ) )			return false;
 
 	// we can check the padding of the data
 	bool aligned_vertices		= false;
@@ -121,23 +298,205 @@ bool ME3D_File::Load( std::string path )
 
 	// we also need to calculate the copy vertices, but those
 	// take the coordinates of the the vertext it's copying
-	for( int32_t i=0; i < head.vert_copy_count; ++i ) {
-		int32_t dst_index = head.vert_count + i;
-		vertices[ dst_index ].position[ 0 ]			= vertices[ vertex_copies[ i ].copy_from_index ].position[ 0 ];
-		vertices[ dst_index ].position[ 1 ]			= vertices[ vertex_copies[ i ].copy_from_index ].position[ 1 ];
-		vertices[ dst_index ].position[ 2 ]			= vertices[ vertex_copies[ i ].copy_from_index ].position[ 2 ];
-		vertices[ dst_index ].normals[ 0 ]			= vertices[ vertex_copies[ i ].copy_from_index ].normals[ 0 ];
-		vertices[ dst_index ].normals[ 1 ]			= vertices[ vertex_copies[ i ].copy_from_index ].normals[ 1 ];
-		vertices[ dst_index ].normals[ 2 ]			= vertices[ vertex_copies[ i ].copy_from_index ].normals[ 2 ];
-		vertices[ dst_index ].uvs[ 0 ]				= vertex_copies[ i ].uvs[ 0 ];
-		vertices[ dst_index ].uvs[ 1 ]				= vertex_copies[ i ].uvs[ 1 ];
-		vertices[ dst_index ].material_index		= vertex_copies[ i ].material_index;
-	}
+	ME3D_ResolveVertexCopies( vertices.data(), head.vert_count, vertex_copies.data(), head.vert_copy_count );
 
 	is_loaded	= true;
 	return		true;
 }
 
+// writes a version 2 file, section locations and file size are filled in here, metadata is written last
+bool ME3D_WriteVersion2( std::string path, ME3D_HeaderV2 head_v2, std::vector<ME3D_Section> sections, const std::vector<std::vector<uint8_t>> & payloads, const std::vector<ME3D_MetaData> & metadata )
+{
+	assert( sections.size() == payloads.size() );
+
+	// metadata is written as strings directly into the file, we only need to know how big it'll be
+	if( metadata.size() ) {
+		ME3D_Section metadata_section {};
+		metadata_section.type			= ME3D_SECTION_TYPE::METADATA;
+		metadata_section.encoding		= ME3D_SECTION_ENCODING::RAW;
+		metadata_section.element_count	= int32_t( metadata.size() );
+		metadata_section.byte_size		= int32_t( sizeof( int32_t ) );
+		for( auto & m : metadata ) {
+			metadata_section.byte_size	+= int32_t( 2 * sizeof( me3d_str_size_t ) + m.identifier.size() + m.data.size() );
+		}
+		metadata_section.decoded_size	= metadata_section.byte_size;
+		sections.push_back( metadata_section );
+	}
+
+	// lay out the sections after the section table, each one 4 byte aligned
+	head_v2.section_count			= int32_t( sections.size() );
+	head_v2.section_table_location	= int32_t( sizeof( ME3D_HeaderV2 ) );
+	size_t location					= sizeof( ME3D_HeaderV2 ) + sections.size() * sizeof( ME3D_Section );
+	for( auto & s : sections ) {
+		location					= ( location + 3 ) & ~size_t( 3 );
+		s.location					= int32_t( location );
+		location					+= size_t( s.byte_size );
+	}
+	if( location > size_t( INT32_MAX ) ) return false;
+	head_v2.file_size				= int32_t( location );
+
+	std::ofstream file( path, std::ofstream::binary | std::ofstream::trunc );
+	if( !file.is_open() ) return false;
+
+	file.write( (const char*)&head_v2, sizeof( head_v2 ) );
+	file.write( (const char*)sections.data(), sections.size() * sizeof( ME3D_Section ) );
+	for( size_t i=0; i < sections.size(); ++i ) {
+		const char padding[ 4 ] {};
+		file.write( padding, sections[ i ].location - std::streamoff( file.tellp() ) );
+		if( ME3D_SECTION_TYPE::METADATA == sections[ i ].type ) {
+			int32_t count = int32_t( metadata.size() );
+			file.write( (const char*)&count, sizeof( count ) );
+			for( auto & m : metadata ) {
+				ME3D_WriteString( &file, m.identifier );
+				ME3D_WriteString( &file, m.data );
+			}
+		} else {
+			file.write( (const char*)payloads[ i ].data(), payloads[ i ].size() );
+		}
+	}
+	return file.good();
+}
+
+bool ME3D_SaveCooked( std::string path, const void * vertices, size_t vertex_count, size_t vertex_stride, const void * indices, size_t index_count, size_t index_size,
+	const void * clusters, size_t cluster_count, size_t cluster_size, const std::vector<ME3D_MetaData> & metadata )
+{
+	ME3D_HeaderV2 head_v2 {};
+	head_v2.file_id			= ME3D_FILE_ID_V2;
+	head_v2.head_size		= sizeof( ME3D_HeaderV2 );
+	head_v2.version			= ME3D_VERSION_2;
+	head_v2.vert_count		= int32_t( vertex_count );
+	head_v2.polygon_count	= int32_t( index_count / 3 );
+
+	std::vector<ME3D_Section>			sections( 3 );
+	std::vector<std::vector<uint8_t>>	payloads( 3 );
+	sections[ 0 ].type				= ME3D_SECTION_TYPE::GPU_VERTICES;
+	sections[ 0 ].encoding			= ME3D_SECTION_ENCODING::RAW;
+	sections[ 0 ].element_count		= int32_t( vertex_count );
+	sections[ 0 ].decoded_size		= int32_t( vertex_count * vertex_stride );
+	sections[ 0 ].byte_size			= sections[ 0 ].decoded_size;
+	payloads[ 0 ].assign( (const uint8_t*)vertices, (const uint8_t*)vertices + vertex_count * vertex_stride );
+
+	sections[ 1 ].type				= ME3D_SECTION_TYPE::GPU_INDICES;
+	sections[ 1 ].encoding			= ME3D_SECTION_ENCODING::RAW;
+	sections[ 1 ].element_count		= int32_t( index_count );
+	sections[ 1 ].decoded_size		= int32_t( index_count * index_size );
+	sections[ 1 ].byte_size			= sections[ 1 ].decoded_size;
+	payloads[ 1 ].assign( (const uint8_t*)indices, (const uint8_t*)indices + index_count * index_size );
+
+	sections[ 2 ].type				= ME3D_SECTION_TYPE::GPU_CLUSTERS;
+	sections[ 2 ].encoding			= ME3D_SECTION_ENCODING::RAW;
+	sections[ 2 ].element_count		= int32_t( cluster_count );
+	sections[ 2 ].decoded_size		= int32_t( cluster_count * cluster_size );
+	sections[ 2 ].byte_size			= sections[ 2 ].decoded_size;
+	payloads[ 2 ].assign( (const uint8_t*)clusters, (const uint8_t*)clusters + cluster_count * cluster_size );
+
+	return ME3D_WriteVersion2( path, head_v2, sections, payloads, metadata );
+}
+
+
+bool ME3D_File::_LoadV2( std::string path )
+{
+	ME3D_MappedFile file( path );
+	if( !file.IsOpen() || file.GetVersion() != ME3D_VERSION_2 ) return false;
+
+	auto & head_v2		= file.GetHeaderV2();
+	size_t vert_count	= size_t( head_v2.vert_count );
+
+	// positions and indices are required, everything else is optional. Opening checked that the
+	// sections match the counts in the header, without them nothing vouches for the counts
+	if( !file.FindSection( ME3D_SECTION_TYPE::POSITIONS ) || !file.FindSection( ME3D_SECTION_TYPE::INDICES ) )			return false;
+	std::vector<uint16_t>	positions( vert_count * 3 );
+	std::vector<int16_t>	normals( vert_count * 3 );
+	std::vector<int16_t>	uvs( vert_count * 2 );
+	std::vector<int16_t>	materials( vert_count );
+	polygons.resize( head_v2.polygon_count );
+	if( !file.DecodeSection( ME3D_SECTION_TYPE::POSITIONS, positions.data(), positions.size() * sizeof( uint16_t ) ) )			return false;
+	if( !file.DecodeSection( ME3D_SECTION_TYPE::INDICES, polygons.data(), polygons.size() * sizeof( ME3D_Polygon ) ) )			return false;
+	if( file.FindSection( ME3D_SECTION_TYPE::NORMALS ) ) {
+		if( !file.DecodeSection( ME3D_SECTION_TYPE::NORMALS, normals.data(), normals.size() * sizeof( int16_t ) ) )			return false;
+	}
+	if( file.FindSection( ME3D_SECTION_TYPE::UVS ) ) {
+		if( !file.DecodeSection( ME3D_SECTION_TYPE::UVS, uvs.data(), uvs.size() * sizeof( int16_t ) ) )						return false;
+	}
+	if( file.FindSection( ME3D_SECTION_TYPE::MATERIALS ) ) {
+		if( !file.DecodeSection( ME3D_SECTION_TYPE::MATERIALS, materials.data(), materials.size() * sizeof( int16_t ) ) )	return false;
+	}
+
+	vertices.resize( vert_count );
+	for( size_t i=0; i < vert_count; ++i ) {
+		auto & dst = vertices[ i ];
+		for( size_t c=0; c < 3; ++c ) {
+			dst.position[ c ]		= head_v2.position_min[ c ] + float( positions[ i * 3 + c ] ) * head_v2.position_scale[ c ];
+			dst.normals[ c ]		= normals[ i * 3 + c ];
+		}
+		dst.uvs[ 0 ]				= uvs[ i * 2 + 0 ];
+		dst.uvs[ 1 ]				= uvs[ i * 2 + 1 ];
+		dst.material_index			= materials[ i ];
+	}
+	metadata		= file.DecodeMetaData();
+
+	is_loaded		= true;
+	return			true;
+}
+
+bool ME3D_File::Save( std::string path ) const
+{
+	size_t vert_count		= vertices.size();
+	size_t polygon_count	= polygons.size();
+
+	ME3D_HeaderV2 head_v2 {};
+	head_v2.file_id			= ME3D_FILE_ID_V2;
+	head_v2.head_size		= sizeof( ME3D_HeaderV2 );
+	head_v2.version			= ME3D_VERSION_2;
+	head_v2.vert_count		= int32_t( vert_count );
+	head_v2.polygon_count	= int32_t( polygon_count );
+
+	// quantize positions inside the bounding box of the mesh
+	float position_max[ 3 ] {};
+	for( size_t c=0; c < 3; ++c ) {
+		head_v2.position_min[ c ]	= vert_count ? vertices[ 0 ].position[ c ] : 0.0f;
+		position_max[ c ]			= head_v2.position_min[ c ];
+	}
+	for( auto & v : vertices ) {
+		for( size_t c=0; c < 3; ++c ) {
+			head_v2.position_min[ c ]	= std::min( head_v2.position_min[ c ], v.position[ c ] );
+			position_max[ c ]			= std::max( position_max[ c ], v.position[ c ] );
+		}
+	}
+	for( size_t c=0; c < 3; ++c ) {
+		head_v2.position_scale[ c ]	= ( position_max[ c ] - head_v2.position_min[ c ] ) / ME3D_POSITION_QUANTIZATION_MAX;
+	}
+
+	std::vector<uint16_t>	positions( vert_count * 3 );
+	std::vector<int16_t>	normals( vert_count * 3 );
+	std::vector<int16_t>	uvs( vert_count * 2 );
+	std::vector<int16_t>	materials( vert_count );
+	std::vector<int32_t>	indices( polygon_count * 3 );
+	for( size_t i=0; i < vert_count; ++i ) {
+		auto & src = vertices[ i ];
+		for( size_t c=0; c < 3; ++c ) {
+			float scale				= head_v2.position_scale[ c ];
+			float quantized			= scale > 0.0f ? std::round( ( src.position[ c ] - head_v2.position_min[ c ] ) / scale ) : 0.0f;
+			positions[ i * 3 + c ]	= uint16_t( std::min( std::max( quantized, 0.0f ), ME3D_POSITION_QUANTIZATION_MAX ) );
+			normals[ i * 3 + c ]	= src.normals[ c ];
+		}
+		uvs[ i * 2 + 0 ]			= src.uvs[ 0 ];
+		uvs[ i * 2 + 1 ]			= src.uvs[ 1 ];
+		materials[ i ]				= src.material_index;
+	}
+	if( polygon_count ) std::memcpy( indices.data(), polygons.data(), polygon_count * sizeof( ME3D_Polygon ) );
+
+	std::vector<ME3D_Section>			sections( 5 );
+	std::vector<std::vector<uint8_t>>	payloads( 5 );
+	ME3D_EncodeSection( ME3D_SECTION_TYPE::POSITIONS, positions, vert_count, &sections[ 0 ], &payloads[ 0 ] );
+	ME3D_EncodeSection( ME3D_SECTION_TYPE::NORMALS, normals, vert_count, &sections[ 1 ], &payloads[ 1 ] );
+	ME3D_EncodeSection( ME3D_SECTION_TYPE::UVS, uvs, vert_count, &sections[ 2 ], &payloads[ 2 ] );
+	ME3D_EncodeSection( ME3D_SECTION_TYPE::MATERIALS, materials, vert_count, &sections[ 3 ], &payloads[ 3 ] );
+	ME3D_EncodeSection( ME3D_SECTION_TYPE::INDICES, indices, polygon_count, &sections[ 4 ], &payloads[ 4 ] );
+
+	return ME3D_WriteVersion2( path, head_v2, sections, payloads, metadata );
+}
+
 const std::vector<ME3D_Vertex>& ME3D_File::GetVertices() const
 {
 	return vertices;
@@ -153,7 +512,269 @@ const std::vector<ME3D_Polygon>& ME3D_File::GetPolygons() const
 	return polygons;
 }
 
+const std::vector<ME3D_MetaData>& ME3D_File::GetMetaData() const
+{
+	return metadata;
+}
+
+void ME3D_File::AddMetaData( std::string identifier, std::string data )
+{
+	metadata.push_back( { identifier, data } );
+}
+
 bool ME3D_File::IsLoaded() const
 {
 	return is_loaded;
 }
+
+
+
+ME3D_MappedFile::ME3D_MappedFile()
+{
+}
+
+ME3D_MappedFile::ME3D_MappedFile( std::string path )
+{
+	Open( path );
+}
+
+ME3D_MappedFile::~ME3D_MappedFile()
+{
+	Close();
+}
+
+// checks that a section described by the header is fully inside the file
+bool ME3D_IsSectionInside( int32_t count, int32_t record_size, int32_t location, size_t file_size )
+{
+	if( count < 0 || record_size < 0 || location < 0 )		return false;
+	if( count == 0 )										return true;
+	if( record_size == 0 )									return false;
+	return size_t( location ) + size_t( count ) * size_t( record_size ) <= file_size;
+}
+
+// Sections of per vertex and per polygon values have to hold exactly as many as the header says, so the
+// loaders can size their arrays from the header. Checked before anything is allocated for a section.
+bool ME3D_IsSectionValidV2( const ME3D_Section & section, const ME3D_HeaderV2 & head_v2, size_t file_size )
+{
+	if( section.decoded_size < 0 || section.element_count < 0 )												return false;
+	// empty meshes have empty sections, wherever they claim to be
+	bool empty				= 0 == section.byte_size && 0 == section.decoded_size;
+	if( !empty && !ME3D_IsSectionInside( 1, section.byte_size, section.location, file_size ) )				return false;
+
+	size_t components		= 0;
+	size_t value_size		= 0;
+	if( !ME3D_GetSectionFormat( section.type, &components, &value_size ) )									return true;
+	int32_t count			= ME3D_SECTION_TYPE::INDICES == section.type ? head_v2.polygon_count : head_v2.vert_count;
+	size_t value_count		= size_t( count ) * components;
+	if( section.element_count != count || size_t( section.decoded_size ) != value_count * value_size )		return false;
+	// every value takes at least a byte of the stream, rANS streams are checked when they're decoded
+	if( ME3D_SECTION_ENCODING::RAW == section.encoding && section.byte_size != section.decoded_size )		return false;
+	if( ME3D_SECTION_ENCODING::DELTA_VARINT == section.encoding && size_t( section.byte_size ) < value_count )	return false;
+	return true;
+}
+
+bool ME3D_MappedFile::Open( std::string path )
+{
+	Close();
+
+#if defined( _WIN32 )
+	HANDLE file = CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+	if( INVALID_HANDLE_VALUE == file ) return false;
+	file_handle			= file;
+
+	LARGE_INTEGER file_size {};
+	if( !GetFileSizeEx( file, &file_size ) || size_t( file_size.QuadPart ) < sizeof( ME3D_Header ) ) {
+		Close();
+		return false;
+	}
+	size				= size_t( file_size.QuadPart );
+
+	mapping_handle		= CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	if( nullptr == mapping_handle ) {
+		Close();
+		return false;
+	}
+	data				= (const uint8_t*)MapViewOfFile( mapping_handle, FILE_MAP_READ, 0, 0, 0 );
+	if( nullptr == data ) {
+		Close();
+		return false;
+	}
+#else
+	file_descriptor		= open( path.c_str(), O_RDONLY );
+	if( file_descriptor < 0 ) return false;
+
+	struct stat file_stat {};
+	if( fstat( file_descriptor, &file_stat ) != 0 || size_t( file_stat.st_size ) < sizeof( ME3D_Header ) ) {
+		Close();
+		return false;
+	}
+	size				= size_t( file_stat.st_size );
+
+	void * mapped		= mmap( nullptr, size, PROT_READ, MAP_PRIVATE, file_descriptor, 0 );
+	if( MAP_FAILED == mapped ) {
+		Close();
+		return false;
+	}
+	madvise( mapped, size, MADV_SEQUENTIAL );
+	data				= (const uint8_t*)mapped;
+#endif
+
+	version				= ME3D_GetFileVersion( data, size );
+	if( ME3D_VERSION_2 == version ) {
+		std::memcpy( &head_v2, data, sizeof( head_v2 ) );
+		if( !ME3D_ValidateHeaderV2( head_v2, size ) ) {
+			Close();
+			return false;
+		}
+		for( int32_t i=0; i < head_v2.section_count; ++i ) {
+			auto & section = ( (const ME3D_Section*)( data + head_v2.section_table_location ) )[ i ];
+			if( !ME3D_IsSectionValidV2( section, head_v2, size ) ) {
+				Close();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	std::memcpy( &head, data, sizeof( head ) );
+
+	if( !ME3D_ValidateHeader( head, size )
+		|| !ME3D_IsSectionInside( head.vert_count, head.vert_size, head.vert_location, size )
+		|| !ME3D_IsSectionInside( head.vert_copy_count, head.vert_copy_size, head.vert_copy_location, size )
+		|| !ME3D_IsSectionInside( head.polygon_count, head.polygon_size, head.polygon_location, size ) ) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void ME3D_MappedFile::Close()
+{
+#if defined( _WIN32 )
+	if( nullptr != data )				UnmapViewOfFile( data );
+	if( nullptr != mapping_handle )		CloseHandle( mapping_handle );
+	if( nullptr != file_handle )		CloseHandle( file_handle );
+	mapping_handle		= nullptr;
+	file_handle			= nullptr;
+#else
+	if( nullptr != data )				munmap( (void*)data, size );
+	if( file_descriptor >= 0 )			close( file_descriptor );
+	file_descriptor		= -1;
+#endif
+	data				= nullptr;
+	size				= 0;
+	head				= {};
+	head_v2				= {};
+	version				= 0;
+}
+
+const ME3D_Header & ME3D_MappedFile::GetHeader() const
+{
+	return head;
+}
+
+ME3D_View<ME3D_Vertex> ME3D_MappedFile::GetVertices() const
+{
+	if( !IsOpen() ) return {};
+	return ME3D_View<ME3D_Vertex>( data + head.vert_location, size_t( head.vert_count ), size_t( head.vert_size ) );
+}
+
+ME3D_View<ME3D_VertexCopy> ME3D_MappedFile::GetCopyVertices() const
+{
+	if( !IsOpen() ) return {};
+	return ME3D_View<ME3D_VertexCopy>( data + head.vert_copy_location, size_t( head.vert_copy_count ), size_t( head.vert_copy_size ) );
+}
+
+ME3D_View<ME3D_Polygon> ME3D_MappedFile::GetPolygons() const
+{
+	if( !IsOpen() ) return {};
+	return ME3D_View<ME3D_Polygon>( data + head.polygon_location, size_t( head.polygon_count ), size_t( head.polygon_size ) );
+}
+
+int32_t ME3D_MappedFile::GetVersion() const
+{
+	return version;
+}
+
+const ME3D_HeaderV2 & ME3D_MappedFile::GetHeaderV2() const
+{
+	return head_v2;
+}
+
+const ME3D_Section * ME3D_MappedFile::FindSection( ME3D_SECTION_TYPE type ) const
+{
+	if( !IsOpen() || ME3D_VERSION_2 != version ) return nullptr;
+	auto sections = (const ME3D_Section*)( data + head_v2.section_table_location );
+	for( int32_t i=0; i < head_v2.section_count; ++i ) {
+		if( sections[ i ].type == type ) return &sections[ i ];
+	}
+	return nullptr;
+}
+
+bool ME3D_MappedFile::DecodeSection( ME3D_SECTION_TYPE type, void * dst, size_t dst_size ) const
+{
+	auto section = FindSection( type );
+	if( nullptr == section ) return false;
+
+	size_t components = 0, value_size = 0;
+	if( !ME3D_GetSectionFormat( type, &components, &value_size ) )								return false;
+	if( size_t( section->decoded_size ) != dst_size )											return false;
+	if( size_t( section->element_count ) * components * value_size != dst_size )				return false;
+
+	const uint8_t * src		= data + section->location;
+	size_t src_size			= size_t( section->byte_size );
+	switch( section->encoding ) {
+	case ME3D_SECTION_ENCODING::RAW:
+		if( src_size != dst_size ) return false;
+		if( dst_size ) std::memcpy( dst, src, dst_size );
+		return true;
+	case ME3D_SECTION_ENCODING::DELTA_VARINT:
+		return ME3D_DecodeSectionValues( type, src, src_size, dst, size_t( section->element_count ) );
+	case ME3D_SECTION_ENCODING::DELTA_VARINT_RANS:
+	{
+		// the size in the stream comes from the file, it decodes to the varints of the section's values
+		// so anything outside of what they can take up is rejected before allocating for it
+		size_t value_count = size_t( section->element_count ) * components;
+		size_t delta_size = ME3D_GetRANSDecodedSize( src, src_size );
+		if( delta_size < value_count || delta_size > value_count * ME3D_DELTA_VARINT_MAX_BYTES ) return false;
+		std::vector<uint8_t> delta( delta_size );
+		if( !ME3D_DecodeRANS( src, src_size, delta.data(), delta.size() ) ) return false;
+		return ME3D_DecodeSectionValues( type, delta.data(), delta.size(), dst, size_t( section->element_count ) );
+	}
+	default:
+		return false;
+	}
+}
+
+const uint8_t * ME3D_MappedFile::GetSectionData( ME3D_SECTION_TYPE type, size_t * byte_size ) const
+{
+	auto section = FindSection( type );
+	if( nullptr == section || ME3D_SECTION_ENCODING::RAW != section->encoding ) return nullptr;
+	if( nullptr != byte_size ) *byte_size = size_t( section->byte_size );
+	return data + section->location;
+}
+
+std::vector<ME3D_MetaData> ME3D_MappedFile::DecodeMetaData() const
+{
+	std::vector<ME3D_MetaData> ret;
+	auto section = FindSection( ME3D_SECTION_TYPE::METADATA );
+	if( nullptr == section || section->byte_size < int32_t( sizeof( int32_t ) ) ) return ret;
+
+	const uint8_t * ptr		= data + section->location;
+	const uint8_t * end		= ptr + section->byte_size;
+	int32_t count			= 0;
+	std::memcpy( &count, ptr, sizeof( count ) );
+	ptr += sizeof( count );
+	for( int32_t i=0; i < count && ptr < end; ++i ) {
+		ME3D_MetaData m;
+		m.identifier		= ME3D_ReadString( &ptr, end );
+		m.data				= ME3D_ReadString( &ptr, end );
+		ret.push_back( m );
+	}
+	return ret;
+}
+
+bool ME3D_MappedFile::IsOpen() const
+{
+	return nullptr != data;
+}
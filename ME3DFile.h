@@ -1,9 +1,13 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 #include <string>
 #include <vector>
 
+constexpr float ME3D_FLOAT_TO_SHORT					= 32767.0f;
+constexpr float ME3D_SHORT_TO_FLOAT					= 1 / ME3D_FLOAT_TO_SHORT;
+
 struct ME3D_Header
 {
 	int32_t		file_id;
@@ -26,6 +30,62 @@ private:
 	int32_t		padding[ 4 ];
 };
 
+// Version 2 files start with their own header followed by a table of sections,
+// every stream is its own section so users can decode only what they need.
+struct ME3D_HeaderV2
+{
+	int32_t		file_id;
+	int32_t		head_size;
+	int32_t		file_size;
+	int32_t		version;
+
+	int32_t		vert_count;
+	int32_t		polygon_count;
+	int32_t		section_count;
+	int32_t		section_table_location;
+
+	// positions are quantized to 16 bits per axis, position = position_min + quantized * position_scale
+	float		position_min[ 3 ];
+	float		position_scale[ 3 ];
+
+private:
+	int32_t		padding[ 2 ];
+};
+
+enum class ME3D_SECTION_TYPE : int32_t
+{
+	NONE,
+	METADATA,					// int32_t count followed by identifier and data strings for each ME3D_MetaData
+	POSITIONS,					// 3 x uint16_t per vertex, quantized
+	NORMALS,					// 3 x int16_t per vertex
+	UVS,						// 2 x int16_t per vertex
+	MATERIALS,					// 1 x int16_t per vertex
+	INDICES,					// 3 x int32_t per polygon
+	GPU_VERTICES,				// cooked vertex buffer contents, stride is decoded_size / element_count
+	GPU_INDICES,				// cooked index buffer contents, index size is decoded_size / element_count
+	GPU_CLUSTERS,				// cooked MeshCluster of every level of detail, see MeshGPUData
+};
+
+enum class ME3D_SECTION_ENCODING : int32_t
+{
+	RAW,						// decoded data stored as is
+	DELTA_VARINT,				// per component delta, zigzag and LEB128 coded, see ME3DCompression.h
+	DELTA_VARINT_RANS,			// as above, then entropy coded with rANS
+};
+
+struct ME3D_Section
+{
+	ME3D_SECTION_TYPE		type;
+	ME3D_SECTION_ENCODING	encoding;
+	int32_t					location;
+	int32_t					byte_size;			// size in the file
+	int32_t					decoded_size;		// size in bytes after decoding
+	int32_t					element_count;
+
+private:
+	int32_t					padding[ 2 ];
+};
+
 struct ME3D_MetaData
 {
 	std::string			identifier;
@@ -55,6 +115,63 @@ struct ME3D_Polygon
 uint16_t ME3D_FloatToShort( float value );
 float ME3D_ShortToFloat( uint16_t value );
 
+bool ME3D_ValidateHeader( const ME3D_Header & head, size_t file_size );		// returns true if the header describes a compatible file of this size
+bool ME3D_ValidateHeaderV2( const ME3D_HeaderV2 & head, size_t file_size );
+int32_t ME3D_GetFileVersion( const uint8_t * data, size_t size );				// returns 0 if the data isn't an ME3D file
+
+// Fills in a version 1 header for records of the given sizes stored back to back right after it,
+// record sizes may be smaller than the structs like in files from older exporters.
+// returns false if the file would be too big for the format
+bool ME3D_MakeHeader( ME3D_Header * head, size_t vert_count, size_t vert_size, size_t vert_copy_count, size_t vert_copy_size, size_t polygon_count, size_t polygon_size );
+
+// Cooked files are version 2 files that hold the final vertex and index buffer contents and the clusters
+// in raw sections, loading one is a single copy out of the file mapping for each. How to read them is up to
+// the metadata, see Mesh::SaveCooked().
+bool ME3D_SaveCooked( std::string path, const void * vertices, size_t vertex_count, size_t vertex_stride, const void * indices, size_t index_count, size_t index_size,
+	const void * clusters, size_t cluster_count, size_t cluster_size, const std::vector<ME3D_MetaData> & metadata );
+
+// Read-only view over a section of records inside a memory mapped file.
+// Records in the file may be smaller than the struct ( older exporters ) and
+// may not be aligned, Get() handles both cases and zeroes any missing fields.
+// Data() is only available when the records can be used in-place.
+template<typename T>
+class ME3D_View
+{
+public:
+	ME3D_View() = default;
+	ME3D_View( const uint8_t * data, size_t count, size_t stride )
+		: data( data ), count( count ), stride( stride )
+	{
+	}
+
+	size_t						Size() const
+	{
+		return count;
+	}
+
+	bool						IsContiguous() const
+	{
+		return stride == sizeof( T ) && ( reinterpret_cast<uintptr_t>( data ) % alignof( T ) ) == 0;
+	}
+
+	const T					*	Data() const
+	{
+		return IsContiguous() ? reinterpret_cast<const T*>( data ) : nullptr;
+	}
+
+	T							Get( size_t index ) const
+	{
+		T ret {};
+		std::memcpy( &ret, data + index * stride, stride );
+		return ret;
+	}
+
+private:
+	const uint8_t			*	data						= nullptr;
+	size_t						count						= 0;
+	size_t						stride						= 0;
+};
+
 class ME3D_File
 {
 public:
@@ -62,19 +179,72 @@ public:
 	ME3D_File( std::string path );
 	~ME3D_File();
 
-	bool										Load( std::string path );		// returns true if successfully loaded a file
+	bool										Load( std::string path );		// returns true if successfully loaded a file, version 1 or 2
+	bool										Save( std::string path ) const;	// always saves as version 2, returns true on success
 	const std::vector<ME3D_Vertex>			&	GetVertices() const;
 	const std::vector<ME3D_VertexCopy>		&	GetCopyVertices() const;
 	const std::vector<ME3D_Polygon>			&	GetPolygons() const;
+	const std::vector<ME3D_MetaData>		&	GetMetaData() const;
+
+	void										AddMetaData( std::string identifier, std::string data );
 
 	bool										IsLoaded() const;
 
 private:
+	bool										_LoadV2( std::string path );
+
 	ME3D_Header									head;
 
 	std::vector<ME3D_Vertex>					vertices;
-	std::vector<ME3D_VertexCopy>				vertex_copies;
+	std::vector<ME3D_VertexCopy>				vertex_copies;		// version 2 files store vertex copies already resolved
 	std::vector<ME3D_Polygon>					polygons;
+	std::vector<ME3D_MetaData>					metadata;
 
 	bool										is_loaded					= false;
 };
+
+// Maps the whole file into memory and returns views into it instead of copying
+// the data into vectors, vertex copies are not resolved here, it's up to the user.
+// Version 2 files have no views, sections are decoded on demand with DecodeSection().
+class ME3D_MappedFile
+{
+public:
+	ME3D_MappedFile();
+	ME3D_MappedFile( std::string path );
+	~ME3D_MappedFile();
+
+	ME3D_MappedFile( const ME3D_MappedFile & other )				= delete;
+	ME3D_MappedFile & operator=( const ME3D_MappedFile & other )	= delete;
+
+	bool										Open( std::string path );		// returns true if successfully mapped a file
+	void										Close();
+
+	const ME3D_Header						&	GetHeader() const;
+	ME3D_View<ME3D_Vertex>						GetVertices() const;
+	ME3D_View<ME3D_VertexCopy>					GetCopyVertices() const;
+	ME3D_View<ME3D_Polygon>						GetPolygons() const;
+
+	int32_t										GetVersion() const;
+	const ME3D_HeaderV2						&	GetHeaderV2() const;
+	const ME3D_Section						*	FindSection( ME3D_SECTION_TYPE type ) const;		// nullptr if the file has no such section
+	bool										DecodeSection( ME3D_SECTION_TYPE type, void * dst, size_t dst_size ) const;
+	const uint8_t							*	GetSectionData( ME3D_SECTION_TYPE type, size_t * byte_size ) const;		// raw sections only, points into the mapping
+	std::vector<ME3D_MetaData>					DecodeMetaData() const;
+
+	bool										IsOpen() const;
+
+private:
+	ME3D_Header									head						= {};
+	ME3D_HeaderV2								head_v2						= {};
+	int32_t										version						= 0;
+
+	const uint8_t							*	data						= nullptr;
+	size_t										size						= 0;
+
+#if defined( _WIN32 )
+	void									*	file_handle					= nullptr;
+	void									*	mapping_handle				= nullptr;
+#else
+	int											file_descriptor				= -1;
+#endif
+};
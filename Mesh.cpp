@@ -3,6 +3,16 @@
 #include "Platform.h"
 
 #include "ME3DFile.h"
+#include "ME3DDecode.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshGPUData.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <cstring>
+#include <sstream>
 
 Mesh::Mesh()
 {
@@ -14,8 +24,11 @@ Mesh::~Mesh()
 
 void Mesh::GenerateShape( MESH_OBJECT_SHAPE shape )
 {
+	MarkVerticesChanged();
+	MarkTrianglesChanged();
 	vertices.clear();
 	triangles.clear();
+	lods.clear();
 
 	switch( shape ) {
 	case MESH_OBJECT_SHAPE::NONE:
@@ -275,39 +288,427 @@ void Mesh::GenerateShape( MESH_OBJECT_SHAPE shape )
 	default:
 		break;
 	}
+	_CalculateBounds();
 }
 
 void Mesh::Load( std::string path )
 {
-	ME3D_File file( path );
-	if( !file.IsLoaded() ) return;
-	auto & me3d_vertices		= file.GetVertices();
-	auto & me3d_polygons		= file.GetPolygons();
-
-	vertices.empty();
-	triangles.empty();
-	vertices.resize( me3d_vertices.size() );
-	triangles.resize( me3d_polygons.size() );
-
-	for( size_t i=0; i < me3d_vertices.size(); ++i ) {
-		auto & dst = vertices[ i ];
-		auto & src = me3d_vertices[ i ];
-		dst.position[ 0 ]			= src.position[ 0 ];
-		dst.position[ 1 ]			= src.position[ 1 ];
-		dst.position[ 2 ]			= src.position[ 2 ];
-		dst.color[ 0 ]				= 0.5f;
-		dst.color[ 1 ]				= 0.5f;
-		dst.color[ 2 ]				= 0.5f;
-		dst.uv[ 0 ]					= ME3D_ShortToFloat( src.uvs[ 0 ] );
-		dst.uv[ 1 ]					= ME3D_ShortToFloat( src.uvs[ 1 ] );
+	// read directly from the memory mapped file, this way the file contents
+	// are never copied into intermediate buffers before reaching the mesh
+	lods.clear();
+	MarkVerticesChanged();
+	MarkTrianglesChanged();
+	ME3D_MappedFile file( path );
+	if( !file.IsOpen() ) return;
+	if( file.GetVersion() == 2 ) {
+		if( file.FindSection( ME3D_SECTION_TYPE::GPU_VERTICES ) ) {
+			_LoadME3DCooked( file );
+		} else {
+			_LoadME3DVersion2( file );
+		}
+		_ClearIfIndicesInvalid();
+		_CalculateBounds();
+		return;
+	}
+	auto me3d_vertices			= file.GetVertices();
+	auto me3d_vertex_copies		= file.GetCopyVertices();
+	auto me3d_polygons			= file.GetPolygons();
+
+	vertices.clear();
+	triangles.clear();
+	vertices.resize( me3d_vertices.Size() + me3d_vertex_copies.Size() );
+	triangles.resize( me3d_polygons.Size() );
+
+	ME3D_DecodeVertices( vertices.data(), me3d_vertices );
+
+	// copy vertices take the coordinates of the vertex they're copying, only uvs are their own
+	ME3D_DecodeVertexCopies( vertices.data(), me3d_vertices.Size(), me3d_vertex_copies );
+
+	// ME3D_Polygon and Triangle have identical layouts, aligned data can be copied in one go
+	static_assert( sizeof( ME3D_Polygon ) == sizeof( Triangle ), "ME3D_Polygon and Triangle layouts must match." );
+	if( me3d_polygons.IsContiguous() ) {
+		std::memcpy( triangles.data(), me3d_polygons.Data(), triangles.size() * sizeof( Triangle ) );
+	} else {
+		for( size_t i=0; i < me3d_polygons.Size(); ++i ) {
+			auto src = me3d_polygons.Get( i );
+			auto & dst = triangles[ i ];
+			dst.indices[ 0 ]			= src.indices[ 0 ];
+			dst.indices[ 1 ]			= src.indices[ 1 ];
+			dst.indices[ 2 ]			= src.indices[ 2 ];
+		}
+	}
+	_ClearIfIndicesInvalid();
+	_CalculateBounds();
+}
+
+void Mesh::_ClearIfIndicesInvalid()
+{
+	// welding, simplification, clustering and optimization all index arrays with these, a corrupt file must not reach them
+	size_t vertex_count		= vertices.size();
+	auto AreValid = [ vertex_count ]( const std::vector<Triangle> & list ) {
+		for( auto & t : list ) {
+			if( t.indices[ 0 ] >= vertex_count || t.indices[ 1 ] >= vertex_count || t.indices[ 2 ] >= vertex_count ) return false;
+		}
+		return true;
+	};
+	bool valid				= AreValid( triangles );
+	for( auto & lod : lods ) {
+		valid				= valid && AreValid( lod.triangles );
+	}
+	if( valid ) return;
+
+	vertices.clear();
+	triangles.clear();
+	lods.clear();
+}
+
+void Mesh::_LoadME3DVersion2( const ME3D_MappedFile & file )
+{
+	// only the sections we actually use are decoded, normals and materials are never touched
+	auto & head				= file.GetHeaderV2();
+	size_t vert_count		= size_t( head.vert_count );
+
+	vertices.clear();
+	triangles.clear();
+	// the file was checked to have sections matching the header's counts, without them the counts mean nothing
+	if( !file.FindSection( ME3D_SECTION_TYPE::POSITIONS ) || !file.FindSection( ME3D_SECTION_TYPE::INDICES ) ) return;
+
+	std::vector<uint16_t>	positions( vert_count * 3 );
+	std::vector<int16_t>	uvs( vert_count * 2 );
+	triangles.resize( size_t( head.polygon_count ) );
+	if( !file.DecodeSection( ME3D_SECTION_TYPE::POSITIONS, positions.data(), positions.size() * sizeof( uint16_t ) )
+		|| !file.DecodeSection( ME3D_SECTION_TYPE::INDICES, triangles.data(), triangles.size() * sizeof( Triangle ) ) ) {
+		triangles.clear();
+		return;
+	}
+	if( file.FindSection( ME3D_SECTION_TYPE::UVS ) ) {
+		if( !file.DecodeSection( ME3D_SECTION_TYPE::UVS, uvs.data(), uvs.size() * sizeof( int16_t ) ) ) {
+			triangles.clear();
+			return;
+		}
+	}
+
+	vertices.resize( vert_count );
+	ME3D_DecodeParallel( vert_count, [ & ]( size_t begin, size_t end ) {
+		for( size_t i = begin; i < end; ++i ) {
+			auto & dst = vertices[ i ];
+			dst.position[ 0 ]		= head.position_min[ 0 ] + float( positions[ i * 3 + 0 ] ) * head.position_scale[ 0 ];
+			dst.position[ 1 ]		= head.position_min[ 1 ] + float( positions[ i * 3 + 1 ] ) * head.position_scale[ 1 ];
+			dst.position[ 2 ]		= head.position_min[ 2 ] + float( positions[ i * 3 + 2 ] ) * head.position_scale[ 2 ];
+			dst.color[ 0 ]			= 0.5f;
+			dst.color[ 1 ]			= 0.5f;
+			dst.color[ 2 ]			= 0.5f;
+			dst.uv[ 0 ]				= ME3D_ShortToFloat( uvs[ i * 2 + 0 ] );
+			dst.uv[ 1 ]				= ME3D_ShortToFloat( uvs[ i * 2 + 1 ] );
+		}
+	} );
+}
+
+bool Mesh::SaveCooked( std::string path, VERTEX_LAYOUT vertex_layout ) const
+{
+	// exactly what GPUMesh builds for the layout, loading the file hands it over as is
+	MeshGPUData data;
+	MeshGPUData_Build( *this, vertex_layout, true, &data );
+
+	// clusters of all levels go into one section, the metadata tells how many belong to each level
+	std::vector<MeshCluster> clusters;
+	std::ostringstream gpu_lods;
+	gpu_lods.precision( 9 );
+	for( auto & lod : data.lods ) {
+		gpu_lods << lod.error << " " << lod.draw_ranges.size() << " " << lod.clusters.size();
+		for( auto & range : lod.draw_ranges ) {
+			gpu_lods << " " << range.first_index << " " << range.index_count << " " << range.vertex_offset;
+		}
+		gpu_lods << "\n";
+		clusters.insert( clusters.end(), lod.clusters.begin(), lod.clusters.end() );
+	}
+	std::ostringstream dequantization;
+	dequantization.precision( 9 );
+	for( size_t c=0; c < 3; ++c ) dequantization << data.dequantization.offset[ c ] << " ";
+	for( size_t c=0; c < 3; ++c ) dequantization << data.dequantization.scale[ c ] << " ";
+
+	std::vector<ME3D_MetaData> metadata;
+	metadata.push_back( { "vertex_layout", VertexLayout_GetName( vertex_layout ) } );
+	metadata.push_back( { "index_type", INDEX_TYPE::UINT16 == data.index_type ? "UINT16" : "UINT32" } );
+	metadata.push_back( { "dequantization", dequantization.str() } );
+	metadata.push_back( { "gpu_lods", gpu_lods.str() } );
+
+	size_t stride			= VertexLayout_GetStride( vertex_layout );
+	size_t index_size		= MeshIndices_GetIndexSize( data.index_type );
+	return ME3D_SaveCooked( path,
+		data.vertex_data.data(), data.vertex_data.size() / stride, stride,
+		data.index_data.data(), data.index_data.size() / index_size, index_size,
+		clusters.data(), clusters.size(), sizeof( MeshCluster ),
+		metadata );
+}
+
+void Mesh::WeldVertices( MeshWeldStatistics * statistics )
+{
+	auto stats = MeshOptimizer_WeldVertices( vertices, triangles );
+	// levels of detail would index the vertices before welding
+	if( stats.vertices_after != stats.vertices_before ) lods.clear();
+	MarkVerticesChanged();
+	MarkTrianglesChanged();
+	if( nullptr != statistics ) *statistics = stats;
+}
+
+void Mesh::GenerateLODs( const MeshLODSettings & settings )
+{
+	lods.clear();
+	MarkTrianglesChanged();
+	if( vertices.empty() || triangles.empty() ) return;
+
+	// errors are relative to the size of the mesh so one setting works for every model
+	glm::vec3 min_position( vertices[ 0 ].position[ 0 ], vertices[ 0 ].position[ 1 ], vertices[ 0 ].position[ 2 ] );
+	glm::vec3 max_position	= min_position;
+	for( auto & v : vertices ) {
+		glm::vec3 p( v.position[ 0 ], v.position[ 1 ], v.position[ 2 ] );
+		min_position		= glm::min( min_position, p );
+		max_position		= glm::max( max_position, p );
+	}
+	float max_error			= settings.max_error * glm::length( max_position - min_position );
+
+	// every level is simplified from the previous one, errors add up as the quadrics only know the previous level
+	size_t previous_count	= triangles.size();
+	float previous_error	= 0.0f;
+	for( size_t level=0; level < settings.max_levels; ++level ) {
+		size_t target_count	= size_t( float( previous_count ) * settings.reduction );
+		if( target_count < settings.min_triangles || previous_error >= max_error ) break;
+
+		MeshLOD lod;
+		lod.triangles		= MeshSimplifier_Simplify( vertices, lods.empty() ? triangles : lods.back().triangles, target_count, max_error - previous_error, &lod.error );
+		// stuck on locked vertices or on the error limit, more levels would look the same
+		if( float( lod.triangles.size() ) > float( previous_count ) * MESH_LOD_MIN_LEVEL_REDUCTION ) break;
+
+		MeshOptimizer_OptimizeVertexCache( lod.triangles, vertices.size() );
+		lod.error			+= previous_error;
+		previous_error		= lod.error;
+		previous_count		= lod.triangles.size();
+		lods.push_back( std::move( lod ) );
+	}
+}
+
+void Mesh::Optimize( MeshOptimizationReport * report )
+{
+	// levels of detail would index the vertices in their old order
+	lods.clear();
+
+	if( nullptr != report ) {
+		report->cache_before		= MeshOptimizer_AnalyzeVertexCache( triangles, vertices.size() );
+		report->overdraw_before		= MeshOptimizer_AnalyzeOverdraw( vertices, triangles );
+	}
+
+	// cache order first, overdraw sorting keeps the order inside clusters and fetch order follows the final triangle order
+	MeshOptimizer_OptimizeVertexCache( triangles, vertices.size() );
+	MeshOptimizer_OptimizeOverdraw( triangles, vertices );
+	MeshOptimizer_OptimizeVertexFetch( vertices, triangles );
+	MarkVerticesChanged();
+	MarkTrianglesChanged();
+
+	if( nullptr != report ) {
+		report->cache_after			= MeshOptimizer_AnalyzeVertexCache( triangles, vertices.size() );
+		report->overdraw_after		= MeshOptimizer_AnalyzeOverdraw( vertices, triangles );
+	}
+}
+
+// the copied bytes, the decoded size and the elements have to agree exactly, anything else is a truncated or corrupt file
+bool Mesh_IsCookedSectionValid( const ME3D_Section * section, size_t element_size )
+{
+	if( nullptr == section || ME3D_SECTION_ENCODING::RAW != section->encoding )							return false;
+	if( section->element_count < 0 || section->byte_size != section->decoded_size )						return false;
+	return size_t( section->byte_size ) == size_t( section->element_count ) * element_size;
+}
+
+void Mesh::_LoadME3DCooked( const ME3D_MappedFile & file )
+{
+	vertices.clear();
+	triangles.clear();
+
+	// the metadata says which layout and index type the sections hold and how levels of detail split them
+	auto data				= std::make_shared<MeshGPUData>();
+	bool has_layout			= false;
+	bool has_index_type		= false;
+	bool has_dequantization	= false;
+	std::vector<size_t> lod_cluster_counts;
+	for( auto & m : file.DecodeMetaData() ) {
+		std::istringstream stream( m.data );
+		if( m.identifier == "vertex_layout" ) {
+			has_layout			= VertexLayout_FromName( m.data, &data->vertex_layout );
+		} else if( m.identifier == "index_type" ) {
+			has_index_type		= m.data == "UINT16" || m.data == "UINT32";
+			data->index_type	= m.data == "UINT16" ? INDEX_TYPE::UINT16 : INDEX_TYPE::UINT32;
+		} else if( m.identifier == "dequantization" ) {
+			auto & d			= data->dequantization;
+			has_dequantization	= !!( stream >> d.offset[ 0 ] >> d.offset[ 1 ] >> d.offset[ 2 ] >> d.scale[ 0 ] >> d.scale[ 1 ] >> d.scale[ 2 ] );
+		} else if( m.identifier == "gpu_lods" ) {
+			// every range takes a few characters of metadata, the counts can't ask for more memory than the file has
+			GPUMeshLOD lod;
+			size_t range_count		= 0;
+			size_t cluster_count	= 0;
+			while( stream >> lod.error >> range_count >> cluster_count ) {
+				if( range_count > m.data.size() ) return;
+				lod.draw_ranges.resize( range_count );
+				for( auto & range : lod.draw_ranges ) {
+					if( !( stream >> range.first_index >> range.index_count >> range.vertex_offset ) ) return;
+				}
+				data->lods.push_back( lod );
+				lod_cluster_counts.push_back( cluster_count );
+			}
+		}
+	}
+	if( !has_layout || !has_index_type || !has_dequantization || data->lods.empty() ) return;
+
+	// a stride mismatch means the file was cooked for a different version of the layout
+	auto vertex_section		= file.FindSection( ME3D_SECTION_TYPE::GPU_VERTICES );
+	auto index_section		= file.FindSection( ME3D_SECTION_TYPE::GPU_INDICES );
+	auto cluster_section	= file.FindSection( ME3D_SECTION_TYPE::GPU_CLUSTERS );
+	if( !Mesh_IsCookedSectionValid( vertex_section, VertexLayout_GetStride( data->vertex_layout ) ) )		return;
+	if( !Mesh_IsCookedSectionValid( index_section, MeshIndices_GetIndexSize( data->index_type ) ) )		return;
+	if( !Mesh_IsCookedSectionValid( cluster_section, sizeof( MeshCluster ) ) )							return;
+
+	size_t vertex_bytes		= 0;
+	size_t index_bytes		= 0;
+	size_t cluster_bytes	= 0;
+	auto vertex_data		= file.GetSectionData( ME3D_SECTION_TYPE::GPU_VERTICES, &vertex_bytes );
+	auto index_data			= file.GetSectionData( ME3D_SECTION_TYPE::GPU_INDICES, &index_bytes );
+	auto cluster_data		= file.GetSectionData( ME3D_SECTION_TYPE::GPU_CLUSTERS, &cluster_bytes );
+	if( nullptr == vertex_data || nullptr == index_data || nullptr == cluster_data ) return;
+	data->vertex_data.assign( vertex_data, vertex_data + vertex_bytes );
+	data->index_data.assign( index_data, index_data + index_bytes );
+
+	size_t first_cluster	= 0;
+	size_t cluster_count	= cluster_bytes / sizeof( MeshCluster );
+	for( size_t level=0; level < data->lods.size(); ++level ) {
+		if( lod_cluster_counts[ level ] > cluster_count - first_cluster ) return;
+		auto & clusters			= data->lods[ level ].clusters;
+		clusters.resize( lod_cluster_counts[ level ] );
+		if( !clusters.empty() ) std::memcpy( clusters.data(), cluster_data + first_cluster * sizeof( MeshCluster ), clusters.size() * sizeof( MeshCluster ) );
+		first_cluster			+= clusters.size();
+	}
+	if( first_cluster != cluster_count ) return;
+
+	if( !MeshGPUData_Decode( *data, vertices, triangles, lods ) ) return;
+	_cooked_gpu_data		= data;
+}
+
+// FNV-1a
+uint64_t Mesh_HashBytes( uint64_t hash, const void * data, size_t byte_size )
+{
+	auto bytes = reinterpret_cast<const uint8_t*>( data );
+	for( size_t i=0; i < byte_size; ++i ) {
+		hash = ( hash ^ bytes[ i ] ) * 1099511628211ull;
+	}
+	return hash;
+}
+
+uint64_t Mesh::CalculateContentHash() const
+{
+	uint64_t hash	= 14695981039346656037ull;
+	hash			= Mesh_HashBytes( hash, vertices.data(), vertices.size() * sizeof( Vertex ) );
+	hash			= Mesh_HashBytes( hash, triangles.data(), triangles.size() * sizeof( Triangle ) );
+	for( auto & lod : lods ) {
+		hash		= Mesh_HashBytes( hash, &lod.error, sizeof( lod.error ) );
+		hash		= Mesh_HashBytes( hash, lod.triangles.data(), lod.triangles.size() * sizeof( Triangle ) );
+	}
+	return hash;
+}
+
+bool Mesh::HasSameContents( const Mesh & other ) const
+{
+	if( vertices.size() != other.vertices.size() || triangles.size() != other.triangles.size() || lods.size() != other.lods.size() ) return false;
+	if( vertices.size() && std::memcmp( vertices.data(), other.vertices.data(), vertices.size() * sizeof( Vertex ) ) != 0 ) return false;
+	if( triangles.size() && std::memcmp( triangles.data(), other.triangles.data(), triangles.size() * sizeof( Triangle ) ) != 0 ) return false;
+	for( size_t i=0; i < lods.size(); ++i ) {
+		auto & a = lods[ i ];
+		auto & b = other.lods[ i ];
+		if( a.error != b.error || a.triangles.size() != b.triangles.size() ) return false;
+		if( a.triangles.size() && std::memcmp( a.triangles.data(), b.triangles.data(), a.triangles.size() * sizeof( Triangle ) ) != 0 ) return false;
+	}
+	return true;
+}
+
+void Mesh::MarkVerticesChanged()
+{
+	_all_vertices_revision		= ++_vertex_revision;
+	_vertex_changes.clear();
+	_cooked_gpu_data.reset();
+	_CalculateBounds();
+}
+
+void Mesh::MarkVerticesChanged( size_t first_vertex, size_t vertex_count )
+{
+	assert( first_vertex + vertex_count <= vertices.size() );
+	if( 0 == vertex_count ) return;
+	_cooked_gpu_data.reset();
+
+	MeshVertexChange change;
+	change.revision				= ++_vertex_revision;
+	change.first_vertex			= uint32_t( first_vertex );
+	change.vertex_count			= uint32_t( vertex_count );
+	if( _vertex_changes.size() >= MESH_MAX_VERTEX_CHANGES ) {
+		// one range covering everything so far, uploads may grow but the list can't
+		uint32_t last_vertex	= change.first_vertex + change.vertex_count;
+		for( auto & c : _vertex_changes ) {
+			change.first_vertex	= std::min( change.first_vertex, c.first_vertex );
+			last_vertex			= std::max( last_vertex, c.first_vertex + c.vertex_count );
+		}
+		change.vertex_count		= last_vertex - change.first_vertex;
+		_vertex_changes.clear();
+	}
+	_vertex_changes.push_back( change );
+	_GrowBounds( first_vertex, vertex_count );
+}
+
+void Mesh::MarkTrianglesChanged()
+{
+	++_triangle_revision;
+	_cooked_gpu_data.reset();
+}
+
+uint64_t Mesh::GetTriangleRevision() const
+{
+	return _triangle_revision;
+}
+
+uint64_t Mesh::GetVertexRevision() const
+{
+	return _vertex_revision;
+}
+
+bool Mesh::GetVerticesChangedSince( uint64_t revision, size_t * first_vertex, size_t * vertex_count ) const
+{
+	assert( nullptr != first_vertex );
+	assert( nullptr != vertex_count );
+	if( revision >= _vertex_revision ) return false;
+
+	if( revision < _all_vertices_revision ) {
+		*first_vertex			= 0;
+		*vertex_count			= vertices.size();
+		return true;
 	}
-	for( size_t i=0; i < me3d_polygons.size(); ++i ) {
-		auto & dst = triangles[ i ];
-		auto & src = me3d_polygons[ i ];
-		dst.indices[ 0 ]			= src.indices[ 0 ];
-		dst.indices[ 1 ]			= src.indices[ 1 ];
-		dst.indices[ 2 ]			= src.indices[ 2 ];
+
+	size_t first				= vertices.size();
+	size_t last					= 0;
+	for( auto & c : _vertex_changes ) {
+		if( c.revision <= revision ) continue;
+		first					= std::min( first, size_t( c.first_vertex ) );
+		last					= std::max( last, size_t( c.first_vertex + c.vertex_count ) );
 	}
+	if( first >= last ) return false;
+	*first_vertex				= first;
+	*vertex_count				= last - first;
+	return true;
+}
+
+const MeshBounds & Mesh::GetBounds() const
+{
+	return _bounds;
+}
+
+const MeshGPUData * Mesh::GetCookedGPUData( VERTEX_LAYOUT vertex_layout ) const
+{
+	if( nullptr == _cooked_gpu_data || _cooked_gpu_data->vertex_layout != vertex_layout ) return nullptr;
+	return _cooked_gpu_data.get();
 }
 
 uint32_t Mesh::GetVerticesByteSize()
@@ -319,3 +720,43 @@ uint32_t Mesh::GetIndicesByteSize()
 {
 	return triangles.size() * sizeof( Triangle );
 }
+
+void Mesh::_CalculateBounds()
+{
+	_bounds						= MeshBounds();
+	if( vertices.empty() ) return;
+
+	for( int c=0; c < 3; ++c ) {
+		_bounds.min[ c ]		= vertices[ 0 ].position[ c ];
+		_bounds.max[ c ]		= vertices[ 0 ].position[ c ];
+	}
+	for( auto & v : vertices ) {
+		for( int c=0; c < 3; ++c ) {
+			_bounds.min[ c ]	= std::min( _bounds.min[ c ], v.position[ c ] );
+			_bounds.max[ c ]	= std::max( _bounds.max[ c ], v.position[ c ] );
+		}
+	}
+	for( int c=0; c < 3; ++c ) {
+		_bounds.center[ c ]		= ( _bounds.min[ c ] + _bounds.max[ c ] ) * 0.5f;
+	}
+
+	// the farthest vertex rather than the box corner, usually a good deal tighter for round meshes
+	_GrowBounds( 0, vertices.size() );
+}
+
+void Mesh::_GrowBounds( size_t first_vertex, size_t vertex_count )
+{
+	float radius_squared		= _bounds.radius * _bounds.radius;
+	for( size_t i=first_vertex; i < first_vertex + vertex_count; ++i ) {
+		auto & p				= vertices[ i ].position;
+		float distance_squared	= 0.0f;
+		for( int c=0; c < 3; ++c ) {
+			_bounds.min[ c ]	= std::min( _bounds.min[ c ], p[ c ] );
+			_bounds.max[ c ]	= std::max( _bounds.max[ c ], p[ c ] );
+			float d				= p[ c ] - _bounds.center[ c ];
+			distance_squared	+= d * d;
+		}
+		radius_squared			= std::max( radius_squared, distance_squared );
+	}
+	_bounds.radius				= std::sqrt( radius_squared );
+}
@@ -1,9 +1,18 @@
 #pragma once
 
+#include "VertexLayout.h"
+
 #include <stdint.h>
+#include <memory>
 #include <vector>
 #include <string>
 
+class ME3D_MappedFile;
+struct MeshGPUData;
+struct MeshOptimizationReport;
+struct MeshWeldStatistics;
+struct MeshLODSettings;
+
 enum class MESH_OBJECT_SHAPE
 {
 	NONE,
@@ -24,6 +33,34 @@ struct Triangle
 	uint32_t indices[ 3 ];
 };
 
+// Simplified version of a mesh using the same vertices.
+struct MeshLOD
+{
+	std::vector<Triangle>	triangles;
+	float					error					= 0.0f;		// how far the surface may be from the full detail one, in mesh units
+};
+
+// Vertices written since a revision, lets GPU copies upload only what changed.
+struct MeshVertexChange
+{
+	uint64_t				revision				= 0;
+	uint32_t				first_vertex			= 0;
+	uint32_t				vertex_count			= 0;
+};
+
+// more separate changes than this are merged into one range
+constexpr size_t			MESH_MAX_VERTEX_CHANGES		= 32;
+
+// Axis aligned box and a sphere around every vertex, in mesh units. The sphere is centered on the box
+// when the bounds are calculated from all vertices, partial changes only grow both.
+struct MeshBounds
+{
+	float					min[ 3 ]				= { 0.0f, 0.0f, 0.0f };
+	float					max[ 3 ]				= { 0.0f, 0.0f, 0.0f };
+	float					center[ 3 ]				= { 0.0f, 0.0f, 0.0f };
+	float					radius					= 0.0f;
+};
+
 class Mesh
 {
 public:
@@ -31,11 +68,49 @@ public:
 	~Mesh();
 
 	void					GenerateShape( MESH_OBJECT_SHAPE shape );
-	void					Load( std::string path );
+	void					Load( std::string path );		// ME3D version 1, 2 or cooked files
+	bool					SaveCooked( std::string path, VERTEX_LAYOUT vertex_layout ) const;	// saves vertices, indices and clusters as GPUMesh uploads them, see MeshGPUData.h
+	void					Optimize( MeshOptimizationReport * report = nullptr );	// reorders triangles and vertices for the GPU, see MeshOptimizer.h
+	void					WeldVertices( MeshWeldStatistics * statistics = nullptr );	// merges identical vertices
+	void					GenerateLODs( const MeshLODSettings & settings );			// fills lods, see MeshSimplifier.h
+
+	uint64_t				CalculateContentHash() const;		// same for meshes with identical vertices, triangles and levels of detail
+	bool					HasSameContents( const Mesh & other ) const;
+
+	// call after writing to vertices, GPU copies upload the changed vertices on their next draw
+	void					MarkVerticesChanged();												// every vertex, vertex count may have changed too
+	void					MarkVerticesChanged( size_t first_vertex, size_t vertex_count );
+	uint64_t				GetVertexRevision() const;
+	bool					GetVerticesChangedSince( uint64_t revision, size_t * first_vertex, size_t * vertex_count ) const;	// false if nothing changed
+
+	// call after writing to triangles or lods, GPU copies build their index buffers again on their next draw
+	void					MarkTrianglesChanged();
+	uint64_t				GetTriangleRevision() const;
+
+	// calculated when the mesh is generated or loaded and kept up to date by MarkVerticesChanged()
+	const MeshBounds	&	GetBounds() const;
+
+	// what a cooked file held when it was cooked for this layout, nullptr otherwise or once the vertices changed
+	const MeshGPUData	*	GetCookedGPUData( VERTEX_LAYOUT vertex_layout ) const;
 
 	uint32_t				GetVerticesByteSize();
 	uint32_t				GetIndicesByteSize();
 
 	std::vector<Vertex>		vertices;
 	std::vector<Triangle>	triangles;
+	std::vector<MeshLOD>	lods;				// coarser levels after triangles, index the same vertices
+
+private:
+	void					_LoadME3DVersion2( const ME3D_MappedFile & file );
+	void					_LoadME3DCooked( const ME3D_MappedFile & file );
+	void					_ClearIfIndicesInvalid();		// after loading, triangles pointing past the vertices leave an empty mesh
+	void					_CalculateBounds();
+	void					_GrowBounds( size_t first_vertex, size_t vertex_count );
+
+	uint64_t						_vertex_revision				= 0;
+	uint64_t						_all_vertices_revision			= 0;		// last change of every vertex
+	std::vector<MeshVertexChange>	_vertex_changes;							// partial changes after that
+	uint64_t						_triangle_revision				= 0;
+	MeshBounds						_bounds;
+	std::shared_ptr<const MeshGPUData>	_cooked_gpu_data;						// dropped by any change to the mesh
 };
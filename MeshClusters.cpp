@@ -0,0 +1,239 @@
+#include "MeshClusters.h"
+
+#include "Mesh.h"
+#include "FrustumCulling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <assert.h>
+
+constexpr uint32_t MESH_CLUSTERS_INVALID				= UINT32_MAX;
+
+// normals closer than this to the cone edge make the apex run off to infinity, such clusters aren't cone culled
+constexpr float MESH_CLUSTERS_MIN_CONE_SPREAD			= 0.1f;
+
+// cos of the widest angle a triangle may have to the average normal of the cluster it joins
+constexpr float MESH_CLUSTERS_MIN_NORMAL_AGREEMENT		= 0.5f;
+
+glm::vec3 MeshClusters_GetPosition( const std::vector<Vertex> & vertices, uint32_t index )
+{
+	auto & p = vertices[ index ].position;
+	return glm::vec3( p[ 0 ], p[ 1 ], p[ 2 ] );
+}
+
+// unit length, zero for degenerate triangles
+glm::vec3 MeshClusters_GetNormal( const Triangle & triangle, const std::vector<Vertex> & vertices )
+{
+	auto p0				= MeshClusters_GetPosition( vertices, triangle.indices[ 0 ] );
+	glm::vec3 normal	= glm::cross( MeshClusters_GetPosition( vertices, triangle.indices[ 1 ] ) - p0, MeshClusters_GetPosition( vertices, triangle.indices[ 2 ] ) - p0 );
+	float area			= glm::length( normal );
+	return area > 0.0f ? normal / area : glm::vec3( 0.0f );
+}
+
+void MeshClusters_ComputeBounds( MeshCluster & cluster, const std::vector<Triangle> & triangles, const std::vector<Vertex> & vertices )
+{
+	// sphere around the bounding box, not the tightest but good enough for clusters this small
+	glm::vec3 min_position	= MeshClusters_GetPosition( vertices, triangles[ cluster.first_triangle ].indices[ 0 ] );
+	glm::vec3 max_position	= min_position;
+	for( uint32_t t = cluster.first_triangle; t < cluster.first_triangle + cluster.triangle_count; ++t ) {
+		for( auto index : triangles[ t ].indices ) {
+			auto p			= MeshClusters_GetPosition( vertices, index );
+			min_position	= glm::min( min_position, p );
+			max_position	= glm::max( max_position, p );
+		}
+	}
+	glm::vec3 center		= ( min_position + max_position ) * 0.5f;
+	float radius			= 0.0f;
+	for( uint32_t t = cluster.first_triangle; t < cluster.first_triangle + cluster.triangle_count; ++t ) {
+		for( auto index : triangles[ t ].indices ) {
+			radius			= std::max( radius, glm::length( MeshClusters_GetPosition( vertices, index ) - center ) );
+		}
+	}
+
+	// cone axis is the average triangle normal, degenerate triangles have no say
+	std::vector<glm::vec3> normals( cluster.triangle_count, glm::vec3( 0.0f ) );
+	glm::vec3 axis			= glm::vec3( 0.0f );
+	for( uint32_t i=0; i < cluster.triangle_count; ++i ) {
+		normals[ i ]		= MeshClusters_GetNormal( triangles[ cluster.first_triangle + i ], vertices );
+		axis				+= normals[ i ];
+	}
+
+	for( size_t c=0; c < 3; ++c ) {
+		cluster.center[ c ]		= center[ c ];
+	}
+	cluster.radius			= radius;
+	cluster.cone_cutoff		= 2.0f;
+	float axis_length		= glm::length( axis );
+	if( axis_length <= 0.0f ) return;
+	axis					/= axis_length;
+
+	float min_spread		= 1.0f;
+	for( auto & n : normals ) {
+		if( n != glm::vec3( 0.0f ) ) min_spread = std::min( min_spread, glm::dot( n, axis ) );
+	}
+	if( min_spread < MESH_CLUSTERS_MIN_CONE_SPREAD ) return;
+
+	// move the apex back along the axis until every triangle plane is behind it
+	float max_t				= 0.0f;
+	for( uint32_t i=0; i < cluster.triangle_count; ++i ) {
+		if( normals[ i ] == glm::vec3( 0.0f ) ) continue;
+		for( auto index : triangles[ cluster.first_triangle + i ].indices ) {
+			float t			= glm::dot( center - MeshClusters_GetPosition( vertices, index ), normals[ i ] ) / glm::dot( axis, normals[ i ] );
+			max_t			= std::max( max_t, t );
+		}
+	}
+	glm::vec3 apex			= center - axis * max_t;
+	for( size_t c=0; c < 3; ++c ) {
+		cluster.cone_apex[ c ]	= apex[ c ];
+		cluster.cone_axis[ c ]	= axis[ c ];
+	}
+	cluster.cone_cutoff		= std::sqrt( 1.0f - min_spread * min_spread );
+}
+
+void MeshClusters_Build( std::vector<Triangle> & triangles, const std::vector<Vertex> & vertices, std::vector<MeshCluster> & clusters )
+{
+	clusters.clear();
+	if( triangles.empty() ) return;
+
+	// triangles using each vertex
+	std::vector<uint32_t> adjacency_offsets( vertices.size() + 1, 0 );
+	for( auto & t : triangles ) {
+		for( auto index : t.indices ) ++adjacency_offsets[ index + 1 ];
+	}
+	for( size_t v=0; v < vertices.size(); ++v ) {
+		adjacency_offsets[ v + 1 ] += adjacency_offsets[ v ];
+	}
+	std::vector<uint32_t> adjacency( adjacency_offsets.back() );
+	{
+		std::vector<uint32_t> fill( adjacency_offsets.begin(), adjacency_offsets.end() - 1 );
+		for( uint32_t t=0; t < triangles.size(); ++t ) {
+			for( auto index : triangles[ t ].indices ) adjacency[ fill[ index ]++ ] = t;
+		}
+	}
+
+	std::vector<Triangle> ordered;
+	ordered.reserve( triangles.size() );
+	std::vector<bool> emitted( triangles.size(), false );
+	std::vector<uint32_t> vertex_cluster( vertices.size(), MESH_CLUSTERS_INVALID );		// cluster each vertex was last added to
+	std::vector<uint32_t> cluster_vertices;
+	uint32_t next_seed			= 0;
+
+	auto CountNewVertices = [ & ]( uint32_t triangle, uint32_t cluster_index ) {
+		uint32_t count			= 0;
+		for( auto index : triangles[ triangle ].indices ) {
+			if( vertex_cluster[ index ] != cluster_index ) ++count;
+		}
+		// a triangle can use the same vertex twice
+		auto & i				= triangles[ triangle ].indices;
+		if( vertex_cluster[ i[ 0 ] ] != cluster_index && ( i[ 0 ] == i[ 1 ] || i[ 0 ] == i[ 2 ] ) ) --count;
+		if( vertex_cluster[ i[ 1 ] ] != cluster_index && i[ 1 ] == i[ 2 ] ) --count;
+		return count;
+	};
+
+	while( ordered.size() < triangles.size() ) {
+		while( emitted[ next_seed ] ) ++next_seed;
+
+		uint32_t cluster_index	= uint32_t( clusters.size() );
+		MeshCluster cluster;
+		cluster.first_triangle	= uint32_t( ordered.size() );
+		cluster_vertices.clear();
+
+		uint32_t candidate		= next_seed;
+		glm::vec3 normal_sum	= glm::vec3( 0.0f );
+		while( MESH_CLUSTERS_INVALID != candidate ) {
+			emitted[ candidate ]	= true;
+			normal_sum				+= MeshClusters_GetNormal( triangles[ candidate ], vertices );
+			ordered.push_back( triangles[ candidate ] );
+			++cluster.triangle_count;
+			for( auto index : triangles[ candidate ].indices ) {
+				if( vertex_cluster[ index ] == cluster_index ) continue;
+				vertex_cluster[ index ]	= cluster_index;
+				cluster_vertices.push_back( index );
+			}
+			if( cluster.triangle_count >= MESH_CLUSTERS_MAX_TRIANGLES ) break;
+
+			// grow over the neighbour sharing the most vertices, this keeps clusters compact,
+			// neighbours bending too far away from the cluster would make it impossible to cone cull
+			glm::vec3 cluster_normal	= glm::length( normal_sum ) > 0.0f ? glm::normalize( normal_sum ) : glm::vec3( 0.0f );
+			candidate				= MESH_CLUSTERS_INVALID;
+			uint32_t best_new		= UINT32_MAX;
+			for( auto v : cluster_vertices ) {
+				for( uint32_t a = adjacency_offsets[ v ]; a < adjacency_offsets[ v + 1 ]; ++a ) {
+					uint32_t t		= adjacency[ a ];
+					if( emitted[ t ] ) continue;
+					auto normal		= MeshClusters_GetNormal( triangles[ t ], vertices );
+					if( normal != glm::vec3( 0.0f ) && glm::dot( normal, cluster_normal ) < MESH_CLUSTERS_MIN_NORMAL_AGREEMENT ) continue;
+					uint32_t new_vertices = CountNewVertices( t, cluster_index );
+					if( cluster_vertices.size() + new_vertices > MESH_CLUSTERS_MAX_VERTICES ) continue;
+					if( new_vertices < best_new || ( new_vertices == best_new && t < candidate ) ) {
+						best_new	= new_vertices;
+						candidate	= t;
+					}
+				}
+			}
+		}
+
+		clusters.push_back( cluster );
+	}
+
+	triangles.swap( ordered );
+	for( auto & c : clusters ) {
+		MeshClusters_ComputeBounds( c, triangles, vertices );
+	}
+}
+
+size_t MeshClusters_Cull(
+	const std::vector<MeshCluster>		&	clusters,
+	const glm::mat4						&	model_view_projection,
+	const glm::vec3						&	camera_position,
+	const std::vector<MeshDrawRange>	&	draw_ranges,
+	std::vector<MeshDrawRange>			&	visible_ranges )
+{
+	visible_ranges.clear();
+
+	// frustum planes in mesh space
+	auto frustum			= Frustum_FromMatrix( model_view_projection );
+
+	size_t visible_triangles	= 0;
+	size_t draw_range			= 0;
+	for( auto & c : clusters ) {
+		glm::vec3 center( c.center[ 0 ], c.center[ 1 ], c.center[ 2 ] );
+		bool visible		= true;
+		for( auto & p : frustum.planes ) {
+			if( glm::dot( glm::vec3( p ), center ) + p.w < -c.radius ) {
+				visible		= false;
+				break;
+			}
+		}
+		if( visible && c.cone_cutoff <= 1.0f ) {
+			glm::vec3 apex( c.cone_apex[ 0 ], c.cone_apex[ 1 ], c.cone_apex[ 2 ] );
+			glm::vec3 axis( c.cone_axis[ 0 ], c.cone_axis[ 1 ], c.cone_axis[ 2 ] );
+			// a camera at the apex gives nan and stays visible
+			if( glm::dot( glm::normalize( apex - camera_position ), axis ) >= c.cone_cutoff ) visible = false;
+		}
+		if( !visible ) continue;
+		visible_triangles	+= c.triangle_count;
+
+		// split at draw range borders, merge with the previous range when they touch
+		uint32_t first_index	= c.first_triangle * 3;
+		uint32_t end_index		= first_index + c.triangle_count * 3;
+		while( draw_range < draw_ranges.size() && draw_ranges[ draw_range ].first_index + draw_ranges[ draw_range ].index_count <= first_index ) ++draw_range;
+		for( size_t r = draw_range; r < draw_ranges.size() && draw_ranges[ r ].first_index < end_index; ++r ) {
+			auto & range		= draw_ranges[ r ];
+			uint32_t begin		= std::max( first_index, range.first_index );
+			uint32_t end		= std::min( end_index, range.first_index + range.index_count );
+			if( !visible_ranges.empty() &&
+				visible_ranges.back().vertex_offset == range.vertex_offset &&
+				visible_ranges.back().first_index + visible_ranges.back().index_count == begin ) {
+				visible_ranges.back().index_count += end - begin;
+			} else {
+				MeshDrawRange visible_range;
+				visible_range.first_index	= begin;
+				visible_range.index_count	= end - begin;
+				visible_range.vertex_offset	= range.vertex_offset;
+				visible_ranges.push_back( visible_range );
+			}
+		}
+	}
+	return visible_triangles;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Platform.h"
+#include "MeshIndices.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Vertex;
+struct Triangle;
+
+// Cluster limits, small enough that a cluster is mostly flat and mostly in one place.
+// 124 triangles leaves room for a 4 byte header in 128 byte chunks if these ever go to mesh shaders.
+constexpr size_t MESH_CLUSTERS_MAX_VERTICES				= 64;
+constexpr size_t MESH_CLUSTERS_MAX_TRIANGLES			= 124;
+
+// Meshes with fewer triangles are drawn whole, culling them piece by piece isn't worth the CPU time.
+constexpr size_t MESH_CLUSTERS_MIN_MESH_TRIANGLES		= 1024;
+
+// Consecutive triangles of a mesh with bounds for culling, everything is in mesh space.
+struct MeshCluster
+{
+	uint32_t				first_triangle			= 0;
+	uint32_t				triangle_count			= 0;
+
+	float					center[ 3 ]				= { 0.0f, 0.0f, 0.0f };		// bounding sphere
+	float					radius					= 0.0f;
+
+	// every triangle faces away from a camera inside the cone with this apex and axis,
+	// opening up to cone_cutoff = cos( angle ), a cutoff above 1 means the cluster can't be cone culled
+	float					cone_apex[ 3 ]			= { 0.0f, 0.0f, 0.0f };
+	float					cone_axis[ 3 ]			= { 0.0f, 0.0f, 1.0f };
+	float					cone_cutoff				= 2.0f;
+};
+
+// Groups triangles into clusters by growing each one over neighbouring triangles, triangles
+// are reordered so every cluster is a consecutive range. Vertices don't change.
+void MeshClusters_Build( std::vector<Triangle> & triangles, const std::vector<Vertex> & vertices, std::vector<MeshCluster> & clusters );
+
+// Culls clusters outside the frustum and clusters facing away from the camera, triangles are front
+// facing when counter clockwise like in our pipelines. Surviving clusters are merged into as few
+// ranges as possible, split at draw_ranges so 16 bit indices keep working.
+// model_view_projection maps mesh space to clip space, camera_position is in mesh space.
+// Returns the number of visible triangles.
+size_t MeshClusters_Cull(
+	const std::vector<MeshCluster>		&	clusters,
+	const glm::mat4						&	model_view_projection,
+	const glm::vec3						&	camera_position,
+	const std::vector<MeshDrawRange>	&	draw_ranges,
+	std::vector<MeshDrawRange>			&	visible_ranges );
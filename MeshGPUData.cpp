@@ -0,0 +1,107 @@
+#include "MeshGPUData.h"
+
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cstring>
+#include <assert.h>
+
+void MeshGPUData_Build( const Mesh & mesh, VERTEX_LAYOUT vertex_layout, bool build_clusters, MeshGPUData * data )
+{
+	assert( nullptr != data );
+	data->vertex_layout		= vertex_layout;
+	VertexLayout_Encode( vertex_layout, mesh.vertices, data->vertex_data, &data->dequantization );
+
+	// clusters reorder triangles so they have to be built before the indices are encoded, the mesh itself stays as is
+	std::vector<Triangle> triangles;
+	std::vector<uint32_t> first_triangles;
+	data->lods.clear();
+	data->lods.resize( 1 + mesh.lods.size() );
+	for( size_t level=0; level < data->lods.size(); ++level ) {
+		auto lod_triangles			= 0 == level ? mesh.triangles : mesh.lods[ level - 1 ].triangles;
+		auto & lod					= data->lods[ level ];
+		lod.error					= 0 == level ? 0.0f : mesh.lods[ level - 1 ].error;
+		if( build_clusters && lod_triangles.size() >= MESH_CLUSTERS_MIN_MESH_TRIANGLES ) {
+			MeshClusters_Build( lod_triangles, mesh.vertices, lod.clusters );
+			for( auto & c : lod.clusters ) c.first_triangle += uint32_t( triangles.size() );
+		}
+		first_triangles.push_back( uint32_t( triangles.size() ) );
+		triangles.insert( triangles.end(), lod_triangles.begin(), lod_triangles.end() );
+	}
+
+	// eg. a dynamic mesh that lost vertices without its triangles being updated
+	assert( std::all_of( triangles.begin(), triangles.end(), [ &mesh ]( const Triangle & t ) {
+		return t.indices[ 0 ] < mesh.vertices.size() && t.indices[ 1 ] < mesh.vertices.size() && t.indices[ 2 ] < mesh.vertices.size();
+	} ) && "Triangle indexes past the vertices." );
+
+	MeshIndexData index_data;
+	MeshIndices_Encode( triangles, mesh.vertices.size(), &index_data );
+	data->index_type		= index_data.type;
+	data->index_data		= std::move( index_data.data );
+	for( size_t level=0; level < data->lods.size(); ++level ) {
+		uint32_t triangle_count		= uint32_t( ( level + 1 < data->lods.size() ? first_triangles[ level + 1 ] : triangles.size() ) - first_triangles[ level ] );
+		data->lods[ level ].draw_ranges	= MeshIndices_ClipRanges( index_data.ranges, first_triangles[ level ] * 3, triangle_count * 3 );
+	}
+}
+
+// writes the range's indices with the vertex offset added, false if one points outside of the vertices
+template<typename T>
+bool MeshGPUData_DecodeRange( const std::vector<uint8_t> & index_data, const MeshDrawRange & range, size_t vertex_count, uint32_t * dst )
+{
+	const uint8_t * src		= index_data.data() + size_t( range.first_index ) * sizeof( T );
+	for( uint32_t i=0; i < range.index_count; ++i ) {
+		T index				= 0;
+		std::memcpy( &index, src + i * sizeof( T ), sizeof( T ) );
+		int64_t vertex		= int64_t( index ) + range.vertex_offset;
+		if( vertex < 0 || uint64_t( vertex ) >= vertex_count ) return false;
+		dst[ i ]			= uint32_t( vertex );
+	}
+	return true;
+}
+
+bool MeshGPUData_Decode( const MeshGPUData & data, std::vector<Vertex> & vertices, std::vector<Triangle> & triangles, std::vector<MeshLOD> & lods )
+{
+	vertices.clear();
+	triangles.clear();
+	lods.clear();
+
+	size_t stride			= VertexLayout_GetStride( data.vertex_layout );
+	size_t index_size		= MeshIndices_GetIndexSize( data.index_type );
+	if( data.lods.empty() || 0 == stride || data.vertex_data.size() % stride != 0 || data.index_data.size() % index_size != 0 ) return false;
+	size_t vertex_count		= data.vertex_data.size() / stride;
+	size_t index_count		= data.index_data.size() / index_size;
+
+	std::vector<std::vector<Triangle>> levels( data.lods.size() );
+	for( size_t level=0; level < data.lods.size(); ++level ) {
+		// ranges are checked before allocating for them
+		size_t level_index_count	= 0;
+		for( auto & range : data.lods[ level ].draw_ranges ) {
+			if( range.index_count % 3 != 0 || size_t( range.first_index ) + range.index_count > index_count ) return false;
+			level_index_count		+= range.index_count;
+		}
+		if( level_index_count > index_count ) return false;
+
+		levels[ level ].resize( level_index_count / 3 );
+		auto dst					= reinterpret_cast<uint32_t*>( levels[ level ].data() );
+		for( auto & range : data.lods[ level ].draw_ranges ) {
+			bool valid				= INDEX_TYPE::UINT16 == data.index_type
+				? MeshGPUData_DecodeRange<uint16_t>( data.index_data, range, vertex_count, dst )
+				: MeshGPUData_DecodeRange<uint32_t>( data.index_data, range, vertex_count, dst );
+			if( !valid ) return false;
+			dst						+= range.index_count;
+		}
+		for( auto & cluster : data.lods[ level ].clusters ) {
+			if( ( size_t( cluster.first_triangle ) + cluster.triangle_count ) * 3 > index_count ) return false;
+		}
+	}
+
+	VertexLayout_Decode( data.vertex_layout, data.vertex_data, data.dequantization, vertices );
+	triangles				= std::move( levels[ 0 ] );
+	for( size_t level=1; level < levels.size(); ++level ) {
+		MeshLOD lod;
+		lod.triangles		= std::move( levels[ level ] );
+		lod.error			= data.lods[ level ].error;
+		lods.push_back( std::move( lod ) );
+	}
+	return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "VertexLayout.h"
+#include "MeshIndices.h"
+#include "MeshClusters.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Mesh;
+struct MeshLOD;
+
+struct GPUMeshLOD
+{
+	float						error						= 0.0f;		// in mesh units, zero for full detail
+	std::vector<MeshCluster>	clusters;								// empty for small meshes
+	std::vector<MeshDrawRange>	draw_ranges;
+};
+
+// Everything a GPUMesh uploads for a mesh in one vertex layout, built when the GPUMesh is created
+// or once offline and stored in cooked ME3D files so loading them skips the work.
+// Levels of detail go one after another into the same index buffer, clusters reorder
+// the triangles of each level and index their part of the buffer.
+struct MeshGPUData
+{
+	VERTEX_LAYOUT				vertex_layout				= VERTEX_LAYOUT::FLOAT32;
+	std::vector<uint8_t>		vertex_data;
+	VertexDequantization		dequantization;
+	INDEX_TYPE					index_type					= INDEX_TYPE::UINT32;
+	std::vector<uint8_t>		index_data;
+	std::vector<GPUMeshLOD>		lods;									// full detail first
+};
+
+// Clusters are left out when build_clusters is false, eg. for meshes whose vertices keep moving.
+void MeshGPUData_Build( const Mesh & mesh, VERTEX_LAYOUT vertex_layout, bool build_clusters, MeshGPUData * data );
+
+// Turns the data back into mesh vertices and triangles, in the triangle order of the index buffer.
+// Returns false if ranges or clusters reach outside of the buffers, eg. for a corrupt cooked file.
+bool MeshGPUData_Decode( const MeshGPUData & data, std::vector<Vertex> & vertices, std::vector<Triangle> & triangles, std::vector<MeshLOD> & lods );
@@ -0,0 +1,97 @@
+#include "MeshIndices.h"
+
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cstring>
+#include <assert.h>
+
+constexpr uint32_t MESH_INDICES_UINT16_VERTEX_LIMIT		= 1 << 16;
+
+size_t MeshIndices_GetIndexSize( INDEX_TYPE type )
+{
+	return INDEX_TYPE::UINT16 == type ? sizeof( uint16_t ) : sizeof( uint32_t );
+}
+
+// splits triangles into ranges that reference less than 65536 consecutive vertices
+std::vector<MeshDrawRange> MeshIndices_FindUInt16Ranges( const std::vector<Triangle> & triangles )
+{
+	std::vector<MeshDrawRange> ranges;
+	MeshDrawRange current;
+	uint32_t range_min		= UINT32_MAX;
+	uint32_t range_max		= 0;
+	for( size_t t=0; t < triangles.size(); ++t ) {
+		auto & indices		= triangles[ t ].indices;
+		uint32_t new_min	= std::min( { range_min, indices[ 0 ], indices[ 1 ], indices[ 2 ] } );
+		uint32_t new_max	= std::max( { range_max, indices[ 0 ], indices[ 1 ], indices[ 2 ] } );
+		if( new_max - new_min >= MESH_INDICES_UINT16_VERTEX_LIMIT ) {
+			current.vertex_offset	= int32_t( range_min );
+			ranges.push_back( current );
+			current					= MeshDrawRange();
+			current.first_index		= uint32_t( t * 3 );
+			new_min					= std::min( { indices[ 0 ], indices[ 1 ], indices[ 2 ] } );
+			new_max					= std::max( { indices[ 0 ], indices[ 1 ], indices[ 2 ] } );
+			if( new_max - new_min >= MESH_INDICES_UINT16_VERTEX_LIMIT ) return {};		// a single triangle can't be made to fit
+		}
+		range_min			= new_min;
+		range_max			= new_max;
+		current.index_count	+= 3;
+	}
+	if( current.index_count ) {
+		current.vertex_offset = int32_t( range_min );
+		ranges.push_back( current );
+	}
+	return ranges;
+}
+
+void MeshIndices_Encode( const std::vector<Triangle> & triangles, size_t vertex_count, MeshIndexData * index_data )
+{
+	assert( nullptr != index_data );
+	*index_data				= MeshIndexData();
+
+	std::vector<MeshDrawRange> ranges;
+	if( vertex_count <= MESH_INDICES_UINT16_VERTEX_LIMIT ) {
+		MeshDrawRange range;
+		range.index_count	= uint32_t( triangles.size() * 3 );
+		ranges.push_back( range );
+	} else {
+		ranges = MeshIndices_FindUInt16Ranges( triangles );
+		if( ranges.empty() || triangles.size() / ranges.size() < MESH_INDICES_MIN_RANGE_TRIANGLES ) {
+			// not worth it, one 32 bit draw
+			MeshDrawRange range;
+			range.index_count	= uint32_t( triangles.size() * 3 );
+			index_data->type	= INDEX_TYPE::UINT32;
+			index_data->ranges.push_back( range );
+			index_data->data.resize( triangles.size() * sizeof( Triangle ) );
+			if( triangles.size() ) std::memcpy( index_data->data.data(), triangles.data(), index_data->data.size() );
+			return;
+		}
+	}
+
+	index_data->type		= INDEX_TYPE::UINT16;
+	index_data->ranges		= ranges;
+	index_data->data.resize( triangles.size() * 3 * sizeof( uint16_t ) );
+	auto out = reinterpret_cast<uint16_t*>( index_data->data.data() );
+	for( auto & r : ranges ) {
+		for( uint32_t i = r.first_index; i < r.first_index + r.index_count; ++i ) {
+			out[ i ] = uint16_t( triangles[ i / 3 ].indices[ i % 3 ] - uint32_t( r.vertex_offset ) );
+		}
+	}
+}
+
+std::vector<MeshDrawRange> MeshIndices_ClipRanges( const std::vector<MeshDrawRange> & ranges, uint32_t first_index, uint32_t index_count )
+{
+	std::vector<MeshDrawRange> clipped;
+	uint32_t end_index		= first_index + index_count;
+	for( auto & r : ranges ) {
+		uint32_t begin		= std::max( first_index, r.first_index );
+		uint32_t end		= std::min( end_index, r.first_index + r.index_count );
+		if( begin >= end ) continue;
+		MeshDrawRange range;
+		range.first_index	= begin;
+		range.index_count	= end - begin;
+		range.vertex_offset	= r.vertex_offset;
+		clipped.push_back( range );
+	}
+	return clipped;
+}
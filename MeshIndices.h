@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Triangle;
+
+enum class INDEX_TYPE
+{
+	UINT16,
+	UINT32,
+};
+
+// Meshes whose 16 bit ranges would average fewer triangles than this stay 32 bit,
+// more draw calls would cost more than the smaller indices save.
+constexpr size_t MESH_INDICES_MIN_RANGE_TRIANGLES		= 4096;
+
+// Part of the index buffer drawn with one call, indices are relative to vertex_offset.
+struct MeshDrawRange
+{
+	uint32_t				first_index			= 0;
+	uint32_t				index_count			= 0;
+	int32_t					vertex_offset		= 0;
+};
+
+// Index buffer contents in their final GPU form.
+struct MeshIndexData
+{
+	INDEX_TYPE					type			= INDEX_TYPE::UINT32;
+	std::vector<uint8_t>		data;
+	std::vector<MeshDrawRange>	ranges;
+};
+
+size_t MeshIndices_GetIndexSize( INDEX_TYPE type );
+
+// Picks 16 bit indices whenever every index fits, meshes with more vertices are split into
+// ranges that each reference less than 65536 consecutive vertices. Works best after
+// MeshOptimizer_OptimizeVertexFetch as indices then grow steadily with the triangle order.
+void MeshIndices_Encode( const std::vector<Triangle> & triangles, size_t vertex_count, MeshIndexData * index_data );
+
+// Parts of ranges inside [ first_index, first_index + index_count ), eg. one level of detail out of an index buffer holding several.
+std::vector<MeshDrawRange> MeshIndices_ClipRanges( const std::vector<MeshDrawRange> & ranges, uint32_t first_index, uint32_t index_count );
@@ -0,0 +1,440 @@
+#include "MeshOptimizer.h"
+
+#include "Platform.h"
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <assert.h>
+
+constexpr uint32_t MESH_OPTIMIZER_FORSYTH_CACHE_SIZE		= 32;		// modelled LRU cache, a bit bigger than real hardware works best
+constexpr float MESH_OPTIMIZER_FORSYTH_LAST_TRIANGLE_SCORE	= 0.75f;
+constexpr float MESH_OPTIMIZER_FORSYTH_CACHE_DECAY_POWER	= 1.5f;
+constexpr float MESH_OPTIMIZER_FORSYTH_VALENCE_BOOST_SCALE	= 2.0f;
+constexpr float MESH_OPTIMIZER_FORSYTH_VALENCE_BOOST_POWER	= 0.5f;
+
+constexpr uint32_t MESH_OPTIMIZER_OVERDRAW_RESOLUTION		= 256;		// analysis viewport size per axis
+constexpr size_t MESH_OPTIMIZER_MIN_CLUSTER_SIZE			= 16;		// in triangles
+
+constexpr uint32_t MESH_OPTIMIZER_INVALID					= UINT32_MAX;
+
+void MeshOptimizationReport::Print( std::ostream & stream ) const
+{
+	stream << "ACMR: " << cache_before.acmr << " -> " << cache_after.acmr << std::endl;
+	stream << "ATVR: " << cache_before.atvr << " -> " << cache_after.atvr << std::endl;
+	stream << "Overdraw: " << overdraw_before << " -> " << overdraw_after << std::endl;
+}
+
+// FNV-1a over the raw bytes, welding is about exact duplicates so this is all we need
+size_t MeshOptimizer_HashVertex( const Vertex & vertex )
+{
+	const uint8_t * bytes	= reinterpret_cast<const uint8_t*>( &vertex );
+	uint64_t hash			= 14695981039346656037ull;
+	for( size_t i=0; i < sizeof( Vertex ); ++i ) {
+		hash				= ( hash ^ bytes[ i ] ) * 1099511628211ull;
+	}
+	return size_t( hash ^ ( hash >> 32 ) );
+}
+
+MeshWeldStatistics MeshOptimizer_WeldVertices( std::vector<Vertex> & vertices, std::vector<Triangle> & triangles )
+{
+	static_assert( sizeof( Vertex ) == sizeof( float ) * 8, "Vertex must not have padding, it's compared byte by byte." );
+
+	MeshWeldStatistics stats;
+	stats.vertices_before	= vertices.size();
+	stats.vertices_after	= vertices.size();
+	if( vertices.empty() ) return stats;
+
+	// open addressing table of indices into the welded vertices, at most half full
+	size_t table_size		= 1;
+	while( table_size < vertices.size() * 2 ) table_size *= 2;
+	std::vector<uint32_t> table( table_size, MESH_OPTIMIZER_INVALID );
+
+	std::vector<uint32_t> remap( vertices.size() );
+	size_t welded_count		= 0;
+	for( size_t v=0; v < vertices.size(); ++v ) {
+		size_t slot = MeshOptimizer_HashVertex( vertices[ v ] ) & ( table_size - 1 );
+		while( MESH_OPTIMIZER_INVALID != table[ slot ] && std::memcmp( &vertices[ table[ slot ] ], &vertices[ v ], sizeof( Vertex ) ) != 0 ) {
+			slot = ( slot + 1 ) & ( table_size - 1 );
+		}
+		if( MESH_OPTIMIZER_INVALID == table[ slot ] ) {
+			// first of its kind, compacting in place is safe as welded_count never passes v
+			vertices[ welded_count ]	= vertices[ v ];
+			table[ slot ]				= uint32_t( welded_count++ );
+		}
+		remap[ v ] = table[ slot ];
+	}
+	if( welded_count == vertices.size() ) return stats;
+
+	for( auto & t : triangles ) {
+		for( auto & index : t.indices ) index = remap[ index ];
+	}
+	vertices.resize( welded_count );
+	stats.vertices_after	= welded_count;
+	return stats;
+}
+
+MeshVertexCacheStatistics MeshOptimizer_AnalyzeVertexCache( const std::vector<Triangle> & triangles, size_t vertex_count, uint32_t cache_size )
+{
+	MeshVertexCacheStatistics stats;
+	if( triangles.empty() ) return stats;
+
+	// a vertex is in the cache if it was pushed less than cache_size misses ago
+	std::vector<size_t> cache_timestamps( vertex_count, 0 );
+	std::vector<bool> used( vertex_count, false );
+	size_t timestamp		= cache_size + 1;
+	size_t misses			= 0;
+	size_t used_count		= 0;
+	for( auto & t : triangles ) {
+		for( auto index : t.indices ) {
+			assert( index < vertex_count );
+			if( timestamp - cache_timestamps[ index ] > cache_size ) {
+				cache_timestamps[ index ]	= timestamp++;
+				++misses;
+			}
+			if( !used[ index ] ) {
+				used[ index ]	= true;
+				++used_count;
+			}
+		}
+	}
+	stats.acmr				= float( misses ) / float( triangles.size() );
+	stats.atvr				= float( misses ) / float( used_count );
+	return stats;
+}
+
+// returns pixels covered and adds the number of pixels that passed the depth test to shaded
+size_t MeshOptimizer_RasterizeOverdraw( const std::vector<glm::vec3> & positions, const std::vector<Triangle> & triangles, std::vector<float> & depth_buffer, size_t * shaded )
+{
+	const float size = float( MESH_OPTIMIZER_OVERDRAW_RESOLUTION );
+	std::fill( depth_buffer.begin(), depth_buffer.end(), std::numeric_limits<float>::max() );
+
+	for( auto & t : triangles ) {
+		const glm::vec3 & a = positions[ t.indices[ 0 ] ];
+		const glm::vec3 & b = positions[ t.indices[ 1 ] ];
+		const glm::vec3 & c = positions[ t.indices[ 2 ] ];
+
+		float area = ( b.x - a.x ) * ( c.y - a.y ) - ( b.y - a.y ) * ( c.x - a.x );
+		if( area == 0.0f ) continue;
+
+		// pixel centers inside the bounding box, edge functions decide coverage
+		int32_t min_x = std::max( int32_t( std::ceil( std::min( { a.x, b.x, c.x } ) - 0.5f ) ), 0 );
+		int32_t max_x = std::min( int32_t( std::ceil( std::max( { a.x, b.x, c.x } ) - 0.5f ) ), int32_t( size ) );
+		int32_t min_y = std::max( int32_t( std::ceil( std::min( { a.y, b.y, c.y } ) - 0.5f ) ), 0 );
+		int32_t max_y = std::min( int32_t( std::ceil( std::max( { a.y, b.y, c.y } ) - 0.5f ) ), int32_t( size ) );
+		for( int32_t y = min_y; y < max_y; ++y ) {
+			for( int32_t x = min_x; x < max_x; ++x ) {
+				float px = x + 0.5f;
+				float py = y + 0.5f;
+				float w0 = ( ( c.x - b.x ) * ( py - b.y ) - ( c.y - b.y ) * ( px - b.x ) ) / area;
+				float w1 = ( ( a.x - c.x ) * ( py - c.y ) - ( a.y - c.y ) * ( px - c.x ) ) / area;
+				float w2 = 1.0f - w0 - w1;
+				if( w0 < 0.0f || w1 < 0.0f || w2 < 0.0f ) continue;
+
+				float depth = w0 * a.z + w1 * b.z + w2 * c.z;
+				auto & stored = depth_buffer[ size_t( y ) * MESH_OPTIMIZER_OVERDRAW_RESOLUTION + x ];
+				if( depth < stored ) {
+					stored = depth;
+					++( *shaded );
+				}
+			}
+		}
+	}
+
+	size_t covered = 0;
+	for( auto d : depth_buffer ) {
+		if( d != std::numeric_limits<float>::max() ) ++covered;
+	}
+	return covered;
+}
+
+float MeshOptimizer_AnalyzeOverdraw( const std::vector<Vertex> & vertices, const std::vector<Triangle> & triangles )
+{
+	if( vertices.empty() || triangles.empty() ) return 0.0f;
+
+	glm::vec3 min_position( std::numeric_limits<float>::max() );
+	glm::vec3 max_position( -std::numeric_limits<float>::max() );
+	for( auto & v : vertices ) {
+		glm::vec3 p( v.position[ 0 ], v.position[ 1 ], v.position[ 2 ] );
+		min_position = glm::min( min_position, p );
+		max_position = glm::max( max_position, p );
+	}
+	glm::vec3 extent		= max_position - min_position;
+	float scale				= std::max( { extent.x, extent.y, extent.z } );
+	scale					= scale > 0.0f ? 1.0f / scale : 0.0f;
+
+	std::vector<float> depth_buffer( size_t( MESH_OPTIMIZER_OVERDRAW_RESOLUTION ) * MESH_OPTIMIZER_OVERDRAW_RESOLUTION );
+	std::vector<glm::vec3> positions( vertices.size() );
+	size_t shaded			= 0;
+	size_t covered			= 0;
+	for( int axis = 0; axis < 3; ++axis ) {
+		for( float direction : { 1.0f, -1.0f } ) {
+			// look along the axis, the other two become the screen coordinates
+			for( size_t i=0; i < vertices.size(); ++i ) {
+				glm::vec3 p			= ( glm::vec3( vertices[ i ].position[ 0 ], vertices[ i ].position[ 1 ], vertices[ i ].position[ 2 ] ) - min_position ) * scale;
+				positions[ i ].x	= p[ ( axis + 1 ) % 3 ] * MESH_OPTIMIZER_OVERDRAW_RESOLUTION;
+				positions[ i ].y	= p[ ( axis + 2 ) % 3 ] * MESH_OPTIMIZER_OVERDRAW_RESOLUTION;
+				positions[ i ].z	= p[ axis ] * direction;
+			}
+			covered			+= MeshOptimizer_RasterizeOverdraw( positions, triangles, depth_buffer, &shaded );
+		}
+	}
+	return covered ? float( shaded ) / float( covered ) : 0.0f;
+}
+
+float MeshOptimizer_ForsythVertexScore( uint32_t cache_position, uint32_t remaining_triangles )
+{
+	if( 0 == remaining_triangles ) return -1.0f;
+
+	float score = 0.0f;
+	if( MESH_OPTIMIZER_INVALID != cache_position ) {
+		if( cache_position < 3 ) {
+			// the triangle that was just drawn, deliberately lower so we don't keep walking in a strip
+			score	= MESH_OPTIMIZER_FORSYTH_LAST_TRIANGLE_SCORE;
+		} else {
+			float scaler	= 1.0f / ( MESH_OPTIMIZER_FORSYTH_CACHE_SIZE - 3 );
+			score			= std::pow( 1.0f - ( cache_position - 3 ) * scaler, MESH_OPTIMIZER_FORSYTH_CACHE_DECAY_POWER );
+		}
+	}
+	// finish off vertices with only a few triangles left so they can leave the cache for good
+	score += MESH_OPTIMIZER_FORSYTH_VALENCE_BOOST_SCALE * std::pow( float( remaining_triangles ), -MESH_OPTIMIZER_FORSYTH_VALENCE_BOOST_POWER );
+	return score;
+}
+
+void MeshOptimizer_OptimizeVertexCache( std::vector<Triangle> & triangles, size_t vertex_count )
+{
+	size_t triangle_count = triangles.size();
+	if( 0 == triangle_count ) return;
+
+	// triangles using each vertex, the first remaining_triangles[ v ] of them haven't been drawn yet
+	std::vector<uint32_t> adjacency_offsets( vertex_count + 1, 0 );
+	for( auto & t : triangles ) {
+		for( auto index : t.indices ) ++adjacency_offsets[ index + 1 ];
+	}
+	for( size_t i=0; i < vertex_count; ++i ) {
+		adjacency_offsets[ i + 1 ] += adjacency_offsets[ i ];
+	}
+	std::vector<uint32_t> remaining_triangles( vertex_count, 0 );
+	std::vector<uint32_t> adjacency( triangle_count * 3 );
+	for( size_t t=0; t < triangle_count; ++t ) {
+		for( auto index : triangles[ t ].indices ) {
+			adjacency[ adjacency_offsets[ index ] + remaining_triangles[ index ]++ ] = uint32_t( t );
+		}
+	}
+
+	std::vector<uint32_t> cache_positions( vertex_count, MESH_OPTIMIZER_INVALID );
+	std::vector<float> vertex_scores( vertex_count );
+	for( size_t v=0; v < vertex_count; ++v ) {
+		vertex_scores[ v ] = MeshOptimizer_ForsythVertexScore( MESH_OPTIMIZER_INVALID, remaining_triangles[ v ] );
+	}
+	std::vector<float> triangle_scores( triangle_count );
+	std::vector<bool> emitted( triangle_count, false );
+	uint32_t best_triangle		= 0;
+	for( size_t t=0; t < triangle_count; ++t ) {
+		auto & indices			= triangles[ t ].indices;
+		triangle_scores[ t ]	= vertex_scores[ indices[ 0 ] ] + vertex_scores[ indices[ 1 ] ] + vertex_scores[ indices[ 2 ] ];
+		if( triangle_scores[ t ] > triangle_scores[ best_triangle ] ) best_triangle = uint32_t( t );
+	}
+
+	std::vector<Triangle> result;
+	result.reserve( triangle_count );
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> new_cache;
+	cache.reserve( MESH_OPTIMIZER_FORSYTH_CACHE_SIZE + 3 );
+	new_cache.reserve( MESH_OPTIMIZER_FORSYTH_CACHE_SIZE + 3 );
+	size_t search_cursor		= 0;
+
+	while( result.size() < triangle_count ) {
+		if( MESH_OPTIMIZER_INVALID == best_triangle ) {
+			// nothing in the cache has triangles left, continue from the next one in the original order
+			while( emitted[ search_cursor ] ) ++search_cursor;
+			best_triangle		= uint32_t( search_cursor );
+		}
+
+		auto & triangle			= triangles[ best_triangle ];
+		result.push_back( triangle );
+		emitted[ best_triangle ] = true;
+
+		// new cache has the triangle vertices first, then the old contents without them
+		new_cache.clear();
+		for( auto index : triangle.indices ) {
+			new_cache.push_back( index );
+
+			uint32_t * begin	= &adjacency[ adjacency_offsets[ index ] ];
+			uint32_t * end		= begin + remaining_triangles[ index ];
+			auto it				= std::find( begin, end, best_triangle );
+			assert( it != end );
+			std::swap( *it, *( end - 1 ) );
+			--remaining_triangles[ index ];
+		}
+		for( auto index : cache ) {
+			if( index != triangle.indices[ 0 ] && index != triangle.indices[ 1 ] && index != triangle.indices[ 2 ] ) {
+				new_cache.push_back( index );
+			}
+		}
+
+		// rescore everything that is or just was in the cache
+		for( size_t i=0; i < new_cache.size(); ++i ) {
+			auto index					= new_cache[ i ];
+			cache_positions[ index ]	= i < MESH_OPTIMIZER_FORSYTH_CACHE_SIZE ? uint32_t( i ) : MESH_OPTIMIZER_INVALID;
+			vertex_scores[ index ]		= MeshOptimizer_ForsythVertexScore( cache_positions[ index ], remaining_triangles[ index ] );
+		}
+
+		best_triangle					= MESH_OPTIMIZER_INVALID;
+		float best_score				= -std::numeric_limits<float>::max();
+		for( auto index : new_cache ) {
+			uint32_t * begin			= &adjacency[ adjacency_offsets[ index ] ];
+			uint32_t * end				= begin + remaining_triangles[ index ];
+			for( auto it = begin; it != end; ++it ) {
+				auto & indices			= triangles[ *it ].indices;
+				float score				= vertex_scores[ indices[ 0 ] ] + vertex_scores[ indices[ 1 ] ] + vertex_scores[ indices[ 2 ] ];
+				triangle_scores[ *it ]	= score;
+				if( score > best_score ) {
+					best_score			= score;
+					best_triangle		= *it;
+				}
+			}
+		}
+
+		if( new_cache.size() > MESH_OPTIMIZER_FORSYTH_CACHE_SIZE ) new_cache.resize( MESH_OPTIMIZER_FORSYTH_CACHE_SIZE );
+		std::swap( cache, new_cache );
+	}
+	triangles = std::move( result );
+}
+
+struct MeshOptimizerCluster
+{
+	size_t			begin		= 0;
+	size_t			end			= 0;
+	float			sort_key	= 0.0f;
+};
+
+void MeshOptimizer_OptimizeOverdraw( std::vector<Triangle> & triangles, const std::vector<Vertex> & vertices, float threshold )
+{
+	size_t triangle_count = triangles.size();
+	if( triangle_count < MESH_OPTIMIZER_MIN_CLUSTER_SIZE * 2 ) return;
+
+	// hard boundaries are where the cache optimizer had to start from scratch, all three vertices miss
+	std::vector<size_t> hard_boundaries;
+	{
+		std::vector<size_t> cache_timestamps( vertices.size(), 0 );
+		size_t timestamp = MESH_OPTIMIZER_ANALYZE_CACHE_SIZE + 1;
+		for( size_t t=0; t < triangle_count; ++t ) {
+			uint32_t misses = 0;
+			for( auto index : triangles[ t ].indices ) {
+				if( timestamp - cache_timestamps[ index ] > MESH_OPTIMIZER_ANALYZE_CACHE_SIZE ) {
+					cache_timestamps[ index ] = timestamp++;
+					++misses;
+				}
+			}
+			if( 3 == misses ) hard_boundaries.push_back( t );
+		}
+		hard_boundaries.push_back( triangle_count );
+	}
+
+	// split hard clusters further as long as the pieces keep cache efficiency close to the whole
+	std::vector<MeshOptimizerCluster> clusters;
+	std::vector<size_t> cache_timestamps( vertices.size(), 0 );
+	size_t timestamp = 0;
+	for( size_t h=0; h + 1 < hard_boundaries.size(); ++h ) {
+		size_t hard_begin	= hard_boundaries[ h ];
+		size_t hard_end		= hard_boundaries[ h + 1 ];
+
+		std::vector<Triangle> hard_cluster( triangles.begin() + hard_begin, triangles.begin() + hard_end );
+		float hard_acmr		= MeshOptimizer_AnalyzeVertexCache( hard_cluster, vertices.size() ).acmr;
+
+		size_t begin		= hard_begin;
+		size_t misses		= 0;
+		timestamp			+= MESH_OPTIMIZER_ANALYZE_CACHE_SIZE + 1;		// invalidates the whole cache
+		for( size_t t = hard_begin; t < hard_end; ++t ) {
+			for( auto index : triangles[ t ].indices ) {
+				if( timestamp - cache_timestamps[ index ] > MESH_OPTIMIZER_ANALYZE_CACHE_SIZE ) {
+					cache_timestamps[ index ] = timestamp++;
+					++misses;
+				}
+			}
+			size_t count = t + 1 - begin;
+			if( count >= MESH_OPTIMIZER_MIN_CLUSTER_SIZE && hard_end - ( t + 1 ) >= MESH_OPTIMIZER_MIN_CLUSTER_SIZE
+				&& float( misses ) / float( count ) <= hard_acmr * threshold ) {
+				MeshOptimizerCluster cluster;
+				cluster.begin	= begin;
+				cluster.end		= t + 1;
+				clusters.push_back( cluster );
+				begin			= t + 1;
+				misses			= 0;
+				timestamp		+= MESH_OPTIMIZER_ANALYZE_CACHE_SIZE + 1;
+			}
+		}
+		if( begin < hard_end ) {
+			MeshOptimizerCluster cluster;
+			cluster.begin		= begin;
+			cluster.end			= hard_end;
+			clusters.push_back( cluster );
+		}
+	}
+	if( clusters.size() < 2 ) return;
+
+	// clusters facing away from the middle of the mesh are drawn first
+	auto Position = [ &vertices ]( uint32_t index ) {
+		return glm::vec3( vertices[ index ].position[ 0 ], vertices[ index ].position[ 1 ], vertices[ index ].position[ 2 ] );
+	};
+	glm::vec3 mesh_center( 0.0f );
+	float mesh_area = 0.0f;
+	std::vector<glm::vec3> cluster_centers( clusters.size(), glm::vec3( 0.0f ) );
+	std::vector<glm::vec3> cluster_normals( clusters.size(), glm::vec3( 0.0f ) );
+	for( size_t c=0; c < clusters.size(); ++c ) {
+		float cluster_area = 0.0f;
+		for( size_t t = clusters[ c ].begin; t < clusters[ c ].end; ++t ) {
+			auto & indices	= triangles[ t ].indices;
+			glm::vec3 a		= Position( indices[ 0 ] );
+			glm::vec3 b		= Position( indices[ 1 ] );
+			glm::vec3 c3	= Position( indices[ 2 ] );
+			glm::vec3 n		= glm::cross( b - a, c3 - a );
+			float area		= glm::length( n );
+			cluster_centers[ c ]	+= ( a + b + c3 ) * ( area / 3.0f );
+			cluster_normals[ c ]	+= n;
+			cluster_area			+= area;
+		}
+		mesh_center			+= cluster_centers[ c ];
+		mesh_area			+= cluster_area;
+		cluster_centers[ c ] = cluster_area > 0.0f ? cluster_centers[ c ] / cluster_area : Position( triangles[ clusters[ c ].begin ].indices[ 0 ] );
+	}
+	if( mesh_area > 0.0f ) mesh_center /= mesh_area;
+	for( size_t c=0; c < clusters.size(); ++c ) {
+		float length			= glm::length( cluster_normals[ c ] );
+		glm::vec3 normal		= length > 0.0f ? cluster_normals[ c ] / length : glm::vec3( 0.0f );
+		clusters[ c ].sort_key	= glm::dot( cluster_centers[ c ] - mesh_center, normal );
+	}
+	std::stable_sort( clusters.begin(), clusters.end(), []( const MeshOptimizerCluster & a, const MeshOptimizerCluster & b ) {
+		return a.sort_key > b.sort_key;
+	} );
+
+	std::vector<Triangle> result;
+	result.reserve( triangle_count );
+	for( auto & c : clusters ) {
+		result.insert( result.end(), triangles.begin() + c.begin, triangles.begin() + c.end );
+	}
+	triangles = std::move( result );
+}
+
+void MeshOptimizer_OptimizeVertexFetch( std::vector<Vertex> & vertices, std::vector<Triangle> & triangles )
+{
+	std::vector<uint32_t> remap( vertices.size(), MESH_OPTIMIZER_INVALID );
+	std::vector<Vertex> result;
+	result.reserve( vertices.size() );
+	for( auto & t : triangles ) {
+		for( auto & index : t.indices ) {
+			if( MESH_OPTIMIZER_INVALID == remap[ index ] ) {
+				remap[ index ] = uint32_t( result.size() );
+				result.push_back( vertices[ index ] );
+			}
+			index = remap[ index ];
+		}
+	}
+	for( size_t v=0; v < vertices.size(); ++v ) {
+		if( MESH_OPTIMIZER_INVALID == remap[ v ] ) result.push_back( vertices[ v ] );
+	}
+	vertices = std::move( result );
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+struct Vertex;
+struct Triangle;
+
+// Size of the simulated post-transform vertex cache used for statistics, FIFO like most hardware.
+constexpr uint32_t MESH_OPTIMIZER_ANALYZE_CACHE_SIZE		= 16;
+
+// Clusters are allowed to be this much worse than the cache optimized order
+// when splitting it up for overdraw sorting, bigger values mean smaller clusters.
+constexpr float MESH_OPTIMIZER_OVERDRAW_THRESHOLD			= 1.05f;
+
+struct MeshVertexCacheStatistics
+{
+	float			acmr					= 0.0f;		// average cache miss ratio, transformed vertices per triangle, 0.5 at best
+	float			atvr					= 0.0f;		// average transform to vertex ratio, 1.0 at best
+};
+
+struct MeshWeldStatistics
+{
+	size_t			vertices_before			= 0;
+	size_t			vertices_after			= 0;
+};
+
+struct MeshOptimizationReport
+{
+	MeshVertexCacheStatistics	cache_before;
+	MeshVertexCacheStatistics	cache_after;
+	float						overdraw_before			= 0.0f;		// shaded pixels per covered pixel, 1.0 at best
+	float						overdraw_after			= 0.0f;
+
+	void						Print( std::ostream & stream ) const;
+};
+
+// Merges vertices that are bit for bit identical, keeps the first of each and remaps triangles to it.
+// Vertex order of the survivors doesn't change.
+MeshWeldStatistics MeshOptimizer_WeldVertices( std::vector<Vertex> & vertices, std::vector<Triangle> & triangles );
+
+// Simulates a FIFO post-transform cache over the triangles in their current order.
+MeshVertexCacheStatistics MeshOptimizer_AnalyzeVertexCache( const std::vector<Triangle> & triangles, size_t vertex_count, uint32_t cache_size = MESH_OPTIMIZER_ANALYZE_CACHE_SIZE );
+
+// Rasterizes the mesh from the six axis directions with depth testing and returns how many
+// times each covered pixel was shaded on average, it's an estimate, triangles are drawn double sided.
+float MeshOptimizer_AnalyzeOverdraw( const std::vector<Vertex> & vertices, const std::vector<Triangle> & triangles );
+
+// Reorders triangles for post-transform vertex cache efficiency. ( Tom Forsyth, Linear-Speed Vertex Cache Optimisation )
+void MeshOptimizer_OptimizeVertexCache( std::vector<Triangle> & triangles, size_t vertex_count );
+
+// Splits a cache optimized triangle order into clusters and sorts the clusters so that
+// outwards facing ones come first, this way later ones are more likely to fail the depth test.
+// ( Sander, Nehab, Barczak, Fast Triangle Reordering for Vertex Locality and Reduced Overdraw )
+void MeshOptimizer_OptimizeOverdraw( std::vector<Triangle> & triangles, const std::vector<Vertex> & vertices, float threshold = MESH_OPTIMIZER_OVERDRAW_THRESHOLD );
+
+// Renumbers vertices in the order triangles first use them so vertex fetches stay sequential.
+// Vertices no triangle uses are moved to the end.
+void MeshOptimizer_OptimizeVertexFetch( std::vector<Vertex> & vertices, std::vector<Triangle> & triangles );
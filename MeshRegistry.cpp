@@ -0,0 +1,107 @@
+#include "MeshRegistry.h"
+
+#include "GPUMesh.h"
+#include "Renderer.h"
+
+#include <assert.h>
+
+MeshRegistry::MeshRegistry( Renderer * renderer )
+{
+	assert( nullptr != renderer );
+	_ref_renderer	= renderer;
+}
+
+MeshRegistry::~MeshRegistry()
+{
+}
+
+std::shared_ptr<GPUMesh> MeshRegistry::AcquireFile( std::string path, VERTEX_LAYOUT vertex_layout )
+{
+	_RemoveExpired();
+
+	auto file = _files.find( path );
+	if( file != _files.end() ) {
+		return _FindOrAddGPUMesh( file->second.lock(), vertex_layout, GPU_MESH_STORAGE::STATIC );
+	}
+
+	// the same model can be in several files, content decides in the end
+	std::unique_ptr<Mesh> loaded( new Mesh );
+	loaded->Load( path );
+	auto mesh		= _FindOrAddMesh( std::move( loaded ) );
+	_files[ path ]	= mesh;
+	return _FindOrAddGPUMesh( mesh, vertex_layout, GPU_MESH_STORAGE::STATIC );
+}
+
+std::shared_ptr<GPUMesh> MeshRegistry::AcquireMesh( std::unique_ptr<Mesh> mesh, VERTEX_LAYOUT vertex_layout )
+{
+	assert( nullptr != mesh );
+	_RemoveExpired();
+	return _FindOrAddGPUMesh( _FindOrAddMesh( std::move( mesh ) ), vertex_layout, GPU_MESH_STORAGE::STATIC );
+}
+
+std::shared_ptr<GPUMesh> MeshRegistry::AcquireShape( MESH_OBJECT_SHAPE shape, VERTEX_LAYOUT vertex_layout )
+{
+	std::unique_ptr<Mesh> mesh( new Mesh );
+	mesh->GenerateShape( shape );
+	return AcquireMesh( std::move( mesh ), vertex_layout );
+}
+
+std::shared_ptr<GPUMesh> MeshRegistry::AcquireDynamicMesh( std::shared_ptr<Mesh> mesh, VERTEX_LAYOUT vertex_layout )
+{
+	assert( nullptr != mesh );
+	_RemoveExpired();
+	return _FindOrAddGPUMesh( std::move( mesh ), vertex_layout, GPU_MESH_STORAGE::DYNAMIC );
+}
+
+size_t MeshRegistry::GetMeshCount()
+{
+	_RemoveExpired();
+	return _meshes.size();
+}
+
+size_t MeshRegistry::GetGPUMeshCount()
+{
+	_RemoveExpired();
+	return _gpu_meshes.size();
+}
+
+std::shared_ptr<const Mesh> MeshRegistry::_FindOrAddMesh( std::unique_ptr<Mesh> mesh )
+{
+	uint64_t hash	= mesh->CalculateContentHash();
+	auto range		= _meshes.equal_range( hash );
+	for( auto it = range.first; it != range.second; ++it ) {
+		auto existing = it->second.lock();
+		if( existing && existing->HasSameContents( *mesh ) ) return existing;
+	}
+
+	std::shared_ptr<const Mesh> added( std::move( mesh ) );
+	_meshes.insert( { hash, added } );
+	return added;
+}
+
+std::shared_ptr<GPUMesh> MeshRegistry::_FindOrAddGPUMesh( std::shared_ptr<const Mesh> mesh, VERTEX_LAYOUT vertex_layout, GPU_MESH_STORAGE storage )
+{
+	assert( nullptr != mesh );
+	auto & entry	= _gpu_meshes[ { mesh.get(), vertex_layout } ];
+	auto gpu_mesh	= entry.lock();
+	assert( !gpu_mesh || gpu_mesh->GetStorage() == storage );
+	if( !gpu_mesh ) {
+		gpu_mesh	= std::make_shared<GPUMesh>( _ref_renderer, mesh, vertex_layout, storage );
+		entry		= gpu_mesh;
+	}
+	return gpu_mesh;
+}
+
+void MeshRegistry::_RemoveExpired()
+{
+	// GPU meshes hold on to their CPU mesh so these expire first, a freed mesh address can't be found again after this
+	for( auto it = _gpu_meshes.begin(); it != _gpu_meshes.end(); ) {
+		it = it->second.expired() ? _gpu_meshes.erase( it ) : std::next( it );
+	}
+	for( auto it = _files.begin(); it != _files.end(); ) {
+		it = it->second.expired() ? _files.erase( it ) : std::next( it );
+	}
+	for( auto it = _meshes.begin(); it != _meshes.end(); ) {
+		it = it->second.expired() ? _meshes.erase( it ) : std::next( it );
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Platform.h"
+#include "Mesh.h"
+#include "VertexLayout.h"
+#include "GPUMesh.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+class Renderer;
+
+// Hands out shared meshes so every scene object drawing the same model uses one CPU copy
+// and one set of GPU buffers per vertex layout. Meshes are found by file path and by content,
+// the registry only keeps weak references so a mesh goes away with the last object using it.
+class MeshRegistry
+{
+public:
+	MeshRegistry( Renderer * renderer );
+	~MeshRegistry();
+
+	std::shared_ptr<GPUMesh>			AcquireFile( std::string path, VERTEX_LAYOUT vertex_layout );			// loads the file only if nothing uses it yet
+	std::shared_ptr<GPUMesh>			AcquireMesh( std::unique_ptr<Mesh> mesh, VERTEX_LAYOUT vertex_layout );	// already loaded meshes, eg. from AssetLoader
+	std::shared_ptr<GPUMesh>			AcquireShape( MESH_OBJECT_SHAPE shape, VERTEX_LAYOUT vertex_layout );
+	// the caller keeps writing to the mesh and marks what changed, see Mesh::MarkVerticesChanged() and MarkTrianglesChanged().
+	// Never shared by content as the content doesn't stay the same, buffers are host visible and there are no clusters.
+	// Everything else is static and lives in device local memory.
+	std::shared_ptr<GPUMesh>			AcquireDynamicMesh( std::shared_ptr<Mesh> mesh, VERTEX_LAYOUT vertex_layout );
+
+	size_t								GetMeshCount();			// CPU meshes in use
+	size_t								GetGPUMeshCount();		// GPU buffer sets in use
+
+private:
+	std::shared_ptr<const Mesh>			_FindOrAddMesh( std::unique_ptr<Mesh> mesh );
+	std::shared_ptr<GPUMesh>			_FindOrAddGPUMesh( std::shared_ptr<const Mesh> mesh, VERTEX_LAYOUT vertex_layout, GPU_MESH_STORAGE storage );
+	void								_RemoveExpired();
+
+	Renderer						*	_ref_renderer				= nullptr;
+
+	std::multimap<uint64_t, std::weak_ptr<const Mesh>>							_meshes;		// by content hash, hashes may collide
+	std::map<std::string, std::weak_ptr<const Mesh>>							_files;			// by path
+	std::map<std::pair<const Mesh*, VERTEX_LAYOUT>, std::weak_ptr<GPUMesh>>		_gpu_meshes;
+};
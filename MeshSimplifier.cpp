@@ -0,0 +1,239 @@
+#include "MeshSimplifier.h"
+
+#include "Platform.h"
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <assert.h>
+
+constexpr uint32_t MESH_SIMPLIFIER_INVALID				= UINT32_MAX;
+
+// Symmetric 4x4 matrix, sum of squared distances to a set of planes.
+struct MeshSimplifier_Quadric
+{
+	double			xx = 0, xy = 0, xz = 0, xw = 0;
+	double			yy = 0, yz = 0, yw = 0;
+	double			zz = 0, zw = 0;
+	double			ww = 0;
+
+	void Add( const MeshSimplifier_Quadric & other )
+	{
+		xx += other.xx; xy += other.xy; xz += other.xz; xw += other.xw;
+		yy += other.yy; yz += other.yz; yw += other.yw;
+		zz += other.zz; zw += other.zw;
+		ww += other.ww;
+	}
+
+	void AddPlane( const glm::vec3 & normal, float distance )
+	{
+		double a = normal.x, b = normal.y, c = normal.z, d = distance;
+		xx += a * a; xy += a * b; xz += a * c; xw += a * d;
+		yy += b * b; yz += b * c; yw += b * d;
+		zz += c * c; zw += c * d;
+		ww += d * d;
+	}
+
+	double Evaluate( const glm::vec3 & p ) const
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double error = xx * x * x + 2 * xy * x * y + 2 * xz * x * z + 2 * xw * x
+			+ yy * y * y + 2 * yz * y * z + 2 * yw * y
+			+ zz * z * z + 2 * zw * z
+			+ ww;
+		return std::max( error, 0.0 );		// rounding can make it slightly negative
+	}
+};
+
+glm::vec3 MeshSimplifier_GetPosition( const std::vector<Vertex> & vertices, uint32_t index )
+{
+	auto & p = vertices[ index ].position;
+	return glm::vec3( p[ 0 ], p[ 1 ], p[ 2 ] );
+}
+
+// Returns the first vertex sharing the position of each vertex, vertices split at uv seams end up together.
+std::vector<uint32_t> MeshSimplifier_FindPositionGroups( const std::vector<Vertex> & vertices )
+{
+	std::vector<uint32_t> order( vertices.size() );
+	for( uint32_t v=0; v < vertices.size(); ++v ) order[ v ] = v;
+	auto Less = [ &vertices ]( uint32_t a, uint32_t b ) {
+		auto & pa = vertices[ a ].position;
+		auto & pb = vertices[ b ].position;
+		if( pa[ 0 ] != pb[ 0 ] ) return pa[ 0 ] < pb[ 0 ];
+		if( pa[ 1 ] != pb[ 1 ] ) return pa[ 1 ] < pb[ 1 ];
+		if( pa[ 2 ] != pb[ 2 ] ) return pa[ 2 ] < pb[ 2 ];
+		return a < b;
+	};
+	std::sort( order.begin(), order.end(), Less );
+
+	std::vector<uint32_t> group( vertices.size() );
+	for( size_t i=0; i < order.size(); ++i ) {
+		auto & p		= vertices[ order[ i ] ].position;
+		bool same		= i > 0 && std::equal( p, p + 3, vertices[ order[ i - 1 ] ].position );
+		group[ order[ i ] ] = same ? group[ order[ i - 1 ] ] : order[ i ];
+	}
+	return group;
+}
+
+// Vertices that must not move, anything on an open border or on a uv seam.
+std::vector<bool> MeshSimplifier_FindLockedVertices( const std::vector<Triangle> & triangles, const std::vector<uint32_t> & group )
+{
+	size_t vertex_count = group.size();
+	std::vector<uint32_t> group_size( vertex_count, 0 );
+	for( auto g : group ) ++group_size[ g ];
+
+	// an edge is on a border when no triangle uses it in the opposite direction
+	std::vector<uint64_t> edges;
+	edges.reserve( triangles.size() * 3 );
+	for( auto & t : triangles ) {
+		for( size_t e=0; e < 3; ++e ) {
+			uint64_t a = group[ t.indices[ e ] ];
+			uint64_t b = group[ t.indices[ ( e + 1 ) % 3 ] ];
+			edges.push_back( ( a << 32 ) | b );
+		}
+	}
+	std::sort( edges.begin(), edges.end() );
+
+	std::vector<bool> locked_group( vertex_count, false );
+	for( auto edge : edges ) {
+		uint64_t reverse = ( edge << 32 ) | ( edge >> 32 );
+		if( !std::binary_search( edges.begin(), edges.end(), reverse ) ) {
+			locked_group[ edge >> 32 ]			= true;
+			locked_group[ edge & 0xffffffff ]	= true;
+		}
+	}
+
+	std::vector<bool> locked( vertex_count, false );
+	for( size_t v=0; v < vertex_count; ++v ) {
+		locked[ v ] = locked_group[ group[ v ] ] || group_size[ group[ v ] ] > 1;
+	}
+	return locked;
+}
+
+std::vector<Triangle> MeshSimplifier_Simplify( const std::vector<Vertex> & vertices, const std::vector<Triangle> & triangles, size_t target_triangle_count, float max_error, float * result_error )
+{
+	std::vector<Triangle> result	= triangles;
+	double worst_cost				= 0.0;
+	if( nullptr != result_error ) *result_error = 0.0f;
+	if( result.size() <= target_triangle_count || vertices.empty() ) return result;
+
+	auto group		= MeshSimplifier_FindPositionGroups( vertices );
+	auto locked		= MeshSimplifier_FindLockedVertices( result, group );
+
+	// quadrics live on position groups so vertices on seams share one
+	std::vector<MeshSimplifier_Quadric> quadrics( vertices.size() );
+	for( auto & t : result ) {
+		auto p0				= MeshSimplifier_GetPosition( vertices, t.indices[ 0 ] );
+		glm::vec3 normal	= glm::cross( MeshSimplifier_GetPosition( vertices, t.indices[ 1 ] ) - p0, MeshSimplifier_GetPosition( vertices, t.indices[ 2 ] ) - p0 );
+		float length		= glm::length( normal );
+		if( length <= 0.0f ) continue;
+		normal				/= length;
+		MeshSimplifier_Quadric q;
+		q.AddPlane( normal, -glm::dot( normal, p0 ) );
+		for( auto index : t.indices ) quadrics[ group[ index ] ].Add( q );
+	}
+
+	double max_cost		= double( max_error ) * double( max_error );
+	std::vector<uint32_t> adjacency_offsets;
+	std::vector<uint32_t> adjacency;
+	std::vector<double> best_cost( vertices.size() );
+	std::vector<uint32_t> best_target( vertices.size() );
+	std::vector<uint32_t> candidates;
+	std::vector<bool> touched( vertices.size() );
+	std::vector<uint32_t> remap( vertices.size() );
+
+	// collapses are done in passes, each pass only touches a vertex once so every flip check stays valid
+	while( result.size() > target_triangle_count ) {
+		adjacency_offsets.assign( vertices.size() + 1, 0 );
+		for( auto & t : result ) {
+			for( auto index : t.indices ) ++adjacency_offsets[ index + 1 ];
+		}
+		for( size_t v=0; v < vertices.size(); ++v ) adjacency_offsets[ v + 1 ] += adjacency_offsets[ v ];
+		adjacency.resize( adjacency_offsets.back() );
+		{
+			std::vector<uint32_t> fill( adjacency_offsets.begin(), adjacency_offsets.end() - 1 );
+			for( uint32_t t=0; t < result.size(); ++t ) {
+				for( auto index : result[ t ].indices ) adjacency[ fill[ index ]++ ] = t;
+			}
+		}
+
+		// cheapest collapse for every vertex that may move
+		std::fill( best_cost.begin(), best_cost.end(), std::numeric_limits<double>::max() );
+		std::fill( best_target.begin(), best_target.end(), MESH_SIMPLIFIER_INVALID );
+		for( auto & t : result ) {
+			for( size_t e=0; e < 6; ++e ) {
+				uint32_t from	= t.indices[ e % 3 ];
+				uint32_t to		= t.indices[ e < 3 ? ( e + 1 ) % 3 : ( e + 2 ) % 3 ];
+				if( locked[ from ] || from == to ) continue;
+				MeshSimplifier_Quadric q	= quadrics[ group[ from ] ];
+				q.Add( quadrics[ group[ to ] ] );
+				double cost		= q.Evaluate( MeshSimplifier_GetPosition( vertices, to ) );
+				if( cost < best_cost[ from ] ) {
+					best_cost[ from ]	= cost;
+					best_target[ from ]	= to;
+				}
+			}
+		}
+		candidates.clear();
+		for( uint32_t v=0; v < vertices.size(); ++v ) {
+			if( MESH_SIMPLIFIER_INVALID != best_target[ v ] && best_cost[ v ] <= max_cost ) candidates.push_back( v );
+		}
+		std::sort( candidates.begin(), candidates.end(), [ &best_cost ]( uint32_t a, uint32_t b ) { return best_cost[ a ] < best_cost[ b ]; } );
+
+		std::fill( touched.begin(), touched.end(), false );
+		for( uint32_t v=0; v < vertices.size(); ++v ) remap[ v ] = v;
+		size_t removed_goal		= result.size() - target_triangle_count;
+		size_t removed			= 0;
+		size_t collapses		= 0;
+		for( auto from : candidates ) {
+			uint32_t to			= best_target[ from ];
+			if( touched[ from ] || touched[ to ] ) continue;
+
+			// triangles around from must not turn over, the ones on the collapsed edge disappear
+			bool flips			= false;
+			size_t disappearing	= 0;
+			for( uint32_t a = adjacency_offsets[ from ]; a < adjacency_offsets[ from + 1 ] && !flips; ++a ) {
+				auto & t		= result[ adjacency[ a ] ];
+				if( t.indices[ 0 ] == to || t.indices[ 1 ] == to || t.indices[ 2 ] == to ) {
+					++disappearing;
+					continue;
+				}
+				glm::vec3 p[ 3 ];
+				glm::vec3 moved[ 3 ];
+				for( size_t i=0; i < 3; ++i ) {
+					p[ i ]		= MeshSimplifier_GetPosition( vertices, t.indices[ i ] );
+					moved[ i ]	= MeshSimplifier_GetPosition( vertices, t.indices[ i ] == from ? to : t.indices[ i ] );
+				}
+				glm::vec3 before	= glm::cross( p[ 1 ] - p[ 0 ], p[ 2 ] - p[ 0 ] );
+				glm::vec3 after		= glm::cross( moved[ 1 ] - moved[ 0 ], moved[ 2 ] - moved[ 0 ] );
+				if( before != glm::vec3( 0.0f ) && glm::dot( before, after ) <= 0.0f ) flips = true;
+			}
+			if( flips ) continue;
+
+			remap[ from ]		= to;
+			quadrics[ group[ to ] ].Add( quadrics[ group[ from ] ] );
+			for( uint32_t a = adjacency_offsets[ from ]; a < adjacency_offsets[ from + 1 ]; ++a ) {
+				for( auto index : result[ adjacency[ a ] ].indices ) touched[ index ] = true;
+			}
+			worst_cost			= std::max( worst_cost, best_cost[ from ] );
+			removed				+= disappearing;
+			++collapses;
+			if( removed >= removed_goal ) break;
+		}
+		if( 0 == collapses ) break;
+
+		// apply the pass, triangles that lost their area are gone
+		size_t kept = 0;
+		for( auto & t : result ) {
+			Triangle moved;
+			for( size_t i=0; i < 3; ++i ) moved.indices[ i ] = remap[ t.indices[ i ] ];
+			if( moved.indices[ 0 ] == moved.indices[ 1 ] || moved.indices[ 1 ] == moved.indices[ 2 ] || moved.indices[ 0 ] == moved.indices[ 2 ] ) continue;
+			result[ kept++ ] = moved;
+		}
+		result.resize( kept );
+	}
+
+	if( nullptr != result_error ) *result_error = float( std::sqrt( worst_cost ) );
+	return result;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Vertex;
+struct Triangle;
+
+// A level has to have at most this many triangles compared to the previous one to be worth keeping.
+constexpr float MESH_LOD_MIN_LEVEL_REDUCTION			= 0.85f;
+
+// How Mesh::GenerateLODs builds levels of detail.
+struct MeshLODSettings
+{
+	size_t			max_levels				= 4;		// coarser levels after the full detail mesh
+	float			reduction				= 0.5f;		// triangle count of each level relative to the previous one
+	float			max_error				= 0.05f;	// relative to the mesh bounding box diagonal, no level goes further than this
+	size_t			min_triangles			= 64;		// no level goes below this
+};
+
+// Collapses edges in the order of least quadric error until the mesh has target_triangle_count
+// triangles or the next collapse would be worse than max_error, whichever comes first.
+// ( Garland, Heckbert, Surface Simplification Using Quadric Error Metrics )
+// Vertices are only collapsed onto other existing vertices so the result indexes the same vertex
+// buffer. Vertices on open borders and uv seams never move, this keeps outlines and textures intact.
+// max_error and result_error are distances in mesh units, result_error may be nullptr.
+std::vector<Triangle> MeshSimplifier_Simplify( const std::vector<Vertex> & vertices, const std::vector<Triangle> & triangles, size_t target_triangle_count, float max_error, float * result_error );
@@ -6,12 +6,13 @@
 #include "Renderer.h"
 #include "Window.h"
 #include "Mesh.h"
+#include "SceneObject.h"
 
 #include <assert.h>
 #include <array>
 #include <fstream>
 
-GraphicsPipeline::GraphicsPipeline( Renderer * renderer, Window * window, std::vector<VkDescriptorSetLayout> used_descriptor_set_layouts )
+GraphicsPipeline::GraphicsPipeline( Renderer * renderer, Window * window, std::vector<VkDescriptorSetLayout> used_descriptor_set_layouts, VERTEX_LAYOUT vertex_layout, OBJECT_DATA_SOURCE object_data_source )
 {
 	assert( nullptr != renderer );
 	assert( nullptr != window );
@@ -22,6 +23,8 @@ GraphicsPipeline::GraphicsPipeline( Renderer * renderer, Window * window, std::v
 	_ref_vk_device				= _ref_renderer->GetVulkanDevice();
 
 	_descriptor_set_layouts		= used_descriptor_set_layouts;
+	_vertex_layout				= vertex_layout;
+	_object_data_source			= object_data_source;
 
 	_InitPipelineLayout();
 	_InitPipeline();
@@ -43,10 +46,37 @@ VkPipelineLayout GraphicsPipeline::GetVulkanPipelineLayout()
 	return _pipeline_layout;
 }
 
+VERTEX_LAYOUT GraphicsPipeline::GetVertexLayout()
+{
+	return _vertex_layout;
+}
+
+OBJECT_DATA_SOURCE GraphicsPipeline::GetObjectDataSource()
+{
+	return _object_data_source;
+}
+
 void GraphicsPipeline::_InitPipeline()
 {
 	{
-		std::ifstream file( "shaders/default.vert.spv", std::ifstream::binary | std::ifstream::ate );
+		// compact layouts have no vertex color, they get their own shader variant without that input
+		// and both have variants for the other places the model matrix can come from
+		const char * vertex_shader_path = nullptr;
+		switch( _object_data_source ) {
+		case OBJECT_DATA_SOURCE::UNIFORM_BUFFER:
+			vertex_shader_path = VERTEX_LAYOUT::FLOAT32 == _vertex_layout ? "shaders/default.vert.spv" : "shaders/compact.vert.spv";
+			break;
+		case OBJECT_DATA_SOURCE::PUSH_CONSTANTS:
+			vertex_shader_path = VERTEX_LAYOUT::FLOAT32 == _vertex_layout ? "shaders/default_push.vert.spv" : "shaders/compact_push.vert.spv";
+			break;
+		case OBJECT_DATA_SOURCE::INSTANCE_BUFFER:
+			vertex_shader_path = VERTEX_LAYOUT::FLOAT32 == _vertex_layout ? "shaders/default_instanced.vert.spv" : "shaders/compact_instanced.vert.spv";
+			break;
+		default:
+			assert( 0 && "Unknown object data source." );
+			break;
+		}
+		std::ifstream file( vertex_shader_path, std::ifstream::binary | std::ifstream::ate );
 		assert( file.is_open() );
 
 		size_t file_size = file.tellg();
@@ -91,24 +121,78 @@ void GraphicsPipeline::_InitPipeline()
 
 	std::vector<VkVertexInputBindingDescription> vertex_input_binding_descriptions( 1 );
 	vertex_input_binding_descriptions[ 0 ].binding		= 0;
-	vertex_input_binding_descriptions[ 0 ].stride		= sizeof( Vertex );
+	vertex_input_binding_descriptions[ 0 ].stride		= uint32_t( VertexLayout_GetStride( _vertex_layout ) );
 	vertex_input_binding_descriptions[ 0 ].inputRate	= VK_VERTEX_INPUT_RATE_VERTEX;
 
-	std::vector<VkVertexInputAttributeDescription> vertex_input_attribute_descriptions( 3 );
-	vertex_input_attribute_descriptions[ 0 ].location		= 0;
-	vertex_input_attribute_descriptions[ 0 ].binding		= 0;
-	vertex_input_attribute_descriptions[ 0 ].format			= VK_FORMAT_R32G32B32_SFLOAT;
-	vertex_input_attribute_descriptions[ 0 ].offset			= offsetof( Vertex, position );
-
-	vertex_input_attribute_descriptions[ 1 ].location		= 1;
-	vertex_input_attribute_descriptions[ 1 ].binding		= 0;
-	vertex_input_attribute_descriptions[ 1 ].format			= VK_FORMAT_R32G32B32_SFLOAT;
-	vertex_input_attribute_descriptions[ 1 ].offset			= offsetof( Vertex, color );
+	// locations match the shaders, 0 position, 1 color, 2 uv, 3 to 6 instance model matrix
+	std::vector<VkVertexInputAttributeDescription> vertex_input_attribute_descriptions;
+	switch( _vertex_layout ) {
+	case VERTEX_LAYOUT::FLOAT32:
+		vertex_input_attribute_descriptions.resize( 3 );
+		vertex_input_attribute_descriptions[ 0 ].location		= 0;
+		vertex_input_attribute_descriptions[ 0 ].binding		= 0;
+		vertex_input_attribute_descriptions[ 0 ].format			= VK_FORMAT_R32G32B32_SFLOAT;
+		vertex_input_attribute_descriptions[ 0 ].offset			= offsetof( Vertex, position );
+
+		vertex_input_attribute_descriptions[ 1 ].location		= 1;
+		vertex_input_attribute_descriptions[ 1 ].binding		= 0;
+		vertex_input_attribute_descriptions[ 1 ].format			= VK_FORMAT_R32G32B32_SFLOAT;
+		vertex_input_attribute_descriptions[ 1 ].offset			= offsetof( Vertex, color );
+
+		vertex_input_attribute_descriptions[ 2 ].location		= 2;
+		vertex_input_attribute_descriptions[ 2 ].binding		= 0;
+		vertex_input_attribute_descriptions[ 2 ].format			= VK_FORMAT_R32G32_SFLOAT;
+		vertex_input_attribute_descriptions[ 2 ].offset			= offsetof( Vertex, uv );
+		break;
+
+	case VERTEX_LAYOUT::COMPACT_HALF:
+		vertex_input_attribute_descriptions.resize( 2 );
+		vertex_input_attribute_descriptions[ 0 ].location		= 0;
+		vertex_input_attribute_descriptions[ 0 ].binding		= 0;
+		vertex_input_attribute_descriptions[ 0 ].format			= VK_FORMAT_R16G16B16A16_SFLOAT;
+		vertex_input_attribute_descriptions[ 0 ].offset			= offsetof( VertexCompactHalf, position );
+
+		vertex_input_attribute_descriptions[ 1 ].location		= 2;
+		vertex_input_attribute_descriptions[ 1 ].binding		= 0;
+		vertex_input_attribute_descriptions[ 1 ].format			= VK_FORMAT_R16G16_UNORM;
+		vertex_input_attribute_descriptions[ 1 ].offset			= offsetof( VertexCompactHalf, uv );
+		break;
+
+	case VERTEX_LAYOUT::COMPACT_SNORM16:
+		vertex_input_attribute_descriptions.resize( 2 );
+		vertex_input_attribute_descriptions[ 0 ].location		= 0;
+		vertex_input_attribute_descriptions[ 0 ].binding		= 0;
+		vertex_input_attribute_descriptions[ 0 ].format			= VK_FORMAT_R16G16B16A16_SNORM;
+		vertex_input_attribute_descriptions[ 0 ].offset			= offsetof( VertexCompactSnorm16, position );
+
+		vertex_input_attribute_descriptions[ 1 ].location		= 2;
+		vertex_input_attribute_descriptions[ 1 ].binding		= 0;
+		vertex_input_attribute_descriptions[ 1 ].format			= VK_FORMAT_R16G16_UNORM;
+		vertex_input_attribute_descriptions[ 1 ].offset			= offsetof( VertexCompactSnorm16, uv );
+		break;
+
+	default:
+		assert( 0 && "Unknown vertex layout." );
+		break;
+	}
 
-	vertex_input_attribute_descriptions[ 2 ].location		= 2;
-	vertex_input_attribute_descriptions[ 2 ].binding		= 0;
-	vertex_input_attribute_descriptions[ 2 ].format			= VK_FORMAT_R32G32_SFLOAT;
-	vertex_input_attribute_descriptions[ 2 ].offset			= offsetof( Vertex, uv );
+	// instanced objects add a model matrix per instance, a matrix takes one location per column
+	if( OBJECT_DATA_SOURCE::INSTANCE_BUFFER == _object_data_source ) {
+		VkVertexInputBindingDescription instance_binding_description {};
+		instance_binding_description.binding		= 1;
+		instance_binding_description.stride			= sizeof( glm::mat4 );
+		instance_binding_description.inputRate		= VK_VERTEX_INPUT_RATE_INSTANCE;
+		vertex_input_binding_descriptions.push_back( instance_binding_description );
+
+		for( uint32_t column=0; column < 4; ++column ) {
+			VkVertexInputAttributeDescription instance_attribute_description {};
+			instance_attribute_description.location		= 3 + column;
+			instance_attribute_description.binding		= 1;
+			instance_attribute_description.format		= VK_FORMAT_R32G32B32A32_SFLOAT;
+			instance_attribute_description.offset		= uint32_t( sizeof( glm::vec4 ) * column );
+			vertex_input_attribute_descriptions.push_back( instance_attribute_description );
+		}
+	}
 
 	VkPipelineVertexInputStateCreateInfo vertex_input_state_create_info {};
 	vertex_input_state_create_info.sType		= VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -257,14 +341,15 @@ void GraphicsPipeline::_DeInitPipeline()
 
 void GraphicsPipeline::_InitPipelineLayout()
 {
-	std::array<VkPushConstantRange, 0> push_constant_ranges {};
+	// same range as the camera pipeline layout even when nothing is pushed, otherwise the camera set bound with that layout is disturbed
+	auto & push_constant_range							= _ref_renderer->GetVulkanObjectPushConstantRange();
 
 	VkPipelineLayoutCreateInfo pipeline_layout_create_info {};
 	pipeline_layout_create_info.sType					= VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	pipeline_layout_create_info.setLayoutCount			= uint32_t( _descriptor_set_layouts.size() );
 	pipeline_layout_create_info.pSetLayouts				= _descriptor_set_layouts.data();
-	pipeline_layout_create_info.pushConstantRangeCount	= uint32_t( push_constant_ranges.size() );
-	pipeline_layout_create_info.pPushConstantRanges		= push_constant_ranges.data();
+	pipeline_layout_create_info.pushConstantRangeCount	= 1;
+	pipeline_layout_create_info.pPushConstantRanges		= &push_constant_range;
 
 	ErrorCheck( vkCreatePipelineLayout( _ref_renderer->GetVulkanDevice(), &pipeline_layout_create_info, nullptr, &_pipeline_layout ) );
 }
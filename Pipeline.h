@@ -1,18 +1,31 @@
 #pragma once
 
 #include "Platform.h"
+#include "VertexLayout.h"
 
 class Renderer;
 class Window;
 
+// Where shaders read the per object data from. Push constants skip the descriptor set bind and
+// the uniform buffer write for every draw, objects keep descriptor set 1 in the pipeline layout
+// either way so the sets after it don't move.
+enum class OBJECT_DATA_SOURCE
+{
+	UNIFORM_BUFFER,				// descriptor set 1, see UniformRing
+	PUSH_CONSTANTS,				// PushConstants_Object, vertex stage
+	INSTANCE_BUFFER,			// a model matrix per instance in vertex buffer binding 1, see SceneObject_InstancedObject and SCENE_SUBMISSION_MODE::INDIRECT
+};
+
 class GraphicsPipeline
 {
 public:
-	GraphicsPipeline( Renderer * renderer, Window * window, std::vector<VkDescriptorSetLayout> used_descriptor_set_layouts );
+	GraphicsPipeline( Renderer * renderer, Window * window, std::vector<VkDescriptorSetLayout> used_descriptor_set_layouts, VERTEX_LAYOUT vertex_layout = VERTEX_LAYOUT::FLOAT32, OBJECT_DATA_SOURCE object_data_source = OBJECT_DATA_SOURCE::UNIFORM_BUFFER );
 	~GraphicsPipeline();
 
 	VkPipeline				GetVulkanPipeline();
 	VkPipelineLayout		GetVulkanPipelineLayout();
+	VERTEX_LAYOUT			GetVertexLayout();
+	OBJECT_DATA_SOURCE		GetObjectDataSource();
 
 private:
 	void					_InitPipeline();
@@ -28,6 +41,8 @@ private:
 	VkPipeline				_pipeline					= VK_NULL_HANDLE;
 	VkPipelineLayout		_pipeline_layout			= VK_NULL_HANDLE;
 	std::vector<VkDescriptorSetLayout>					_descriptor_set_layouts;
+	VERTEX_LAYOUT			_vertex_layout				= VERTEX_LAYOUT::FLOAT32;
+	OBJECT_DATA_SOURCE		_object_data_source			= OBJECT_DATA_SOURCE::UNIFORM_BUFFER;
 
 	VkShaderModule			_vertex_shader_module		= VK_NULL_HANDLE;
 	VkShaderModule			_fragment_shader_module		= VK_NULL_HANDLE;
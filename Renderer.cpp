@@ -16,8 +16,13 @@ Contributors:
 #include "Shared.h"
 #include "Window.h"
 #include "Pipeline.h"
+#include "MeshRegistry.h"
+#include "GeometryHeap.h"
+#include "UniformRing.h"
+#include "SceneObject.h"
 
 #include <cstdlib>
+#include <cstring>
 #include <assert.h>
 #include <vector>
 #include <iostream>
@@ -35,12 +40,21 @@ Renderer::Renderer()
 	_InitDevice();
 	_InitDescriptorSetLayouts();
 	_InitCameraPipelineLayout();
+
+	_geometry_heap			= std::unique_ptr<GeometryHeap>( new GeometryHeap( this ) );
+	_object_uniform_ring	= std::unique_ptr<UniformRing>( new UniformRing( this, DESCRIPTOR_SET_TYPE::SCENE_OBJECT, sizeof( UBOData_Object ) ) );
+	_mesh_registry			= std::unique_ptr<MeshRegistry>( new MeshRegistry( this ) );
 }
 
 Renderer::~Renderer()
 {
 	delete _window;
 
+	// every mesh should be gone by now, the registry only keeps weak references
+	_mesh_registry.reset();
+	_geometry_heap.reset();
+	_object_uniform_ring.reset();
+
 	_DeInitDescriptorPools();
 	_DeInitCameraPipelineLayout();
 	_DeInitDescriptorSetLayouts();
@@ -109,6 +123,11 @@ const VkPipelineLayout Renderer::GetVulkanCameraPipelineLayout() const
 	return _camera_pipeline_layout;
 }
 
+const VkPushConstantRange & Renderer::GetVulkanObjectPushConstantRange() const
+{
+	return _object_push_constant_range;
+}
+
 const VkDescriptorSetLayout Renderer::GetVulkanCameraDescriptorSetLayout() const
 {
 	return _camera_descriptor_set_layout;
@@ -124,6 +143,19 @@ const VkDescriptorSetLayout Renderer::GetVulkanSurfacePlainDescriptorSetLayout()
 	return _material_plain_descriptor_set;
 }
 
+const VkDescriptorSetLayout Renderer::GetVulkanCullingDescriptorSetLayout() const
+{
+	return _culling_descriptor_set_layout;
+}
+
+bool Renderer::IsDeviceExtensionEnabled( const char * extension_name ) const
+{
+	for( auto e : _device_extensions ) {
+		if( 0 == std::strcmp( e, extension_name ) ) return true;
+	}
+	return false;
+}
+
 VkDescriptorSet Renderer::AllocateDescriptorSet( DESCRIPTOR_SET_TYPE descriptor_set_type )
 {
 	switch( descriptor_set_type ) {
@@ -135,6 +167,9 @@ VkDescriptorSet Renderer::AllocateDescriptorSet( DESCRIPTOR_SET_TYPE descriptor_
 		break;
 	case DESCRIPTOR_SET_TYPE::MATERIAL_PLAIN:
 		return _AllocateDescriptorSet( _material_plain_descriptor_set );
+
+	case DESCRIPTOR_SET_TYPE::CULLING:
+		return _AllocateDescriptorSet( _culling_descriptor_set_layout );
 		break;
 	default:
 		assert( 0 && "Undefined descriptor set type." );
@@ -148,6 +183,21 @@ void Renderer::FreeDescriptorSet( VkDescriptorSet set )
 	_FreeDescriptorSet( set );
 }
 
+MeshRegistry * Renderer::GetMeshRegistry()
+{
+	return _mesh_registry.get();
+}
+
+GeometryHeap * Renderer::GetGeometryHeap()
+{
+	return _geometry_heap.get();
+}
+
+UniformRing * Renderer::GetObjectUniformRing()
+{
+	return _object_uniform_ring.get();
+}
+
 void Renderer::_SetupLayersAndExtensions()
 {
 	_instance_extensions.push_back( VK_KHR_SURFACE_EXTENSION_NAME );
@@ -214,6 +264,22 @@ void Renderer::_InitDevice()
 		}
 	}
 
+#if defined( VK_KHR_draw_indirect_count )
+	{
+		// optional, lets GPU culled indirect draws read their draw count from a buffer
+		uint32_t extension_count = 0;
+		vkEnumerateDeviceExtensionProperties( _gpu, nullptr, &extension_count, nullptr );
+		std::vector<VkExtensionProperties> extension_list( extension_count );
+		vkEnumerateDeviceExtensionProperties( _gpu, nullptr, &extension_count, extension_list.data() );
+		for( auto & e : extension_list ) {
+			if( 0 == std::strcmp( e.extensionName, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME ) ) {
+				_device_extensions.push_back( VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME );
+				break;
+			}
+		}
+	}
+#endif
+
 	float queue_priorities[] { 1.0f };
 	VkDeviceQueueCreateInfo device_queue_create_info {};
 	device_queue_create_info.sType				= VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
@@ -224,6 +290,9 @@ void Renderer::_InitDevice()
 	VkPhysicalDeviceFeatures enabled_features {};
 	enabled_features.fillModeNonSolid			= VK_TRUE;
 	enabled_features.samplerAnisotropy			= VK_TRUE;
+	// used by scenes drawing indirectly when available, they check GetVulkanPhysicalDeviceFeatures()
+	enabled_features.multiDrawIndirect			= _gpu_features.multiDrawIndirect;
+	enabled_features.drawIndirectFirstInstance	= _gpu_features.drawIndirectFirstInstance;
 
 	VkDeviceCreateInfo device_create_info {};
 	device_create_info.sType					= VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -248,14 +317,20 @@ void Renderer::_DeInitDevice()
 
 void Renderer::_InitCameraPipelineLayout()
 {
+	// layouts are only compatible for set 0 when their push constant ranges are identical too
+	_object_push_constant_range.stageFlags	= VK_SHADER_STAGE_VERTEX_BIT;
+	_object_push_constant_range.offset		= 0;
+	_object_push_constant_range.size		= sizeof( PushConstants_Object );
+	assert( _object_push_constant_range.size <= _gpu_properties.limits.maxPushConstantsSize );
+
 	VkPipelineLayoutCreateInfo create_info {};
 	create_info.sType			= VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	create_info.pNext			= nullptr;
 	create_info.flags			= 0;
 	create_info.setLayoutCount	= 1;
 	create_info.pSetLayouts		= &_camera_descriptor_set_layout;
-	create_info.pushConstantRangeCount	= 0;
-	create_info.pPushConstantRanges		= nullptr;
+	create_info.pushConstantRangeCount	= 1;
+	create_info.pPushConstantRanges		= &_object_push_constant_range;
 	ErrorCheck( vkCreatePipelineLayout( _device, &create_info, nullptr, &_camera_pipeline_layout ) );
 }
 
@@ -285,7 +360,7 @@ void Renderer::_InitDescriptorSetLayouts()
 	{
 		std::vector<VkDescriptorSetLayoutBinding> bindings( 1 );
 		bindings[ 0 ].binding				= 0;
-		bindings[ 0 ].descriptorType		= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		bindings[ 0 ].descriptorType		= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		bindings[ 0 ].descriptorCount		= 1;
 		bindings[ 0 ].stageFlags			= VK_SHADER_STAGE_VERTEX_BIT;
 
@@ -312,6 +387,23 @@ void Renderer::_InitDescriptorSetLayouts()
 		descriptor_set_layout_create_info.pBindings			= bindings.data();
 		vkCreateDescriptorSetLayout( _device, &descriptor_set_layout_create_info, nullptr, &_material_plain_descriptor_set );
 	}
+	// Culling Descriptor Set: objects, instance matrices, draw commands, culled draw commands, draw counts
+	{
+		std::vector<VkDescriptorSetLayoutBinding> bindings( 5 );
+		for( uint32_t i=0; i < bindings.size(); ++i ) {
+			bindings[ i ].binding			= i;
+			bindings[ i ].descriptorType	= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[ i ].descriptorCount	= 1;
+			bindings[ i ].stageFlags		= VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+
+		VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info {};
+		descriptor_set_layout_create_info.sType				= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		descriptor_set_layout_create_info.flags				= 0;
+		descriptor_set_layout_create_info.bindingCount		= uint32_t( bindings.size() );
+		descriptor_set_layout_create_info.pBindings			= bindings.data();
+		vkCreateDescriptorSetLayout( _device, &descriptor_set_layout_create_info, nullptr, &_culling_descriptor_set_layout );
+	}
 }
 
 void Renderer::_DeInitDescriptorSetLayouts()
@@ -319,6 +411,7 @@ void Renderer::_DeInitDescriptorSetLayouts()
 	vkDestroyDescriptorSetLayout( _device, _camera_descriptor_set_layout, nullptr );
 	vkDestroyDescriptorSetLayout( _device, _object_descriptor_set_layout, nullptr );
 	vkDestroyDescriptorSetLayout( _device, _material_plain_descriptor_set, nullptr );
+	vkDestroyDescriptorSetLayout( _device, _culling_descriptor_set_layout, nullptr );
 }
 
 void Renderer::_DeInitDescriptorPools()
@@ -356,8 +449,9 @@ VkDescriptorSet Renderer::_AllocateDescriptorSet( VkDescriptorSetLayout descript
 	{
 		std::vector<VkDescriptorPoolSize> pool_sizes;
 		pool_sizes.push_back( { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3 } );
-		pool_sizes.push_back( { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3 } );
+		pool_sizes.push_back( { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 3 } );
 		pool_sizes.push_back( { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3 } );
+		pool_sizes.push_back( { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5 } );
 
 		VkDescriptorPool pool = VK_NULL_HANDLE;
 		VkDescriptorPoolCreateInfo descriptor_pool_create_info {};
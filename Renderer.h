@@ -20,6 +20,9 @@ Contributors:
 
 class Window;
 class GraphicsPipeline;
+class MeshRegistry;
+class GeometryHeap;
+class UniformRing;
 
 struct MemoryInfo
 {
@@ -31,9 +34,11 @@ enum class DESCRIPTOR_SET_TYPE : uint32_t
 {
 	CAMERA,						// Descriptor Set for Camera UBO
 
-	SCENE_OBJECT,				// Descriptor Set for Object UBO
+	SCENE_OBJECT,				// Descriptor Set for Object UBO, dynamic offsets into a UniformRing chunk
 
 	MATERIAL_PLAIN,				// Descriptor Set for Plain Material and Shaders UBOs
+
+	CULLING,					// Descriptor Set for the storage buffers of GPUCulling
 };
 
 class Renderer
@@ -55,16 +60,26 @@ public:
 	const VkPhysicalDeviceProperties		&	GetVulkanPhysicalDeviceProperties() const;
 	const VkPhysicalDeviceMemoryProperties	&	GetVulkanPhysicalDeviceMemoryProperties() const;
 
+	// set 0 bound with the camera layout stays valid for pipelines whose layouts have this push constant range,
+	// so every graphics pipeline layout gets it whether it pushes object data or not
 	const VkPipelineLayout						GetVulkanCameraPipelineLayout() const;
+	const VkPushConstantRange				&	GetVulkanObjectPushConstantRange() const;
 	const VkDescriptorSetLayout					GetVulkanCameraDescriptorSetLayout() const;
 	const VkDescriptorSetLayout					GetVulkanObjectDescriptorSetLayout() const;
 	const VkDescriptorSetLayout					GetVulkanSurfacePlainDescriptorSetLayout() const;
+	const VkDescriptorSetLayout					GetVulkanCullingDescriptorSetLayout() const;
+
+	bool										IsDeviceExtensionEnabled( const char * extension_name ) const;
 
 	MemoryInfo									AllocateBufferMemory( VkBufferUsageFlags usage, VkDeviceSize byte_size );
 
 	VkDescriptorSet								AllocateDescriptorSet( DESCRIPTOR_SET_TYPE descriptor_set_type );
 	void										FreeDescriptorSet( VkDescriptorSet set );
 
+	MeshRegistry							*	GetMeshRegistry();
+	GeometryHeap							*	GetGeometryHeap();
+	UniformRing								*	GetObjectUniformRing();		// object transformations, one allocation per draw
+
 private:
 	void										_SetupLayersAndExtensions();
 
@@ -107,13 +122,19 @@ private:
 	std::vector<const char*>					_device_extensions;
 
 	VkPipelineLayout							_camera_pipeline_layout			= VK_NULL_HANDLE;
+	VkPushConstantRange							_object_push_constant_range		= {};
 
 	VkDescriptorSetLayout						_camera_descriptor_set_layout	= VK_NULL_HANDLE;
 	VkDescriptorSetLayout						_object_descriptor_set_layout	= VK_NULL_HANDLE;
 	VkDescriptorSetLayout						_material_plain_descriptor_set	= VK_NULL_HANDLE;
+	VkDescriptorSetLayout						_culling_descriptor_set_layout	= VK_NULL_HANDLE;
 
 	std::list<VkDescriptorPool>					_descriptor_pools;
 
+	std::unique_ptr<GeometryHeap>				_geometry_heap;
+	std::unique_ptr<UniformRing>				_object_uniform_ring;
+	std::unique_ptr<MeshRegistry>				_mesh_registry;
+
 	VkDebugReportCallbackEXT					_debug_report					= VK_NULL_HANDLE;
 	VkDebugReportCallbackCreateInfoEXT			_debug_callback_create_info		= {};
 };
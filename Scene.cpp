@@ -2,38 +2,612 @@
 
 #include "Platform.h"
 #include "SceneObject.h"
+#include "Renderer.h"
+#include "Shared.h"
+#include "Pipeline.h"
+#include "Surface.h"
+#include "GPUMesh.h"
+#include "GPUCulling.h"
 
-Scene::Scene()
+#include <algorithm>
+#include <utility>
+
+Scene::Scene( Renderer * renderer, SCENE_SUBMISSION_MODE submission_mode )
 {
+	assert( nullptr != renderer );
+	_ref_renderer		= renderer;
+	_submission_mode	= submission_mode;
 }
 
 
 Scene::~Scene()
 {
+	_DeInitIndirectBuffers();
 }
 
 void Scene::UpdateLogic()
 {
-	for( auto & o : objects ) {
+	for( auto o : _objects ) {
 		o->UpdateLogic();
 	}
+	_UpdateWorldMatrices();
 }
 
 void Scene::CmdRender( VkCommandBuffer command_buffer )
 {
-	for( auto & o : objects ) {
-		o->CmdRender( command_buffer );
+	switch( _submission_mode ) {
+	case SCENE_SUBMISSION_MODE::DIRECT:
+		_CullObjects();
+		for( size_t i=0; i < _objects.size(); ++i ) {
+			if( _object_visible[ i ] ) _objects[ i ]->CmdRender( command_buffer );
+		}
+		break;
+	case SCENE_SUBMISSION_MODE::INDIRECT:
+		_PrepareIndirectDraws();
+		_CmdRenderIndirect( command_buffer, _command_buffer );
+		break;
+	case SCENE_SUBMISSION_MODE::INDIRECT_CULLED:
+		assert( _indirect_prepared && "Indirect culled scenes need CmdCull before CmdRender." );
+		_CmdRenderIndirect( command_buffer, _culled_command_buffer );
+		break;
+	default:
+		assert( 0 && "Unknown scene submission mode." );
+		break;
 	}
+	_indirect_prepared			= false;
 }
 
-void Scene::AddObject( SceneObject * object )
+void Scene::CmdCull( VkCommandBuffer command_buffer, const glm::mat4 & view_projection )
 {
-	assert( nullptr != object );
-	objects.push_back( object );
+	assert( SCENE_SUBMISSION_MODE::INDIRECT_CULLED == _submission_mode );
+	if( !_gpu_culling ) {
+		_gpu_culling			= std::unique_ptr<GPUCulling>( new GPUCulling( _ref_renderer ) );
+	}
+
+	_PrepareIndirectDraws();
+	if( 0 == _indirect_instance_count ) return;
+
+	GPUCullingBuffers buffers;
+	buffers.objects				= _cull_object_buffer;
+	buffers.instance_matrices	= _instance_buffer;
+	buffers.commands			= _command_buffer;
+	buffers.culled_commands		= _culled_command_buffer;
+	buffers.draw_counts			= _draw_count_buffer;
+	_gpu_culling->CmdCull( command_buffer, buffers, _indirect_instance_count, uint32_t( _indirect_groups.size() ), view_projection, _IsCompactingCulledDraws() );
 }
 
-void Scene::RemoveObject( SceneObject * object )
+SlotHandle Scene::AddObject( SceneObject * object )
 {
 	assert( nullptr != object );
-	objects.remove( object );
+	auto handle					= _object_slots.Insert( uint32_t( _objects.size() ) );
+	_objects.push_back( object );
+	_object_handles.push_back( handle );
+	_world_matrix_order_dirty	= true;
+	return handle;
+}
+
+void Scene::RemoveObject( SlotHandle handle )
+{
+	assert( _object_slots.IsValid( handle ) );
+	uint32_t index				= _object_slots.Get( handle );
+	_objects[ index ]			= _objects.back();
+	_object_handles[ index ]	= _object_handles.back();
+	_object_slots.Set( _object_handles[ index ], index );
+	_objects.pop_back();
+	_object_handles.pop_back();
+	_object_slots.Erase( handle );
+	_world_matrix_order_dirty	= true;
+}
+
+size_t Scene::GetObjectCount() const
+{
+	return _objects.size();
+}
+
+SlotHandle Scene::AddMeshInstance( Surface * surface, std::shared_ptr<GPUMesh> mesh,
+	const glm::vec3 & position, const glm::quat & rotation, const glm::vec3 & size )
+{
+	assert( nullptr != surface );
+	assert( nullptr != mesh );
+	assert( OBJECT_DATA_SOURCE::INSTANCE_BUFFER == surface->GetPipeline()->GetObjectDataSource() );
+	assert( surface->GetPipeline()->GetVertexLayout() == mesh->GetVertexLayout() );
+
+	auto key					= std::make_pair( surface, mesh.get() );
+	auto found					= _mesh_instance_batch_lookup.find( key );
+	uint32_t batch_index		= 0;
+	if( _mesh_instance_batch_lookup.end() != found ) {
+		batch_index				= found->second;
+	} else {
+		batch_index				= uint32_t( _mesh_instance_batches.size() );
+		MeshInstanceBatch batch;
+		batch.surface			= surface;
+		batch.mesh				= mesh;
+		_mesh_instance_batches.push_back( std::move( batch ) );
+		_mesh_instance_batch_lookup[ key ]	= batch_index;
+
+		// same order scene object draws are grouped in, so pipelines and surfaces are bound as few times as possible
+		_mesh_instance_batch_order.push_back( batch_index );
+		std::sort( _mesh_instance_batch_order.begin(), _mesh_instance_batch_order.end(), [ this ]( uint32_t a, uint32_t b ) {
+			auto & batch_a		= _mesh_instance_batches[ a ];
+			auto & batch_b		= _mesh_instance_batches[ b ];
+			if( batch_a.surface->GetPipeline() != batch_b.surface->GetPipeline() ) return batch_a.surface->GetPipeline() < batch_b.surface->GetPipeline();
+			if( batch_a.surface != batch_b.surface ) return batch_a.surface < batch_b.surface;
+			return batch_a.mesh.get() < batch_b.mesh.get();
+		} );
+	}
+
+	auto & batch				= _mesh_instance_batches[ batch_index ];
+	MeshInstanceLocation location;
+	location.batch				= batch_index;
+	location.index				= uint32_t( batch.handles.size() );
+	auto handle					= _mesh_instance_slots.Insert( location );
+	batch.transforms.Resize( location.index + 1 );
+	batch.handles.push_back( handle );
+	_SetMeshInstanceTransform( batch, location.index, position, rotation, size );
+	++_mesh_instance_count;
+	_mesh_instance_layout_changed	= true;
+	return handle;
+}
+
+void Scene::SetMeshInstanceTransform( SlotHandle handle, const glm::vec3 & position, const glm::quat & rotation, const glm::vec3 & size )
+{
+	auto & location				= _mesh_instance_slots.Get( handle );
+	_SetMeshInstanceTransform( _mesh_instance_batches[ location.batch ], location.index, position, rotation, size );
+}
+
+void Scene::RemoveMeshInstance( SlotHandle handle )
+{
+	auto location				= _mesh_instance_slots.Get( handle );
+	auto & batch				= _mesh_instance_batches[ location.batch ];
+	batch.transforms.Remove( location.index );
+	batch.handles[ location.index ]	= batch.handles.back();
+	batch.handles.pop_back();
+	if( location.index < batch.handles.size() ) {
+		_mesh_instance_slots.Set( batch.handles[ location.index ], location );
+	}
+	_mesh_instance_slots.Erase( handle );
+	batch.changed				= true;
+	--_mesh_instance_count;
+	_mesh_instance_layout_changed	= true;
+}
+
+size_t Scene::GetMeshInstanceCount() const
+{
+	return _mesh_instance_count;
+}
+
+void Scene::SetSubmissionMode( SCENE_SUBMISSION_MODE submission_mode )
+{
+	// mesh instances are laid out differently with culling
+	if( submission_mode != _submission_mode ) {
+		_mesh_instance_layout_changed	= true;
+	}
+	_submission_mode	= submission_mode;
+}
+
+SCENE_SUBMISSION_MODE Scene::GetSubmissionMode() const
+{
+	return _submission_mode;
+}
+
+void Scene::SetCullingView( const glm::mat4 & view_projection, const glm::vec3 & camera_position, float pixel_scale )
+{
+	_culling_frustum						= Frustum_FromMatrix( view_projection );
+	_culling_size_cutoff.camera_position	= camera_position;
+	_culling_size_cutoff.pixel_scale		= pixel_scale;
+	_culling_view_set						= true;
+}
+
+void Scene::SetMinProjectedSize( float min_projected_size )
+{
+	assert( min_projected_size >= 0.0f );
+	_culling_size_cutoff.min_projected_size	= min_projected_size;
+}
+
+const SceneCullingStatistics & Scene::GetCullingStatistics() const
+{
+	return _culling_statistics;
+}
+
+void Scene::_SetMeshInstanceTransform( MeshInstanceBatch & batch, size_t index,
+	const glm::vec3 & position, const glm::quat & rotation, const glm::vec3 & size )
+{
+	// translation * rotation * scale * dequantization, the dequantization offset is scaled and rotated
+	// into the translation and its scale multiplies the size, so the batch kernel needs no extra matrix
+	auto & dequantization		= batch.mesh->GetVertexDequantization();
+	glm::vec3 offset			= glm::vec3( dequantization.offset[ 0 ], dequantization.offset[ 1 ], dequantization.offset[ 2 ] );
+	glm::vec3 scale				= glm::vec3( dequantization.scale[ 0 ], dequantization.scale[ 1 ], dequantization.scale[ 2 ] );
+	glm::vec3 encoded_position	= position + glm::vec3( glm::mat4_cast( rotation ) * glm::vec4( size * offset, 0.0f ) );
+	batch.transforms.Set( index, encoded_position, rotation, size * scale );
+	batch.changed				= true;
+}
+
+void Scene::_UpdateWorldMatrices()
+{
+	if( _world_matrix_order_dirty || _world_matrix_order_revision != SceneObject::GetHierarchyRevision() ) {
+		std::vector<std::pair<uint32_t, SceneObject*>> depths;
+		depths.reserve( _objects.size() );
+		for( auto o : _objects ) {
+			depths.push_back( { o->GetHierarchyDepth(), o } );
+		}
+		std::stable_sort( depths.begin(), depths.end(), []( const std::pair<uint32_t, SceneObject*> & a, const std::pair<uint32_t, SceneObject*> & b ) {
+			return a.first < b.first;
+		} );
+		_world_matrix_order.clear();
+		for( auto & d : depths ) {
+			_world_matrix_order.push_back( d.second );
+		}
+		_world_matrix_order_revision	= SceneObject::GetHierarchyRevision();
+		_world_matrix_order_dirty		= false;
+	}
+
+	// a parent is always done before its children, so dirty matrices never walk up the hierarchy here,
+	// parents outside of the scene are brought up to date by the first child that needs them
+	for( auto o : _world_matrix_order ) {
+		o->GetWorldMatrix();
+	}
+}
+
+void Scene::_CullObjects()
+{
+	_object_visible.assign( _objects.size(), 1 );
+	_culling_statistics					= SceneCullingStatistics();
+	_culling_statistics.visible			= uint32_t( _objects.size() );
+	if( !_culling_view_set ) return;
+	_culling_view_set					= false;
+
+	// spheres are gathered into one packed batch so the test itself runs several objects at a time
+	_culling_spheres.Clear();
+	_culling_sphere_objects.clear();
+	for( uint32_t i=0; i < _objects.size(); ++i ) {
+		glm::vec4 sphere;
+		if( _objects[ i ]->GetWorldBoundingSphere( &sphere ) ) {
+			_culling_spheres.Add( glm::vec3( sphere ), sphere.w );
+			_culling_sphere_objects.push_back( i );
+		}
+	}
+	_culling_results.resize( _culling_spheres.GetCount() );
+	Frustum_CullSpheres( _culling_frustum, _culling_spheres, _culling_size_cutoff, _culling_results.data() );
+
+	for( size_t s=0; s < _culling_results.size(); ++s ) {
+		if( FRUSTUM_CULL_RESULT::VISIBLE == _culling_results[ s ] ) continue;
+		if( FRUSTUM_CULL_RESULT::OUTSIDE == _culling_results[ s ] ) {
+			++_culling_statistics.outside;
+		} else {
+			++_culling_statistics.too_small;
+		}
+		_object_visible[ _culling_sphere_objects[ s ] ]	= 0;
+		--_culling_statistics.visible;
+	}
+}
+
+void Scene::_PrepareIndirectDraws()
+{
+	_indirect_draws.clear();
+	_indirect_groups.clear();
+	_direct_objects.clear();
+	_indirect_instance_count	= 0;
+	_indirect_prepared			= true;
+
+	// without drawIndirectFirstInstance every command starts at instance 0, then
+	// the instance buffer is bound again at every group's or object's matrix instead
+	bool first_instance			= VK_TRUE == _ref_renderer->GetVulkanPhysicalDeviceFeatures().drawIndirectFirstInstance;
+	bool culled					= SCENE_SUBMISSION_MODE::INDIRECT_CULLED == _submission_mode;
+
+	// mesh instances first, one group per batch. Culling needs commands of their own for every
+	// instance, otherwise the commands of a batch draw all of its instances
+	uint32_t instance			= 0;
+	uint32_t command			= 0;
+	for( auto b : _mesh_instance_batch_order ) {
+		auto & batch			= _mesh_instance_batches[ b ];
+		if( batch.handles.empty() ) continue;
+		// a dynamic mesh may build its draw ranges again, the commands have to follow
+		batch.mesh->UploadVertices();
+		if( batch.mesh->GetIndexRevision() != batch.index_revision ) {
+			batch.index_revision			= batch.mesh->GetIndexRevision();
+			_mesh_instance_layout_changed	= true;
+		}
+		uint32_t range_count	= uint32_t( batch.mesh->GetLODs()[ 0 ].draw_ranges.size() );
+		IndirectGroup group;
+		group.surface			= batch.surface;
+		group.mesh				= batch.mesh.get();
+		group.mesh_instance_batch	= b;
+		group.first_instance	= instance;
+		group.instance_count	= uint32_t( batch.handles.size() );
+		group.first_command		= command;
+		group.command_count		= culled ? group.instance_count * range_count : range_count;
+		group.instanced			= !culled;
+		_indirect_groups.push_back( group );
+		instance				+= group.instance_count;
+		command					+= group.command_count;
+	}
+	uint32_t mesh_instance_group_count	= uint32_t( _indirect_groups.size() );
+
+	_CullObjects();
+	for( size_t i=0; i < _objects.size(); ++i ) {
+		if( !_object_visible[ i ] ) continue;
+		auto o					= _objects[ i ];
+		SceneIndirectDraw draw;
+		if( !o->PrepareIndirectDraw( &draw ) ) {
+			_direct_objects.push_back( o );
+		} else if( !draw.ranges->empty() ) {
+			_indirect_draws.push_back( draw );
+		}
+	}
+
+	// draws sharing pipeline, surface and buffers end up next to each other, static meshes all share the geometry heap
+	auto BufferKey = []( const SceneIndirectDraw & draw ) {
+		return GPU_MESH_STORAGE::STATIC == draw.mesh->GetStorage() ? nullptr : draw.mesh;
+	};
+	std::stable_sort( _indirect_draws.begin(), _indirect_draws.end(), [ & ]( const SceneIndirectDraw & a, const SceneIndirectDraw & b ) {
+		if( a.surface->GetPipeline() != b.surface->GetPipeline() ) return a.surface->GetPipeline() < b.surface->GetPipeline();
+		if( a.surface != b.surface ) return a.surface < b.surface;
+		if( BufferKey( a ) != BufferKey( b ) ) return BufferKey( a ) < BufferKey( b );
+		return a.mesh->GetIndexType() < b.mesh->GetIndexType();
+	} );
+
+	for( uint32_t i=0; i < _indirect_draws.size(); ++i ) {
+		auto & draw				= _indirect_draws[ i ];
+		if( 0 == i
+			|| draw.surface != _indirect_draws[ i - 1 ].surface
+			|| BufferKey( draw ) != BufferKey( _indirect_draws[ i - 1 ] )
+			|| draw.mesh->GetIndexType() != _indirect_draws[ i - 1 ].mesh->GetIndexType() ) {
+			IndirectGroup group;
+			group.surface		= draw.surface;
+			group.mesh			= draw.mesh;
+			group.first_draw	= i;
+			group.first_instance	= instance;
+			group.first_command	= command;
+			_indirect_groups.push_back( group );
+		}
+		_indirect_groups.back().instance_count	+= 1;
+		_indirect_groups.back().command_count	+= uint32_t( draw.ranges->size() );
+		instance				+= 1;
+		command					+= uint32_t( draw.ranges->size() );
+	}
+	_indirect_instance_count	= instance;
+	if( 0 == _indirect_instance_count ) return;
+
+	_ReserveIndirectBuffers( instance, command );
+	if( culled ) {
+		_ReserveCullingBuffers( instance, command );
+	}
+
+	for( uint32_t g=0; g < mesh_instance_group_count; ++g ) {
+		auto & group			= _indirect_groups[ g ];
+		auto & batch			= _mesh_instance_batches[ group.mesh_instance_batch ];
+		// frames don't overlap, matrices of unchanged batches are still in the buffer from earlier frames
+		if( batch.changed || _mesh_instance_layout_changed ) {
+			TransformBatch_CalculateMatrices( batch.transforms, 0, group.instance_count, nullptr, _instance_buffer_mapped + group.first_instance, sizeof( glm::mat4 ) );
+			batch.changed		= false;
+		}
+		if( !_mesh_instance_layout_changed ) continue;
+
+		auto & ranges			= batch.mesh->GetLODs()[ 0 ].draw_ranges;
+		if( group.instanced ) {
+			batch.mesh->GetIndirectCommands( ranges, first_instance ? group.first_instance : 0, _command_buffer_mapped + group.first_command );
+			for( uint32_t c=group.first_command; c < group.first_command + group.command_count; ++c ) {
+				_command_buffer_mapped[ c ].instanceCount	= group.instance_count;
+			}
+			continue;
+		}
+		glm::vec4 bounding_sphere	= batch.mesh->GetEncodedBoundingSphere();
+		for( uint32_t i=0; i < group.instance_count; ++i ) {
+			command				= group.first_command + i * uint32_t( ranges.size() );
+			batch.mesh->GetIndirectCommands( ranges, first_instance ? group.first_instance + i : 0, _command_buffer_mapped + command );
+			_WriteCullObject( group.first_instance + i, bounding_sphere, command, uint32_t( ranges.size() ), group.first_command, g );
+		}
+	}
+	_mesh_instance_layout_changed	= false;
+
+	for( uint32_t g=mesh_instance_group_count; g < _indirect_groups.size(); ++g ) {
+		auto & group			= _indirect_groups[ g ];
+		command					= group.first_command;
+		for( uint32_t i=0; i < group.instance_count; ++i ) {
+			auto & draw			= _indirect_draws[ group.first_draw + i ];
+			uint32_t draw_instance	= group.first_instance + i;
+			_instance_buffer_mapped[ draw_instance ]	= draw.model_matrix;
+			draw.mesh->GetIndirectCommands( *draw.ranges, first_instance ? draw_instance : 0, _command_buffer_mapped + command );
+			if( culled ) {
+				_WriteCullObject( draw_instance, draw.bounding_sphere, command, uint32_t( draw.ranges->size() ), group.first_command, g );
+			}
+			command				+= uint32_t( draw.ranges->size() );
+		}
+	}
+}
+
+void Scene::_WriteCullObject( uint32_t instance, const glm::vec4 & bounding_sphere, uint32_t first_command, uint32_t command_count, uint32_t group_first_command, uint32_t group )
+{
+	auto & cull_object				= _cull_object_buffer_mapped[ instance ];
+	cull_object.bounding_sphere[ 0 ]	= bounding_sphere.x;
+	cull_object.bounding_sphere[ 1 ]	= bounding_sphere.y;
+	cull_object.bounding_sphere[ 2 ]	= bounding_sphere.z;
+	cull_object.bounding_sphere[ 3 ]	= bounding_sphere.w;
+	cull_object.first_command		= first_command;
+	cull_object.command_count		= command_count;
+	cull_object.group_first_command	= group_first_command;
+	cull_object.group				= group;
+}
+
+void Scene::_CmdRenderIndirect( VkCommandBuffer command_buffer, VkBuffer draw_command_buffer )
+{
+	for( auto o : _direct_objects ) {
+		o->CmdRender( command_buffer );
+	}
+	if( 0 == _indirect_instance_count ) return;
+
+	auto & features				= _ref_renderer->GetVulkanPhysicalDeviceFeatures();
+	bool first_instance			= VK_TRUE == features.drawIndirectFirstInstance;
+	bool multi_draw				= VK_TRUE == features.multiDrawIndirect;
+	bool compacted				= SCENE_SUBMISSION_MODE::INDIRECT_CULLED == _submission_mode && _IsCompactingCulledDraws();
+
+	auto CmdDrawCommands = [ & ]( uint32_t first_command, uint32_t count ) {
+		if( multi_draw ) {
+			vkCmdDrawIndexedIndirect( command_buffer, draw_command_buffer, first_command * sizeof( VkDrawIndexedIndirectCommand ), count, sizeof( VkDrawIndexedIndirectCommand ) );
+		} else {
+			for( uint32_t c=0; c < count; ++c ) {
+				vkCmdDrawIndexedIndirect( command_buffer, draw_command_buffer, ( first_command + c ) * sizeof( VkDrawIndexedIndirectCommand ), 1, sizeof( VkDrawIndexedIndirectCommand ) );
+			}
+		}
+	};
+	auto CmdBindInstance = [ & ]( uint32_t instance ) {
+		VkDeviceSize offset		= instance * sizeof( glm::mat4 );
+		vkCmdBindVertexBuffers( command_buffer, 1, 1, &_instance_buffer, &offset );
+	};
+
+	if( first_instance ) {
+		CmdBindInstance( 0 );
+	}
+
+	for( uint32_t g=0; g < _indirect_groups.size(); ++g ) {
+		auto & group			= _indirect_groups[ g ];
+		auto previous			= 0 == g ? nullptr : &_indirect_groups[ g - 1 ];
+
+		if( nullptr == previous || group.surface->GetPipeline() != previous->surface->GetPipeline() ) {
+			vkCmdBindPipeline( command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, group.surface->GetPipeline()->GetVulkanPipeline() );
+		}
+		if( nullptr == previous || group.surface != previous->surface ) {
+			group.surface->UpdateDescriptorSets();
+			group.surface->CmdBindDescriptorSets( command_buffer );
+		}
+		group.mesh->CmdBindBuffers( command_buffer );
+
+		if( compacted ) {
+			// visible commands were packed to the front of the group, the GPU knows how many
+			_gpu_culling->CmdDrawIndexedIndirectCount( command_buffer,
+				draw_command_buffer, group.first_command * sizeof( VkDrawIndexedIndirectCommand ),
+				_draw_count_buffer, g * sizeof( uint32_t ),
+				group.command_count, sizeof( VkDrawIndexedIndirectCommand ) );
+		} else if( first_instance ) {
+			CmdDrawCommands( group.first_command, group.command_count );
+		} else if( group.instanced ) {
+			CmdBindInstance( group.first_instance );
+			CmdDrawCommands( group.first_command, group.command_count );
+		} else {
+			uint32_t command	= group.first_command;
+			for( uint32_t i=0; i < group.instance_count; ++i ) {
+				uint32_t count	= UINT32_MAX != group.mesh_instance_batch
+					? group.command_count / group.instance_count
+					: uint32_t( _indirect_draws[ group.first_draw + i ].ranges->size() );
+				CmdBindInstance( group.first_instance + i );
+				CmdDrawCommands( command, count );
+				command			+= count;
+			}
+		}
+	}
+}
+
+bool Scene::_IsCompactingCulledDraws() const
+{
+	// compacted commands lose their order so they can only find their matrices through firstInstance,
+	// and a group is drawn with a single count draw, otherwise culled commands stay in place and draw zero instances
+	auto & features				= _ref_renderer->GetVulkanPhysicalDeviceFeatures();
+	return _gpu_culling && _gpu_culling->CanCompact()
+		&& VK_TRUE == features.drawIndirectFirstInstance
+		&& VK_TRUE == features.multiDrawIndirect;
+}
+
+void Scene::_ReserveIndirectBuffers( size_t instance_count, size_t command_count )
+{
+	auto device					= _ref_renderer->GetVulkanDevice();
+	auto & memory_properties	= _ref_renderer->GetVulkanPhysicalDeviceMemoryProperties();
+
+	// coherent so writes need no flushing
+	if( instance_count > _instance_capacity ) {
+		if( VK_NULL_HANDLE != _instance_buffer ) {
+			vkUnmapMemory( device, _instance_buffer_memory );
+			vkDestroyBuffer( device, _instance_buffer, nullptr );
+			vkFreeMemory( device, _instance_buffer_memory, nullptr );
+		}
+		_instance_capacity		= std::max( _instance_capacity, SCENE_INDIRECT_MIN_CAPACITY );
+		while( _instance_capacity < instance_count ) _instance_capacity *= 2;
+		CreateBuffer( device, &memory_properties, _instance_capacity * sizeof( glm::mat4 ), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &_instance_buffer, &_instance_buffer_memory );
+		ErrorCheck( vkMapMemory( device, _instance_buffer_memory, 0, VK_WHOLE_SIZE, 0, (void**)&_instance_buffer_mapped ) );
+		_mesh_instance_layout_changed	= true;
+	}
+	if( command_count > _command_capacity ) {
+		if( VK_NULL_HANDLE != _command_buffer ) {
+			vkUnmapMemory( device, _command_buffer_memory );
+			vkDestroyBuffer( device, _command_buffer, nullptr );
+			vkFreeMemory( device, _command_buffer_memory, nullptr );
+		}
+		_command_capacity		= std::max( _command_capacity, SCENE_INDIRECT_MIN_CAPACITY );
+		while( _command_capacity < command_count ) _command_capacity *= 2;
+		CreateBuffer( device, &memory_properties, _command_capacity * sizeof( VkDrawIndexedIndirectCommand ), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &_command_buffer, &_command_buffer_memory );
+		ErrorCheck( vkMapMemory( device, _command_buffer_memory, 0, VK_WHOLE_SIZE, 0, (void**)&_command_buffer_mapped ) );
+		_mesh_instance_layout_changed	= true;
+	}
+}
+
+void Scene::_ReserveCullingBuffers( size_t instance_count, size_t command_count )
+{
+	auto device					= _ref_renderer->GetVulkanDevice();
+	auto & memory_properties	= _ref_renderer->GetVulkanPhysicalDeviceMemoryProperties();
+
+	if( instance_count > _cull_instance_capacity ) {
+		if( VK_NULL_HANDLE != _cull_object_buffer ) {
+			vkUnmapMemory( device, _cull_object_buffer_memory );
+			vkDestroyBuffer( device, _cull_object_buffer, nullptr );
+			vkFreeMemory( device, _cull_object_buffer_memory, nullptr );
+			vkDestroyBuffer( device, _draw_count_buffer, nullptr );
+			vkFreeMemory( device, _draw_count_buffer_memory, nullptr );
+		}
+		_cull_instance_capacity	= std::max( _cull_instance_capacity, SCENE_INDIRECT_MIN_CAPACITY );
+		while( _cull_instance_capacity < instance_count ) _cull_instance_capacity *= 2;
+		CreateBuffer( device, &memory_properties, _cull_instance_capacity * sizeof( GPUCullingObject ), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &_cull_object_buffer, &_cull_object_buffer_memory );
+		ErrorCheck( vkMapMemory( device, _cull_object_buffer_memory, 0, VK_WHOLE_SIZE, 0, (void**)&_cull_object_buffer_mapped ) );
+		CreateBuffer( device, &memory_properties, _cull_instance_capacity * sizeof( uint32_t ),
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &_draw_count_buffer, &_draw_count_buffer_memory );
+		_mesh_instance_layout_changed	= true;
+	}
+	if( command_count > _cull_command_capacity ) {
+		if( VK_NULL_HANDLE != _culled_command_buffer ) {
+			vkDestroyBuffer( device, _culled_command_buffer, nullptr );
+			vkFreeMemory( device, _culled_command_buffer_memory, nullptr );
+		}
+		_cull_command_capacity	= std::max( _cull_command_capacity, SCENE_INDIRECT_MIN_CAPACITY );
+		while( _cull_command_capacity < command_count ) _cull_command_capacity *= 2;
+		CreateBuffer( device, &memory_properties, _cull_command_capacity * sizeof( VkDrawIndexedIndirectCommand ),
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &_culled_command_buffer, &_culled_command_buffer_memory );
+	}
+}
+
+void Scene::_DeInitIndirectBuffers()
+{
+	auto device					= _ref_renderer->GetVulkanDevice();
+	if( VK_NULL_HANDLE != _instance_buffer ) {
+		vkUnmapMemory( device, _instance_buffer_memory );
+		vkDestroyBuffer( device, _instance_buffer, nullptr );
+		vkFreeMemory( device, _instance_buffer_memory, nullptr );
+	}
+	if( VK_NULL_HANDLE != _command_buffer ) {
+		vkUnmapMemory( device, _command_buffer_memory );
+		vkDestroyBuffer( device, _command_buffer, nullptr );
+		vkFreeMemory( device, _command_buffer_memory, nullptr );
+	}
+	if( VK_NULL_HANDLE != _cull_object_buffer ) {
+		vkUnmapMemory( device, _cull_object_buffer_memory );
+		vkDestroyBuffer( device, _cull_object_buffer, nullptr );
+		vkFreeMemory( device, _cull_object_buffer_memory, nullptr );
+		vkDestroyBuffer( device, _draw_count_buffer, nullptr );
+		vkFreeMemory( device, _draw_count_buffer_memory, nullptr );
+	}
+	if( VK_NULL_HANDLE != _culled_command_buffer ) {
+		vkDestroyBuffer( device, _culled_command_buffer, nullptr );
+		vkFreeMemory( device, _culled_command_buffer_memory, nullptr );
+	}
+	_instance_buffer			= VK_NULL_HANDLE;
+	_command_buffer				= VK_NULL_HANDLE;
+	_cull_object_buffer			= VK_NULL_HANDLE;
+	_draw_count_buffer			= VK_NULL_HANDLE;
+	_culled_command_buffer		= VK_NULL_HANDLE;
+	_instance_capacity			= 0;
+	_command_capacity			= 0;
+	_cull_instance_capacity		= 0;
+	_cull_command_capacity		= 0;
 }
@@ -1,25 +1,192 @@
 #pragma once
 
 #include "Platform.h"
+#include "SceneObject.h"
+#include "SlotMap.h"
+#include "TransformBatch.h"
+#include "FrustumCulling.h"
 
-#include <list>
+#include <map>
 #include <memory>
+#include <utility>
+#include <vector>
 
-class SceneObject;
+class Renderer;
 class SceneObject_Camera;
+class Surface;
+class GPUMesh;
+class GPUCulling;
+struct GPUCullingObject;
+
+// indirect draw buffers are grown in steps of this many draws
+constexpr size_t SCENE_INDIRECT_MIN_CAPACITY					= 256;
+
+enum class SCENE_SUBMISSION_MODE
+{
+	DIRECT,						// every object records its own binds and draws, the caller binds the pipeline
+	INDIRECT,					// draws are written to buffers and submitted with vkCmdDrawIndexedIndirect, grouped by pipeline and surface
+	INDIRECT_CULLED,			// like indirect, but a compute pass set up by CmdCull drops the draws outside the frustum first
+};
+
+// what culling on the CPU did with the scene objects of one frame
+struct SceneCullingStatistics
+{
+	uint32_t							visible							= 0;		// objects without bounds included
+	uint32_t							outside							= 0;
+	uint32_t							too_small						= 0;
+};
 
 class Scene
 {
 public:
-	Scene();
+	Scene( Renderer * renderer, SCENE_SUBMISSION_MODE submission_mode = SCENE_SUBMISSION_MODE::DIRECT );
 	~Scene();
 
+	// Also brings the world matrices of all objects up to date, parents first so no
+	// matrix is calculated twice and unchanged objects cost only a flag check.
 	void								UpdateLogic();
+	// Indirect mode draws objects that can't be drawn indirectly first with whatever pipeline is bound,
+	// then binds pipelines and surfaces for the rest itself.
 	void								CmdRender( VkCommandBuffer command_buffer );
+	// Indirect culled mode only, collects this frame's draws and culls them on the GPU against the
+	// camera's view_projection. Has to be recorded before the render pass that calls CmdRender.
+	void								CmdCull( VkCommandBuffer command_buffer, const glm::mat4 & view_projection );
+
+	// Objects are kept in one array in no particular order, removing one moves the last object into its place.
+	// The scene doesn't own them, handles of removed objects stay invalid even when their slot is reused.
+	SlotHandle							AddObject( SceneObject * object );
+	void								RemoveObject( SlotHandle handle );
+	size_t								GetObjectCount() const;
+
+	// Copies of a mesh that have nothing but a transformation, for when there are too many for scene objects.
+	// Their transformations are packed per surface and mesh, the scene calculates the model matrices of many
+	// at once and only for copies of meshes that changed. The surface's pipeline has to use
+	// OBJECT_DATA_SOURCE::INSTANCE_BUFFER, instances are drawn at full detail and in the indirect modes only.
+	SlotHandle							AddMeshInstance( Surface * surface, std::shared_ptr<GPUMesh> mesh,
+											const glm::vec3 & position, const glm::quat & rotation, const glm::vec3 & size );
+	void								SetMeshInstanceTransform( SlotHandle handle, const glm::vec3 & position, const glm::quat & rotation, const glm::vec3 & size );
+	void								RemoveMeshInstance( SlotHandle handle );
+	size_t								GetMeshInstanceCount() const;
 
-	void								AddObject( SceneObject * object );
-	void								RemoveObject( SceneObject * object );
+	void								SetSubmissionMode( SCENE_SUBMISSION_MODE submission_mode );
+	SCENE_SUBMISSION_MODE				GetSubmissionMode() const;
+
+	// Scene objects outside of the view_projection frustum are culled on the CPU in the next CmdRender, or in
+	// CmdCull for indirect culled scenes so the GPU never sees them. Call every frame, frames without a
+	// culling view cull nothing on the CPU. Mesh instances are only culled on the GPU.
+	void								SetCullingView( const glm::mat4 & view_projection, const glm::vec3 & camera_position, float pixel_scale );
+	// objects smaller on screen than this many pixels across are culled too, 0 keeps them
+	void								SetMinProjectedSize( float min_projected_size );
+	const SceneCullingStatistics	&	GetCullingStatistics() const;		// of the last frame
 
 private:
-	std::list<SceneObject*>				objects;
+	// draws sharing pipeline, surface, vertex and index buffers, one vkCmdDrawIndexedIndirect with multi draw,
+	// either a mesh instance batch or scene objects
+	struct IndirectGroup
+	{
+		Surface						*	surface							= nullptr;
+		GPUMesh						*	mesh							= nullptr;
+		uint32_t						mesh_instance_batch				= UINT32_MAX;		// UINT32_MAX for scene objects
+		uint32_t						first_draw						= 0;				// in _indirect_draws, scene objects only
+		uint32_t						first_instance					= 0;				// in the instance buffer
+		uint32_t						instance_count					= 0;
+		uint32_t						first_command					= 0;
+		uint32_t						command_count					= 0;
+		bool							instanced						= false;			// commands draw every instance of the group at once
+	};
+
+	// mesh instances of one surface and mesh, transformations start from encoded vertex positions
+	// so the vertex dequantization is already part of them
+	struct MeshInstanceBatch
+	{
+		Surface						*	surface							= nullptr;
+		std::shared_ptr<GPUMesh>		mesh;
+		TransformBatch					transforms;
+		std::vector<SlotHandle>			handles;						// of every instance in transforms
+		bool							changed							= true;			// model matrices need calculating again
+		uint64_t						index_revision					= 0;			// of the mesh when the batch's commands were written
+	};
+
+	struct MeshInstanceLocation
+	{
+		uint32_t						batch							= 0;
+		uint32_t						index							= 0;
+	};
+
+	void								_SetMeshInstanceTransform( MeshInstanceBatch & batch, size_t index,
+											const glm::vec3 & position, const glm::quat & rotation, const glm::vec3 & size );
+	void								_UpdateWorldMatrices();
+	void								_CullObjects();
+	void								_PrepareIndirectDraws();
+	void								_WriteCullObject( uint32_t instance, const glm::vec4 & bounding_sphere, uint32_t first_command, uint32_t command_count, uint32_t group_first_command, uint32_t group );
+	void								_CmdRenderIndirect( VkCommandBuffer command_buffer, VkBuffer draw_command_buffer );
+	bool								_IsCompactingCulledDraws() const;
+	void								_ReserveIndirectBuffers( size_t instance_count, size_t command_count );
+	void								_ReserveCullingBuffers( size_t instance_count, size_t command_count );
+	void								_DeInitIndirectBuffers();
+
+	Renderer						*	_ref_renderer					= nullptr;
+	SCENE_SUBMISSION_MODE				_submission_mode				= SCENE_SUBMISSION_MODE::DIRECT;
+
+	// packed, _object_handles[ i ] is the handle of _objects[ i ] and the slots map handles back to i
+	std::vector<SceneObject*>			_objects;
+	std::vector<SlotHandle>				_object_handles;
+	SlotMap<uint32_t>					_object_slots;
+
+	// batches are never removed, they're sorted by pipeline and surface in _mesh_instance_batch_order
+	std::vector<MeshInstanceBatch>		_mesh_instance_batches;
+	std::vector<uint32_t>				_mesh_instance_batch_order;
+	std::map<std::pair<Surface*, GPUMesh*>, uint32_t>	_mesh_instance_batch_lookup;
+	SlotMap<MeshInstanceLocation>		_mesh_instance_slots;
+	size_t								_mesh_instance_count			= 0;
+	// instances come first in the indirect buffers, their commands and culling data are written
+	// only when this is set, eg. when instances were added or removed or the buffers grew
+	bool								_mesh_instance_layout_changed	= true;
+
+	// objects sorted by hierarchy depth, sorted again when objects or parents change
+	std::vector<SceneObject*>			_world_matrix_order;
+	uint64_t							_world_matrix_order_revision	= 0;
+	bool								_world_matrix_order_dirty		= true;
+
+	// written again every frame in indirect mode, frames don't overlap so one copy of each is enough,
+	// host visible and mapped for as long as they exist
+	VkBuffer							_instance_buffer				= VK_NULL_HANDLE;		// model matrix per mesh instance and object, vertex buffer binding 1 and read by culling
+	VkDeviceMemory						_instance_buffer_memory			= VK_NULL_HANDLE;
+	glm::mat4						*	_instance_buffer_mapped			= nullptr;
+	size_t								_instance_capacity				= 0;
+
+	VkBuffer							_command_buffer					= VK_NULL_HANDLE;		// VkDrawIndexedIndirectCommand per mesh range
+	VkDeviceMemory						_command_buffer_memory			= VK_NULL_HANDLE;
+	VkDrawIndexedIndirectCommand	*	_command_buffer_mapped			= nullptr;
+	size_t								_command_capacity				= 0;
+
+	// culling only, the culled commands and draw counts are written by the GPU so they stay in device local memory
+	VkBuffer							_cull_object_buffer				= VK_NULL_HANDLE;		// GPUCullingObject per mesh instance and object
+	VkDeviceMemory						_cull_object_buffer_memory		= VK_NULL_HANDLE;
+	GPUCullingObject				*	_cull_object_buffer_mapped		= nullptr;
+	VkBuffer							_culled_command_buffer			= VK_NULL_HANDLE;		// as many commands as _command_buffer
+	VkDeviceMemory						_culled_command_buffer_memory	= VK_NULL_HANDLE;
+	VkBuffer							_draw_count_buffer				= VK_NULL_HANDLE;		// uint32_t per group, never more groups than instances
+	VkDeviceMemory						_draw_count_buffer_memory		= VK_NULL_HANDLE;
+	size_t								_cull_instance_capacity			= 0;
+	size_t								_cull_command_capacity			= 0;
+
+	std::unique_ptr<GPUCulling>			_gpu_culling;					// created on the first CmdCull
+
+	// CPU culling, set again every frame
+	Frustum								_culling_frustum;
+	FrustumCullSizeCutoff				_culling_size_cutoff;
+	bool								_culling_view_set				= false;
+	SceneCullingStatistics				_culling_statistics;
+
+	// kept between frames to reuse the space
+	BoundingSphereBatch					_culling_spheres;
+	std::vector<uint32_t>				_culling_sphere_objects;		// index in _objects of every sphere
+	std::vector<FRUSTUM_CULL_RESULT>	_culling_results;
+	std::vector<uint8_t>				_object_visible;				// 1 for visible objects, same order as _objects
+	std::vector<SceneIndirectDraw>		_indirect_draws;
+	std::vector<IndirectGroup>			_indirect_groups;
+	std::vector<SceneObject*>			_direct_objects;				// objects that can't be drawn indirectly
+	uint32_t							_indirect_instance_count		= 0;			// mesh instances and objects in the instance buffer
+	bool								_indirect_prepared				= false;
 };
@@ -3,6 +3,11 @@
 #include "Platform.h"
 #include "Renderer.h"
 #include "Shared.h"
+#include "TransformBatch.h"
+
+#include <algorithm>
+
+uint64_t SceneObject::_hierarchy_revision	= 0;
 
 SceneObject::SceneObject( Renderer * renderer )
 {
@@ -14,13 +19,131 @@ SceneObject::SceneObject( Renderer * renderer )
 
 SceneObject::~SceneObject()
 {
+	SetParent( nullptr );
+	while( !_children.empty() ) {
+		_children.back()->SetParent( nullptr );
+	}
+}
+
+void SceneObject::SetPosition( const glm::vec3 & position )
+{
+	_position			= position;
+	_local_matrix_dirty	= true;
+	_MarkWorldMatrixDirty();
+}
+
+void SceneObject::SetSize( const glm::vec3 & size )
+{
+	_size				= size;
+	_local_matrix_dirty	= true;
+	_MarkWorldMatrixDirty();
+}
+
+void SceneObject::SetRotation( const glm::quat & rotation )
+{
+	_rotation			= rotation;
+	_local_matrix_dirty	= true;
+	_MarkWorldMatrixDirty();
+}
+
+const glm::vec3 & SceneObject::GetPosition() const
+{
+	return _position;
+}
+
+const glm::vec3 & SceneObject::GetSize() const
+{
+	return _size;
+}
+
+const glm::quat & SceneObject::GetRotation() const
+{
+	return _rotation;
+}
+
+void SceneObject::SetParent( SceneObject * parent )
+{
+	if( parent == _parent ) return;
+	for( auto p = parent; nullptr != p; p = p->_parent ) {
+		assert( p != this && "Object can't be its own ancestor." );
+	}
+
+	if( nullptr != _parent ) {
+		auto & siblings	= _parent->_children;
+		siblings.erase( std::find( siblings.begin(), siblings.end(), this ) );
+	}
+	_parent				= parent;
+	if( nullptr != _parent ) {
+		_parent->_children.push_back( this );
+	}
+	_MarkWorldMatrixDirty();
+	++_hierarchy_revision;
+}
+
+SceneObject * SceneObject::GetParent() const
+{
+	return _parent;
+}
+
+const std::vector<SceneObject*> & SceneObject::GetChildren() const
+{
+	return _children;
+}
+
+uint32_t SceneObject::GetHierarchyDepth() const
+{
+	uint32_t depth		= 0;
+	for( auto p = _parent; nullptr != p; p = p->_parent ) ++depth;
+	return depth;
+}
+
+const glm::mat4 & SceneObject::GetLocalMatrix()
+{
+	if( _local_matrix_dirty ) {
+		_local_matrix		= Transform_CalculateMatrix( _position, _rotation, _size );
+		_local_matrix_dirty	= false;
+	}
+	return _local_matrix;
+}
+
+const glm::mat4 & SceneObject::GetWorldMatrix()
+{
+	if( _world_matrix_dirty ) {
+		if( nullptr != _parent ) {
+			_world_matrix	= _parent->GetWorldMatrix() * GetLocalMatrix();
+		} else {
+			_world_matrix	= GetLocalMatrix();
+		}
+		_world_matrix_dirty	= false;
+	}
+	return _world_matrix;
+}
+
+glm::vec3 SceneObject::GetWorldPosition()
+{
+	return glm::vec3( GetWorldMatrix()[ 3 ] );
+}
+
+uint64_t SceneObject::GetHierarchyRevision()
+{
+	return _hierarchy_revision;
+}
+
+bool SceneObject::PrepareIndirectDraw( SceneIndirectDraw * draw )
+{
+	return false;
+}
+
+bool SceneObject::GetWorldBoundingSphere( glm::vec4 * sphere )
+{
+	return false;
 }
 
-glm::mat4 SceneObject::CalculateTransformationMatrix()
+void SceneObject::_MarkWorldMatrixDirty()
 {
-	glm::mat4 ret = glm::mat4( 1 );
-	ret = glm::translate( ret, position );
-	ret *= glm::mat4_cast( rotation );
-	ret = glm::scale( ret, size );
-	return ret;
+	if( _world_matrix_dirty ) return;
+	_world_matrix_dirty	= true;
+	for( auto c : _children ) {
+		c->_MarkWorldMatrixDirty();
+	}
 }
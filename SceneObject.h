@@ -2,7 +2,12 @@
 
 #include "Platform.h"
 
+#include <vector>
+
 class Renderer;
+class Surface;
+class GPUMesh;
+struct MeshDrawRange;
 
 struct UBOData_Camera
 {
@@ -15,22 +20,83 @@ struct UBOData_Object
 	glm::mat4 Model_Matrix;
 };
 
+// same data for pipelines using OBJECT_DATA_SOURCE::PUSH_CONSTANTS, must fit the 128 bytes every device has
+struct PushConstants_Object
+{
+	glm::mat4 Model_Matrix;
+};
+
+// What an object draws when a scene submits it with SCENE_SUBMISSION_MODE::INDIRECT,
+// the scene writes the model matrix and the draw commands to buffers of its own.
+struct SceneIndirectDraw
+{
+	Surface									*	surface					= nullptr;
+	GPUMesh									*	mesh					= nullptr;
+	const std::vector<MeshDrawRange>		*	ranges					= nullptr;		// mesh relative, eg. from GPUMesh::GetLODs()
+	glm::mat4									model_matrix			= glm::mat4( 1.0f );
+	glm::vec4									bounding_sphere			= glm::vec4( 0.0f );	// center and radius before model_matrix, for culling on the GPU
+};
+
 class SceneObject
 {
 public:
 	SceneObject( Renderer * renderer );
 	virtual ~SceneObject();
 
-	glm::vec3					position				= glm::vec3( 0, 0, 0 );
-	glm::vec3					size					= glm::vec3( 1, 1, 1 );
-	glm::quat					rotation				= glm::quat( 1, 0, 0, 0 );
+	// Transformation relative to the parent. Setting any of these marks the world matrices of
+	// the object and all of its descendants to be calculated again the next time they're needed.
+	void						SetPosition( const glm::vec3 & position );
+	void						SetSize( const glm::vec3 & size );
+	void						SetRotation( const glm::quat & rotation );
+	const glm::vec3			&	GetPosition() const;
+	const glm::vec3			&	GetSize() const;
+	const glm::quat			&	GetRotation() const;
+
+	// Children follow the world matrix of their parent, nullptr detaches. Objects detach from
+	// their parent and children when destroyed.
+	void						SetParent( SceneObject * parent );
+	SceneObject				*	GetParent() const;
+	const std::vector<SceneObject*>	&	GetChildren() const;
+	uint32_t					GetHierarchyDepth() const;				// 0 for objects without a parent
 
-	glm::mat4					CalculateTransformationMatrix();
+	// Both are cached, the world matrix is the parent's world matrix times the local matrix
+	// and only dirty ancestors are calculated again on the way up.
+	const glm::mat4			&	GetLocalMatrix();
+	const glm::mat4			&	GetWorldMatrix();
+	glm::vec3					GetWorldPosition();
+
+	// changes whenever any object gets a new parent, lets scenes know when to sort their objects again
+	static uint64_t				GetHierarchyRevision();
 
 	virtual void				UpdateLogic()								= 0;
 	virtual void				CmdRender( VkCommandBuffer command_buffer )	= 0;
 
+	// Called instead of CmdRender by scenes submitting draws indirectly, once per frame. Objects that can't
+	// be drawn that way return false and the scene calls CmdRender for them instead.
+	virtual bool				PrepareIndirectDraw( SceneIndirectDraw * draw );
+
+	// Center and radius in world space for culling by the scene, objects without bounds return false and are never culled.
+	virtual bool				GetWorldBoundingSphere( glm::vec4 * sphere );
+
 protected:
 	Renderer				*	_ref_renderer							= nullptr;
 	VkDevice					_ref_vk_device							= VK_NULL_HANDLE;
+
+private:
+	void						_MarkWorldMatrixDirty();
+
+	glm::vec3					_position								= glm::vec3( 0, 0, 0 );
+	glm::vec3					_size									= glm::vec3( 1, 1, 1 );
+	glm::quat					_rotation								= glm::quat( 1, 0, 0, 0 );
+
+	SceneObject				*	_parent									= nullptr;
+	std::vector<SceneObject*>	_children;
+
+	// a dirty world matrix always has dirty world matrices below it, so marking can stop at the first dirty one
+	glm::mat4					_local_matrix							= glm::mat4( 1 );
+	glm::mat4					_world_matrix							= glm::mat4( 1 );
+	bool						_local_matrix_dirty						= true;
+	bool						_world_matrix_dirty						= true;
+
+	static uint64_t				_hierarchy_revision;
 };
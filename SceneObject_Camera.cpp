@@ -32,7 +32,7 @@ void SceneObject_Camera::CmdRender( VkCommandBuffer command_buffer )
 
 glm::mat4 SceneObject_Camera::CalculateViewMatrix()
 {
-	return glm::inverse( CalculateTransformationMatrix() );
+	return glm::inverse( GetWorldMatrix() );
 }
 
 glm::mat4 SceneObject_Camera::CalculateProjectionMatrix( float fov_angle, VkExtent2D viewport_size, float near_plane, float far_plane )
@@ -41,6 +41,12 @@ glm::mat4 SceneObject_Camera::CalculateProjectionMatrix( float fov_angle, VkExte
 	return ret;
 }
 
+float SceneObject_Camera::CalculateProjectedPixelScale( float fov_angle, VkExtent2D viewport_size )
+{
+	// same vertical field of view as the projection matrix, size on screen is this divided by the distance
+	return float( viewport_size.height ) * 0.5f / std::tan( glm::radians( fov_angle ) * 0.5f );
+}
+
 void SceneObject_Camera::CmdUpdateUBOAndBindDescriptorSetsForPipeline(
 	VkCommandBuffer command_buffer,
 	float fov_angle,
@@ -17,6 +17,7 @@ public:
 
 	glm::mat4					CalculateViewMatrix();
 	glm::mat4					CalculateProjectionMatrix( float fov_angle, VkExtent2D viewport_size, float near_plane, float far_plane );
+	float						CalculateProjectedPixelScale( float fov_angle, VkExtent2D viewport_size );	// pixels one unit covers one unit in front of the camera
 
 	void						CmdUpdateUBOAndBindDescriptorSetsForPipeline(
 		VkCommandBuffer command_buffer,
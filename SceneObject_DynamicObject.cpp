@@ -8,6 +8,12 @@
 #include "Pipeline.h"
 #include "Surface.h"
 #include "Texture.h"
+#include "MeshRegistry.h"
+#include "UniformRing.h"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
 
 SceneObject_DynamicObject::SceneObject_DynamicObject( Renderer * renderer, Surface * object_material, MESH_OBJECT_SHAPE default_shape )
 	: SceneObject( renderer )
@@ -16,13 +22,9 @@ SceneObject_DynamicObject::SceneObject_DynamicObject( Renderer * renderer, Surfa
 	assert( nullptr != object_material );
 	_ref_material	= object_material;
 
-	_mesh			= std::unique_ptr<Mesh>( new Mesh );
-	_mesh->GenerateShape( default_shape );
+	_gpu_mesh		= _ref_renderer->GetMeshRegistry()->AcquireShape( default_shape, object_material->GetPipeline()->GetVertexLayout() );
 
-	_InitMeshBuffers();
-	_Allocate_ObjectUBO();
-	_descriptor_set_info.descriptor_set			= _ref_renderer->AllocateDescriptorSet( DESCRIPTOR_SET_TYPE::SCENE_OBJECT );
-	_UpdateDescriptorSet_ObjectUBO();
+	_InitDrawRanges();
 }
 
 SceneObject_DynamicObject::SceneObject_DynamicObject( Renderer * renderer, Surface * object_material, std::string path )
@@ -32,20 +34,45 @@ SceneObject_DynamicObject::SceneObject_DynamicObject( Renderer * renderer, Surfa
 	assert( nullptr != object_material );
 	_ref_material	= object_material;
 
-	_mesh			= std::unique_ptr<Mesh>( new Mesh );
-	_mesh->Load( path );
+	_gpu_mesh		= _ref_renderer->GetMeshRegistry()->AcquireFile( path, object_material->GetPipeline()->GetVertexLayout() );
+
+	_InitDrawRanges();
+}
+
+SceneObject_DynamicObject::SceneObject_DynamicObject( Renderer * renderer, Surface * object_material, std::unique_ptr<Mesh> mesh )
+	: SceneObject( renderer )
+{
+	assert( nullptr != renderer );
+	assert( nullptr != object_material );
+	_ref_material	= object_material;
+
+	// a mesh that failed to load still gets an object, drawn as a cube so it's easy to spot
+	if( nullptr == mesh ) {
+		std::cout << "No mesh for scene object, using a cube instead" << std::endl;
+		_gpu_mesh	= _ref_renderer->GetMeshRegistry()->AcquireShape( MESH_OBJECT_SHAPE::CUBE, object_material->GetPipeline()->GetVertexLayout() );
+	} else {
+		_gpu_mesh	= _ref_renderer->GetMeshRegistry()->AcquireMesh( std::move( mesh ), object_material->GetPipeline()->GetVertexLayout() );
+	}
 
-	_InitMeshBuffers();
-	_Allocate_ObjectUBO();
-	_descriptor_set_info.descriptor_set			= _ref_renderer->AllocateDescriptorSet( DESCRIPTOR_SET_TYPE::SCENE_OBJECT );
-	_UpdateDescriptorSet_ObjectUBO();
+	_InitDrawRanges();
+}
+
+SceneObject_DynamicObject::SceneObject_DynamicObject( Renderer * renderer, Surface * object_material, std::shared_ptr<GPUMesh> mesh )
+	: SceneObject( renderer )
+{
+	assert( nullptr != renderer );
+	assert( nullptr != object_material );
+	assert( nullptr != mesh );
+	assert( object_material->GetPipeline()->GetVertexLayout() == mesh->GetVertexLayout() );
+	_ref_material	= object_material;
+
+	_gpu_mesh		= std::move( mesh );
+
+	_InitDrawRanges();
 }
 
 SceneObject_DynamicObject::~SceneObject_DynamicObject()
 {
-	_ref_renderer->FreeDescriptorSet( _descriptor_set_info.descriptor_set );
-	_DeAllocate_ObjectUBO();
-	_DeInitMeshBuffers();
 }
 
 void SceneObject_DynamicObject::UpdateLogic()
@@ -54,170 +81,148 @@ void SceneObject_DynamicObject::UpdateLogic()
 
 void SceneObject_DynamicObject::CmdRender( VkCommandBuffer command_buffer )
 {
-	// update and bind object shader data
-	_Update_ObjectUBO();
-//	_UpdateDescriptorSet_ObjectUBO();	// Only needed to do once in our case so this call is moved to a constructor
-	_CmdBindDescriptorSet_ObjectUBO( command_buffer );
+	// instance buffer pipelines need the model matrix in a vertex buffer, only scenes drawing indirectly provide one
+	assert( OBJECT_DATA_SOURCE::INSTANCE_BUFFER != _ref_material->GetPipeline()->GetObjectDataSource() );
+
+	// update vertex buffer, only if the mesh changed. Goes first as it can change the dequantization in the model matrix
+	_UploadVertices();
+
+	// update and bind object shader data, push constants go straight into the command buffer,
+	// otherwise every draw gets its own space in this frame's uniform ring
+	if( OBJECT_DATA_SOURCE::PUSH_CONSTANTS == _ref_material->GetPipeline()->GetObjectDataSource() ) {
+		_CmdPushConstants_Object( command_buffer );
+	} else {
+		_CmdBindDescriptorSet_ObjectUBO( command_buffer, _Update_ObjectUBO() );
+	}
 
 	// update and bind material shader data
 	_ref_material->UpdateDescriptorSets();
 	_ref_material->CmdBindDescriptorSets( command_buffer );
 
-	// update vertex buffer
-	Vertex * mapped = nullptr;
-	ErrorCheck( vkMapMemory( _ref_renderer->GetVulkanDevice(), _vbo_memory, 0, _mesh->GetVerticesByteSize(), 0, (void**)&mapped ) );
-	std::memcpy( mapped, _mesh->vertices.data(), _mesh->GetVerticesByteSize() );
-	vkUnmapMemory( _ref_renderer->GetVulkanDevice(), _vbo_memory );
+	// bind vertex and index buffers if another mesh changed them, draw
+	_gpu_mesh->CmdDraw( command_buffer, _visible_ranges );
+}
+
+bool SceneObject_DynamicObject::PrepareIndirectDraw( SceneIndirectDraw * draw )
+{
+	if( OBJECT_DATA_SOURCE::INSTANCE_BUFFER != _ref_material->GetPipeline()->GetObjectDataSource() ) return false;
+
+	// same as CmdRender, the scene writes the model matrix to its instance buffer and draws the ranges
+	_UploadVertices();
+	draw->surface				= _ref_material;
+	draw->mesh					= _gpu_mesh.get();
+	draw->ranges				= &_visible_ranges;
+	draw->model_matrix			= _CalculateModelMatrix();
+
+	// model matrix starts from encoded positions
+	draw->bounding_sphere		= _gpu_mesh->GetEncodedBoundingSphere();
+	return true;
+}
 
-	// bind vertex and index buffers, draw
-	VkDeviceSize offset = 0;
-	vkCmdBindVertexBuffers( command_buffer, 0, 1, &_vbo, &offset );
-	vkCmdBindIndexBuffer( command_buffer, _ibo, 0, VK_INDEX_TYPE_UINT32 );
-	vkCmdDrawIndexed( command_buffer, 3 * _mesh->triangles.size(), 1, 0, 0, 0 );
+bool SceneObject_DynamicObject::GetWorldBoundingSphere( glm::vec4 * sphere )
+{
+	// the largest scale parents included keeps the sphere around the mesh
+	auto & world				= GetWorldMatrix();
+	float scale					= std::max( { glm::length( glm::vec3( world[ 0 ] ) ), glm::length( glm::vec3( world[ 1 ] ) ), glm::length( glm::vec3( world[ 2 ] ) ) } );
+	glm::vec3 center			= glm::vec3( world * glm::vec4( _gpu_mesh->GetBoundingCenter(), 1.0f ) );
+	*sphere						= glm::vec4( center, _gpu_mesh->GetBoundingRadius() * scale );
+	return true;
 }
 
 void SceneObject_DynamicObject::SetSurface( Surface * material )
 {
+	// vertex buffer is already encoded for the old pipeline
+	assert( material->GetPipeline()->GetVertexLayout() == _gpu_mesh->GetVertexLayout() );
 	_ref_material			= material;
 }
 
-VkBuffer SceneObject_DynamicObject::_Get_ObjectUBO()
+std::shared_ptr<GPUMesh> SceneObject_DynamicObject::GetGPUMesh()
 {
-	return _descriptor_set_info.ubo;
+	return _gpu_mesh;
 }
 
-void SceneObject_DynamicObject::_Update_ObjectUBO()
+void SceneObject_DynamicObject::SelectLOD( const glm::vec3 & camera_position, float pixel_scale )
 {
-	UBOData_Object * data	= nullptr;
-	vkMapMemory( _ref_vk_device, _descriptor_set_info.ubo_memory, 0, sizeof( UBOData_Object ), 0, (void**)&data );
-	data->Model_Matrix			= CalculateTransformationMatrix();
-	vkUnmapMemory( _ref_vk_device, _descriptor_set_info.ubo_memory );
+	// another object sharing the mesh may have rebuilt it since this one was drawn
+	if( _gpu_mesh->GetIndexRevision() != _index_revision ) _InitDrawRanges();
+	auto & lods					= _gpu_mesh->GetLODs();
+	if( lods.size() < 2 ) return;
+
+	// errors are in mesh units, the largest scale parents included is the worst case
+	auto & world				= GetWorldMatrix();
+	float scale					= std::max( { glm::length( glm::vec3( world[ 0 ] ) ), glm::length( glm::vec3( world[ 1 ] ) ), glm::length( glm::vec3( world[ 2 ] ) ) } );
+	glm::vec3 center			= glm::vec3( world * glm::vec4( _gpu_mesh->GetBoundingCenter(), 1.0f ) );
+	float distance				= std::max( glm::length( center - camera_position ) - _gpu_mesh->GetBoundingRadius() * scale, std::numeric_limits<float>::min() );
+	auto ProjectedError = [ & ]( size_t lod ) {
+		return lods[ lod ].error * scale * pixel_scale / distance;
+	};
+
+	size_t lod					= _lod;
+	while( lod > 0 && ProjectedError( lod ) > SO_LOD_MAX_PIXEL_ERROR ) --lod;
+	while( lod + 1 < lods.size() && ProjectedError( lod + 1 ) < SO_LOD_MAX_PIXEL_ERROR * ( 1.0f - SO_LOD_HYSTERESIS ) ) ++lod;
+	if( lod != _lod ) {
+		_lod					= lod;
+		_visible_ranges			= lods[ _lod ].draw_ranges;
+	}
 }
 
-void SceneObject_DynamicObject::_UpdateDescriptorSet_ObjectUBO()
+void SceneObject_DynamicObject::CullClusters( const glm::mat4 & view_projection, const glm::vec3 & camera_position )
 {
-	assert( VK_NULL_HANDLE != _descriptor_set_info.ubo );
-	assert( VK_NULL_HANDLE != _descriptor_set_info.descriptor_set );
-
-	std::vector<VkWriteDescriptorSet> write_sets( 1 );
-
-	VkDescriptorBufferInfo write_buffer_info {};
-	write_buffer_info.buffer			= _descriptor_set_info.ubo;
-	write_buffer_info.offset			= 0;
-	write_buffer_info.range				= sizeof( UBOData_Object );
+	if( _gpu_mesh->GetIndexRevision() != _index_revision ) _InitDrawRanges();
+	auto & lod					= _gpu_mesh->GetLODs()[ _lod ];
+	if( lod.clusters.empty() ) return;
+
+	// culling happens in mesh space, clusters never have to be transformed
+	auto & model				= GetWorldMatrix();
+	glm::vec3 mesh_camera		= glm::vec3( glm::inverse( model ) * glm::vec4( camera_position, 1.0f ) );
+	MeshClusters_Cull( lod.clusters, view_projection * model, mesh_camera, lod.draw_ranges, _visible_ranges );
+}
 
-	write_sets[ 0 ].sType				= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	write_sets[ 0 ].dstSet				= _descriptor_set_info.descriptor_set;
-	write_sets[ 0 ].dstBinding			= 0;
-	write_sets[ 0 ].dstArrayElement		= 0;
-	write_sets[ 0 ].descriptorCount		= 1;
-	write_sets[ 0 ].descriptorType		= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	write_sets[ 0 ].pImageInfo			= nullptr;
-	write_sets[ 0 ].pBufferInfo			= &write_buffer_info;
-	write_sets[ 0 ].pTexelBufferView	= nullptr;
+glm::mat4 SceneObject_DynamicObject::_CalculateModelMatrix()
+{
+	// quantized positions are scaled back to object space here so shaders don't have to
+	auto & dq					= _gpu_mesh->GetVertexDequantization();
+	return GetWorldMatrix()
+		* glm::translate( glm::mat4( 1.0f ), glm::vec3( dq.offset[ 0 ], dq.offset[ 1 ], dq.offset[ 2 ] ) )
+		* glm::scale( glm::mat4( 1.0f ), glm::vec3( dq.scale[ 0 ], dq.scale[ 1 ], dq.scale[ 2 ] ) );
+}
 
-	vkUpdateDescriptorSets( _ref_vk_device, uint32_t( write_sets.size() ), write_sets.data(), 0, nullptr );
+UniformRingAllocation SceneObject_DynamicObject::_Update_ObjectUBO()
+{
+	auto allocation				= _ref_renderer->GetObjectUniformRing()->Allocate();
+	UBOData_Object * data		= static_cast<UBOData_Object*>( allocation.data );
+	data->Model_Matrix			= _CalculateModelMatrix();
+	return allocation;
 }
 
-void SceneObject_DynamicObject::_CmdBindDescriptorSet_ObjectUBO( VkCommandBuffer command_buffer )
+void SceneObject_DynamicObject::_CmdBindDescriptorSet_ObjectUBO( VkCommandBuffer command_buffer, const UniformRingAllocation & allocation )
 {
 	vkCmdBindDescriptorSets( command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
 		_ref_material->GetPipeline()->GetVulkanPipelineLayout(),
 		1,
-		1, &_descriptor_set_info.descriptor_set,
-		0, nullptr );
+		1, &allocation.descriptor_set,
+		1, &allocation.dynamic_offset );
 }
 
-void SceneObject_DynamicObject::_InitMeshBuffers()
+void SceneObject_DynamicObject::_CmdPushConstants_Object( VkCommandBuffer command_buffer )
 {
-	{
-		VkBufferCreateInfo buffer_create_info {};
-		buffer_create_info.sType					= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		buffer_create_info.flags					= 0;
-		buffer_create_info.size						= _mesh->GetVerticesByteSize();
-		buffer_create_info.usage					= VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-		buffer_create_info.sharingMode				= VK_SHARING_MODE_EXCLUSIVE;
-		vkCreateBuffer( _ref_renderer->GetVulkanDevice(), &buffer_create_info, nullptr, &_vbo );
-
-		VkMemoryRequirements memory_requirements {};
-		vkGetBufferMemoryRequirements( _ref_renderer->GetVulkanDevice(), _vbo, &memory_requirements );
-
-		auto id = FindMemoryTypeIndex( &_ref_renderer->GetVulkanPhysicalDeviceMemoryProperties(), &memory_requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT );
-
-		VkMemoryAllocateInfo memory_allocate_info {};
-		memory_allocate_info.sType				= VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		memory_allocate_info.allocationSize		= memory_requirements.size;
-		memory_allocate_info.memoryTypeIndex	= id;
-		vkAllocateMemory( _ref_renderer->GetVulkanDevice(), &memory_allocate_info, nullptr, &_vbo_memory );
-
-		Vertex * mapped = nullptr;
-		ErrorCheck( vkMapMemory( _ref_renderer->GetVulkanDevice(), _vbo_memory, 0, _mesh->GetVerticesByteSize(), 0, (void**)&mapped ) );
-		std::memcpy( mapped, _mesh->vertices.data(), _mesh->GetVerticesByteSize() );
-		vkUnmapMemory( _ref_renderer->GetVulkanDevice(), _vbo_memory );
-
-		vkBindBufferMemory( _ref_renderer->GetVulkanDevice(), _vbo, _vbo_memory, 0 );
-	}
-	{
-		VkBufferCreateInfo buffer_create_info {};
-		buffer_create_info.sType					= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		buffer_create_info.flags					= 0;
-		buffer_create_info.size						= _mesh->GetIndicesByteSize();
-		buffer_create_info.usage					= VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-		buffer_create_info.sharingMode				= VK_SHARING_MODE_EXCLUSIVE;
-		vkCreateBuffer( _ref_renderer->GetVulkanDevice(), &buffer_create_info, nullptr, &_ibo );
-
-		VkMemoryRequirements memory_requirements {};
-		vkGetBufferMemoryRequirements( _ref_renderer->GetVulkanDevice(), _ibo, &memory_requirements );
-
-		auto id = FindMemoryTypeIndex( &_ref_renderer->GetVulkanPhysicalDeviceMemoryProperties(), &memory_requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT );
-
-		VkMemoryAllocateInfo memory_allocate_info {};
-		memory_allocate_info.sType				= VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		memory_allocate_info.allocationSize		= memory_requirements.size;
-		memory_allocate_info.memoryTypeIndex	= id;
-		vkAllocateMemory( _ref_renderer->GetVulkanDevice(), &memory_allocate_info, nullptr, &_ibo_memory );
-
-		Triangle * mapped = nullptr;
-		ErrorCheck( vkMapMemory( _ref_renderer->GetVulkanDevice(), _ibo_memory, 0, _mesh->GetIndicesByteSize(), 0, (void**)&mapped ) );
-		std::memcpy( mapped, _mesh->triangles.data(), _mesh->GetIndicesByteSize() );
-		vkUnmapMemory( _ref_renderer->GetVulkanDevice(), _ibo_memory );
-
-		vkBindBufferMemory( _ref_renderer->GetVulkanDevice(), _ibo, _ibo_memory, 0 );
-	}
-}
-
-void SceneObject_DynamicObject::_DeInitMeshBuffers()
-{
-	vkDestroyBuffer( _ref_renderer->GetVulkanDevice(), _ibo, nullptr );
-	vkDestroyBuffer( _ref_renderer->GetVulkanDevice(), _vbo, nullptr );
-	vkFreeMemory( _ref_renderer->GetVulkanDevice(), _ibo_memory, nullptr );
-	vkFreeMemory( _ref_renderer->GetVulkanDevice(), _vbo_memory, nullptr );
+	PushConstants_Object data {};
+	data.Model_Matrix			= _CalculateModelMatrix();
+	vkCmdPushConstants( command_buffer,
+		_ref_material->GetPipeline()->GetVulkanPipelineLayout(),
+		VK_SHADER_STAGE_VERTEX_BIT,
+		0, sizeof( data ), &data );
 }
 
-void SceneObject_DynamicObject::_Allocate_ObjectUBO()
+void SceneObject_DynamicObject::_InitDrawRanges()
 {
-	VkBufferCreateInfo buffer_create_info {};
-	buffer_create_info.sType			= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	buffer_create_info.flags			= 0;
-	buffer_create_info.size				= sizeof( UBOData_Object );
-	buffer_create_info.usage			= VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-	buffer_create_info.sharingMode		= VK_SHARING_MODE_EXCLUSIVE;
-	vkCreateBuffer( _ref_vk_device, &buffer_create_info, nullptr, &_descriptor_set_info.ubo );
-
-	VkMemoryRequirements memory_requirements {};
-	vkGetBufferMemoryRequirements( _ref_vk_device, _descriptor_set_info.ubo, &memory_requirements );
-	auto memory_index = FindMemoryTypeIndex( &_ref_renderer->GetVulkanPhysicalDeviceMemoryProperties(), &memory_requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT );
-
-	VkMemoryAllocateInfo memory_allocate_info {};
-	memory_allocate_info.sType				= VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	memory_allocate_info.allocationSize		= memory_requirements.size;
-	memory_allocate_info.memoryTypeIndex	= memory_index;
-	vkAllocateMemory( _ref_vk_device, &memory_allocate_info, nullptr, &_descriptor_set_info.ubo_memory );
-	vkBindBufferMemory( _ref_vk_device, _descriptor_set_info.ubo, _descriptor_set_info.ubo_memory, 0 );
+	_lod				= 0;
+	_visible_ranges		= _gpu_mesh->GetLODs()[ 0 ].draw_ranges;
+	_index_revision		= _gpu_mesh->GetIndexRevision();
 }
 
-void SceneObject_DynamicObject::_DeAllocate_ObjectUBO()
+void SceneObject_DynamicObject::_UploadVertices()
 {
-	vkDestroyBuffer( _ref_vk_device, _descriptor_set_info.ubo, nullptr );
-	vkFreeMemory( _ref_vk_device, _descriptor_set_info.ubo_memory, nullptr );
+	_gpu_mesh->UploadVertices();
+	if( _gpu_mesh->GetIndexRevision() != _index_revision ) _InitDrawRanges();
 }
@@ -3,6 +3,7 @@
 #include "Platform.h"
 #include "SceneObject.h"
 #include "Mesh.h"
+#include "GPUMesh.h"
 
 #include <memory>
 
@@ -11,48 +12,55 @@ class Surface;
 class GraphicsPipeline;
 class Mesh;
 class Texture;
+struct UniformRingAllocation;
 
-struct SO_DescriptorSetInfo_DynamicObject
-{
-	VkBuffer				ubo						= VK_NULL_HANDLE;
-	VkDeviceMemory			ubo_memory				= VK_NULL_HANDLE;
-	VkDescriptorSet			descriptor_set			= VK_NULL_HANDLE;
-};
+// Levels of detail switch once their error covers this many pixels on screen, coarser levels
+// are only picked when they're this much below the limit so objects don't flicker between levels.
+constexpr float SO_LOD_MAX_PIXEL_ERROR							= 1.0f;
+constexpr float SO_LOD_HYSTERESIS								= 0.25f;
 
 class SceneObject_DynamicObject : public SceneObject
 {
 public:
 	SceneObject_DynamicObject( Renderer * renderer, Surface * object_material, MESH_OBJECT_SHAPE default_shape = MESH_OBJECT_SHAPE::NONE );
 	SceneObject_DynamicObject( Renderer * renderer, Surface * object_material, std::string path );
+	SceneObject_DynamicObject( Renderer * renderer, Surface * object_material, std::unique_ptr<Mesh> mesh );	// takes an already loaded mesh, eg. from AssetLoader, a cube if it's nullptr
+	SceneObject_DynamicObject( Renderer * renderer, Surface * object_material, std::shared_ptr<GPUMesh> mesh );	// shares the mesh of another object
 	~SceneObject_DynamicObject();
 
 	void						UpdateLogic();
 	void						CmdRender( VkCommandBuffer command_buffer );
+	bool						PrepareIndirectDraw( SceneIndirectDraw * draw );	// only with OBJECT_DATA_SOURCE::INSTANCE_BUFFER pipelines
+	bool						GetWorldBoundingSphere( glm::vec4 * sphere );		// the mesh bounds, see Mesh::GetBounds()
 
 	void						SetSurface( Surface * surface );
+	std::shared_ptr<GPUMesh>	GetGPUMesh();
 
-//private:
-	VkBuffer					_Get_ObjectUBO();
-	void						_Update_ObjectUBO();
+	// Picks the coarsest level of detail that still looks the same from the camera,
+	// pixel_scale comes from SceneObject_Camera::CalculateProjectedPixelScale.
+	void						SelectLOD( const glm::vec3 & camera_position, float pixel_scale );
 
-	void						_UpdateDescriptorSet_ObjectUBO();
-	void						_CmdBindDescriptorSet_ObjectUBO( VkCommandBuffer command_buffer );
+	// Picks the clusters of large meshes that can be seen from the camera, call every frame
+	// after SelectLOD and before CmdRender, until then everything is drawn. Small meshes are always drawn whole.
+	void						CullClusters( const glm::mat4 & view_projection, const glm::vec3 & camera_position );
 
-	void						_InitMeshBuffers();
-	void						_DeInitMeshBuffers();
+//private:
+	glm::mat4					_CalculateModelMatrix();		// transformation with the vertex dequantization folded in
 
-	void						_Allocate_ObjectUBO();
-	void						_DeAllocate_ObjectUBO();
+	UniformRingAllocation		_Update_ObjectUBO();
+	void						_CmdBindDescriptorSet_ObjectUBO( VkCommandBuffer command_buffer, const UniformRingAllocation & allocation );
+	void						_CmdPushConstants_Object( VkCommandBuffer command_buffer );
 
-	Surface				*	_ref_material								= nullptr;
+	void						_InitDrawRanges();
+	void						_UploadVertices();				// and starts over from full detail if that rebuilt the mesh's draw ranges
 
-	VkBuffer					_vbo										= VK_NULL_HANDLE;
-	VkBuffer					_ibo										= VK_NULL_HANDLE;
+	Surface				*	_ref_material								= nullptr;
 
-	VkDeviceMemory				_vbo_memory									= VK_NULL_HANDLE;
-	VkDeviceMemory				_ibo_memory									= VK_NULL_HANDLE;
+	// shared with every other object drawing the same mesh, see MeshRegistry
+	std::shared_ptr<GPUMesh>	_gpu_mesh;
 
-	SO_DescriptorSetInfo_DynamicObject	_descriptor_set_info;
-public:
-	std::unique_ptr<Mesh>		_mesh;
+	// level of detail in use and its clusters that survived culling
+	size_t						_lod										= 0;
+	std::vector<MeshDrawRange>	_visible_ranges;
+	uint64_t					_index_revision								= 0;		// of the GPU mesh the ranges came from
 };
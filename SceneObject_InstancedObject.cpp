@@ -0,0 +1,152 @@
+#include "SceneObject_InstancedObject.h"
+
+#include "Shared.h"
+#include "Renderer.h"
+#include "Mesh.h"
+#include "Platform.h"
+#include "Pipeline.h"
+#include "Surface.h"
+#include "MeshRegistry.h"
+
+#include <assert.h>
+#include <algorithm>
+#include <iostream>
+
+SceneObject_InstancedObject::SceneObject_InstancedObject( Renderer * renderer, Surface * object_material, MESH_OBJECT_SHAPE default_shape )
+	: SceneObject( renderer )
+{
+	assert( nullptr != renderer );
+	assert( nullptr != object_material );
+	assert( OBJECT_DATA_SOURCE::INSTANCE_BUFFER == object_material->GetPipeline()->GetObjectDataSource() );
+	_ref_material	= object_material;
+
+	_gpu_mesh		= _ref_renderer->GetMeshRegistry()->AcquireShape( default_shape, object_material->GetPipeline()->GetVertexLayout() );
+}
+
+SceneObject_InstancedObject::SceneObject_InstancedObject( Renderer * renderer, Surface * object_material, std::unique_ptr<Mesh> mesh )
+	: SceneObject( renderer )
+{
+	assert( nullptr != renderer );
+	assert( nullptr != object_material );
+	assert( OBJECT_DATA_SOURCE::INSTANCE_BUFFER == object_material->GetPipeline()->GetObjectDataSource() );
+	_ref_material	= object_material;
+
+	// a mesh that failed to load still gets an object, drawn as a cube so it's easy to spot
+	if( nullptr == mesh ) {
+		std::cout << "No mesh for scene object, using a cube instead" << std::endl;
+		_gpu_mesh	= _ref_renderer->GetMeshRegistry()->AcquireShape( MESH_OBJECT_SHAPE::CUBE, object_material->GetPipeline()->GetVertexLayout() );
+	} else {
+		_gpu_mesh	= _ref_renderer->GetMeshRegistry()->AcquireMesh( std::move( mesh ), object_material->GetPipeline()->GetVertexLayout() );
+	}
+}
+
+SceneObject_InstancedObject::SceneObject_InstancedObject( Renderer * renderer, Surface * object_material, std::shared_ptr<GPUMesh> mesh )
+	: SceneObject( renderer )
+{
+	assert( nullptr != renderer );
+	assert( nullptr != object_material );
+	assert( nullptr != mesh );
+	assert( OBJECT_DATA_SOURCE::INSTANCE_BUFFER == object_material->GetPipeline()->GetObjectDataSource() );
+	assert( object_material->GetPipeline()->GetVertexLayout() == mesh->GetVertexLayout() );
+	_ref_material	= object_material;
+
+	_gpu_mesh		= std::move( mesh );
+}
+
+SceneObject_InstancedObject::~SceneObject_InstancedObject()
+{
+	_DeInitInstanceBuffer();
+}
+
+void SceneObject_InstancedObject::UpdateLogic()
+{
+}
+
+void SceneObject_InstancedObject::CmdRender( VkCommandBuffer command_buffer )
+{
+	// update vertex buffer, only if the mesh changed. Goes first as it can change the dequantization in the instance matrices
+	_gpu_mesh->UploadVertices();
+
+	// update and bind instance data, only written when the instances or the object itself moved
+	_UpdateInstanceBuffer();
+	if( 0 == _instance_count ) return;
+
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers( command_buffer, 1, 1, &_instance_buffer, &offset );
+
+	// update and bind material shader data
+	_ref_material->UpdateDescriptorSets();
+	_ref_material->CmdBindDescriptorSets( command_buffer );
+
+	// every instance in one draw per mesh range
+	_gpu_mesh->CmdDraw( command_buffer, _gpu_mesh->GetLODs()[ 0 ].draw_ranges, _instance_count );
+}
+
+void SceneObject_InstancedObject::SetSurface( Surface * material )
+{
+	// vertex buffer is already encoded for the old pipeline
+	assert( material->GetPipeline()->GetVertexLayout() == _gpu_mesh->GetVertexLayout() );
+	assert( OBJECT_DATA_SOURCE::INSTANCE_BUFFER == material->GetPipeline()->GetObjectDataSource() );
+	_ref_material			= material;
+}
+
+std::shared_ptr<GPUMesh> SceneObject_InstancedObject::GetGPUMesh()
+{
+	return _gpu_mesh;
+}
+
+void SceneObject_InstancedObject::MarkInstancesChanged()
+{
+	_instances_changed		= true;
+}
+
+void SceneObject_InstancedObject::_UpdateInstanceBuffer()
+{
+	// quantized positions are scaled back to object space here so shaders don't have to
+	auto & dq					= _gpu_mesh->GetVertexDequantization();
+	glm::mat4 base_matrix		= GetWorldMatrix();
+	glm::mat4 dequantization	= glm::translate( glm::mat4( 1.0f ), glm::vec3( dq.offset[ 0 ], dq.offset[ 1 ], dq.offset[ 2 ] ) )
+		* glm::scale( glm::mat4( 1.0f ), glm::vec3( dq.scale[ 0 ], dq.scale[ 1 ], dq.scale[ 2 ] ) );
+	if( !_instances_changed && base_matrix == _instance_base_matrix && dequantization == _instance_dequantization ) return;
+
+	// frames don't overlap, the GPU is done with the previous contents by the time we get here
+	_ReserveInstanceBuffer( instance_transforms.size() );
+	for( size_t i=0; i < instance_transforms.size(); ++i ) {
+		_instance_buffer_mapped[ i ]	= base_matrix * instance_transforms[ i ] * dequantization;
+	}
+	_instance_count				= uint32_t( instance_transforms.size() );
+	_instance_base_matrix		= base_matrix;
+	_instance_dequantization	= dequantization;
+	_instances_changed			= false;
+}
+
+void SceneObject_InstancedObject::_ReserveInstanceBuffer( size_t instance_count )
+{
+	if( instance_count <= _instance_capacity ) return;
+
+	size_t capacity				= std::max( _instance_capacity, SO_INSTANCE_BUFFER_MIN_CAPACITY );
+	while( capacity < instance_count ) capacity *= 2;
+	_DeInitInstanceBuffer();
+
+	// coherent so writes need no flushing
+	auto device					= _ref_renderer->GetVulkanDevice();
+	CreateBuffer( device, &_ref_renderer->GetVulkanPhysicalDeviceMemoryProperties(), capacity * sizeof( glm::mat4 ), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &_instance_buffer, &_instance_buffer_memory );
+	ErrorCheck( vkMapMemory( device, _instance_buffer_memory, 0, VK_WHOLE_SIZE, 0, (void**)&_instance_buffer_mapped ) );
+	_instance_capacity			= capacity;
+}
+
+void SceneObject_InstancedObject::_DeInitInstanceBuffer()
+{
+	if( VK_NULL_HANDLE == _instance_buffer ) return;
+
+	auto device					= _ref_renderer->GetVulkanDevice();
+	vkUnmapMemory( device, _instance_buffer_memory );
+	vkDestroyBuffer( device, _instance_buffer, nullptr );
+	vkFreeMemory( device, _instance_buffer_memory, nullptr );
+	_instance_buffer			= VK_NULL_HANDLE;
+	_instance_buffer_memory		= VK_NULL_HANDLE;
+	_instance_buffer_mapped		= nullptr;
+	_instance_capacity			= 0;
+	_instance_count				= 0;
+}
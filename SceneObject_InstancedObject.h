@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Platform.h"
+#include "SceneObject.h"
+#include "Mesh.h"
+#include "GPUMesh.h"
+
+#include <memory>
+#include <vector>
+
+class Renderer;
+class Surface;
+
+// instance buffer space is added in steps of this many instances
+constexpr size_t SO_INSTANCE_BUFFER_MIN_CAPACITY				= 256;
+
+// Many copies of one mesh drawn with one draw call per mesh range, eg. foliage or debris.
+// Every copy has a transformation of its own relative to the object's position, rotation and size,
+// shaders get them from an instance rate vertex buffer. The surface's pipeline has to use
+// OBJECT_DATA_SOURCE::INSTANCE_BUFFER.
+class SceneObject_InstancedObject : public SceneObject
+{
+public:
+	SceneObject_InstancedObject( Renderer * renderer, Surface * object_material, MESH_OBJECT_SHAPE default_shape );
+	SceneObject_InstancedObject( Renderer * renderer, Surface * object_material, std::unique_ptr<Mesh> mesh );	// a cube if mesh is nullptr
+	SceneObject_InstancedObject( Renderer * renderer, Surface * object_material, std::shared_ptr<GPUMesh> mesh );	// shares the mesh of another object
+	~SceneObject_InstancedObject();
+
+	void						UpdateLogic();
+	void						CmdRender( VkCommandBuffer command_buffer );
+
+	void						SetSurface( Surface * surface );
+	std::shared_ptr<GPUMesh>	GetGPUMesh();
+
+	// call after changing instance_transforms, the instance buffer is written again on the next draw
+	void						MarkInstancesChanged();
+
+	// one per instance, kept in one array so they can be copied to the GPU in one go
+	std::vector<glm::mat4>		instance_transforms;
+
+//private:
+	void						_UpdateInstanceBuffer();
+	void						_ReserveInstanceBuffer( size_t instance_count );
+	void						_DeInitInstanceBuffer();
+
+	Surface					*	_ref_material								= nullptr;
+
+	// shared with every other object drawing the same mesh, see MeshRegistry
+	std::shared_ptr<GPUMesh>	_gpu_mesh;
+
+	// host visible and mapped for as long as it exists, written only when something changed
+	VkBuffer					_instance_buffer							= VK_NULL_HANDLE;
+	VkDeviceMemory				_instance_buffer_memory						= VK_NULL_HANDLE;
+	glm::mat4				*	_instance_buffer_mapped						= nullptr;
+	size_t						_instance_capacity							= 0;
+	uint32_t					_instance_count								= 0;		// in the buffer
+
+	// instance buffer holds instance_transforms between these two
+	bool						_instances_changed							= true;
+	glm::mat4					_instance_base_matrix						= glm::mat4( 1.0f );		// object transformation
+	glm::mat4					_instance_dequantization					= glm::mat4( 1.0f );		// vertex dequantization of the mesh
+};
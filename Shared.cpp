@@ -94,3 +94,24 @@ uint32_t FindMemoryTypeIndex( const VkPhysicalDeviceMemoryProperties * gpu_memor
 	assert( 0 && "Couldn't find proper memory type." );
 	return UINT32_MAX;
 }
+
+void CreateBuffer( VkDevice device, const VkPhysicalDeviceMemoryProperties * gpu_memory_properties, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memory_properties, VkBuffer * buffer, VkDeviceMemory * memory )
+{
+	VkBufferCreateInfo buffer_create_info {};
+	buffer_create_info.sType				= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_create_info.flags				= 0;
+	buffer_create_info.size					= size;
+	buffer_create_info.usage				= usage;
+	buffer_create_info.sharingMode			= VK_SHARING_MODE_EXCLUSIVE;
+	ErrorCheck( vkCreateBuffer( device, &buffer_create_info, nullptr, buffer ) );
+
+	VkMemoryRequirements memory_requirements {};
+	vkGetBufferMemoryRequirements( device, *buffer, &memory_requirements );
+
+	VkMemoryAllocateInfo memory_allocate_info {};
+	memory_allocate_info.sType				= VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memory_allocate_info.allocationSize		= memory_requirements.size;
+	memory_allocate_info.memoryTypeIndex	= FindMemoryTypeIndex( gpu_memory_properties, &memory_requirements, memory_properties );
+	ErrorCheck( vkAllocateMemory( device, &memory_allocate_info, nullptr, memory ) );
+	ErrorCheck( vkBindBufferMemory( device, *buffer, *memory, 0 ) );
+}
@@ -19,3 +19,6 @@ Contributors:
 void ErrorCheck( VkResult result );
 
 uint32_t FindMemoryTypeIndex( const VkPhysicalDeviceMemoryProperties * gpu_memory_properties, const VkMemoryRequirements * memory_requirements, const VkMemoryPropertyFlags memory_properties );
+
+// buffer with its own memory allocation, bound and ready to use
+void CreateBuffer( VkDevice device, const VkPhysicalDeviceMemoryProperties * gpu_memory_properties, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memory_properties, VkBuffer * buffer, VkDeviceMemory * memory );
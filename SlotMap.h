@@ -0,0 +1,78 @@
+#pragma once
+
+#include <assert.h>
+#include <cstdint>
+#include <vector>
+
+// Refers to an item in a SlotMap. Handles of removed items are recognized by their generation
+// even after the slot has been reused, default constructed handles are never valid.
+struct SlotHandle
+{
+	uint32_t						index							= UINT32_MAX;
+	uint32_t						generation						= 0;
+};
+
+// Maps handles to wherever their item currently lives, eg. an index into densely packed arrays
+// that are kept compact by moving the last item into removed ones. Insert and Erase are O(1),
+// freed slots are reused before the slot array grows.
+template<typename Location>
+class SlotMap
+{
+public:
+	SlotHandle Insert( const Location & location )
+	{
+		uint32_t index;
+		if( !_free_slots.empty() ) {
+			index					= _free_slots.back();
+			_free_slots.pop_back();
+		} else {
+			index					= uint32_t( _slots.size() );
+			_slots.push_back( Slot() );
+		}
+		_slots[ index ].location	= location;
+		_slots[ index ].used		= true;
+
+		SlotHandle handle;
+		handle.index				= index;
+		handle.generation			= _slots[ index ].generation;
+		return handle;
+	}
+
+	void Erase( SlotHandle handle )
+	{
+		assert( IsValid( handle ) );
+		auto & slot					= _slots[ handle.index ];
+		slot.used					= false;
+		++slot.generation;
+		_free_slots.push_back( handle.index );
+	}
+
+	bool IsValid( SlotHandle handle ) const
+	{
+		return handle.index < _slots.size() && _slots[ handle.index ].used && _slots[ handle.index ].generation == handle.generation;
+	}
+
+	const Location & Get( SlotHandle handle ) const
+	{
+		assert( IsValid( handle ) );
+		return _slots[ handle.index ].location;
+	}
+
+	// when the item moves in its storage
+	void Set( SlotHandle handle, const Location & location )
+	{
+		assert( IsValid( handle ) );
+		_slots[ handle.index ].location	= location;
+	}
+
+private:
+	struct Slot
+	{
+		Location					location						= {};
+		uint32_t					generation						= 0;
+		bool						used							= false;
+	};
+
+	std::vector<Slot>				_slots;
+	std::vector<uint32_t>			_free_slots;
+};
@@ -23,16 +23,12 @@ uint32_t RoundToMultipleOf( uint32_t value, uint32_t multiple_of )
 	return ( ( value / multiple_of + !!( value % multiple_of ) ) * multiple_of );
 }
 
-Texture::Texture( Renderer * renderer, std::wstring path )
+bool LoadTextureData( std::wstring path, TextureData & data )
 {
-	_ref_renderer			= renderer;
-	_ref_vk_device			= _ref_renderer->GetVulkanDevice();
-
 	// load image on the cpu side, Also try OpenImageIO
 	auto fi_image			= FreeImage_LoadU( FreeImage_GetFileTypeU( path.c_str() ), path.c_str() );
 	if( nullptr == fi_image ) {
-		assert( 0 && "Couldn't load image." );
-		return;
+		return false;
 	}
 	if( FreeImage_GetBPP( fi_image ) != 32 ) {
 		auto fi_temp_image	= FreeImage_ConvertTo32Bits( fi_image );
@@ -40,15 +36,11 @@ Texture::Texture( Renderer * renderer, std::wstring path )
 		fi_image			= fi_temp_image;
 	}
 	FreeImage_FlipVertical( fi_image );
-	_image_format			= VK_FORMAT_B8G8R8A8_UNORM;
-	auto fi_image_type		= FreeImage_GetImageType( fi_image );
-	auto fi_color_type		= FreeImage_GetColorType( fi_image );
-	_size.width				= uint32_t( FreeImage_GetWidth( fi_image ) );
-	_size.height			= uint32_t( FreeImage_GetHeight( fi_image ) );
+	data.format				= VK_FORMAT_B8G8R8A8_UNORM;
+	data.size.width			= uint32_t( FreeImage_GetWidth( fi_image ) );
+	data.size.height		= uint32_t( FreeImage_GetHeight( fi_image ) );
 	auto fi_bpp				= uint32_t( FreeImage_GetBPP( fi_image ) );
 
-	auto fi_byte_size				= ( fi_bpp / 8 ) * _size.width * _size.height;
-
 	// generate mipmaps
 	std::vector<MipMap> mipmaps;
 	mipmaps.reserve( 16 );
@@ -56,8 +48,8 @@ Texture::Texture( Renderer * renderer, std::wstring path )
 		uint32_t current_offset	= 0;
 
 		MipMap last;
-		last.dimensions_size	= _size;
-		last.byte_size			= _size.width * _size.height * ( fi_bpp / 8 );
+		last.dimensions_size	= data.size;
+		last.byte_size			= data.size.width * data.size.height * ( fi_bpp / 8 );
 		last.image				= fi_image;
 		last.offset				= current_offset;
 		mipmaps.push_back( last );
@@ -79,16 +71,68 @@ Texture::Texture( Renderer * renderer, std::wstring path )
 			last		= current;
 		}
 	}
-	uint32_t request_buffer_size	= mipmaps.back().offset + mipmaps.back().byte_size;
-	/*
-	{
-		auto & m			= mipmaps[ 1 ];
-		auto save_image		= FreeImage_Allocate( m.dimensions_size.width, m.dimensions_size.height, fi_bpp );
-		std::memcpy( FreeImage_GetBits( save_image ), FreeImage_GetBits( m.image ), m.dimensions_size.width * m.dimensions_size.height * ( fi_bpp / 8 ) );
-		FreeImage_SaveU( FIF_DDS, save_image, ( path + L".test.dds" ).c_str() );
-		FreeImage_Unload( save_image );
+
+	// pack all levels into one block so uploading is a single memcpy into the staging buffer
+	data.pixels.resize( mipmaps.back().offset + mipmaps.back().byte_size );
+	data.mipmaps.clear();
+	data.mipmaps.reserve( mipmaps.size() );
+	for( auto & mip : mipmaps ) {
+		std::memcpy( &data.pixels[ mip.offset ], FreeImage_GetBits( mip.image ), mip.byte_size );
+		FreeImage_Unload( mip.image );
+		mip.image = nullptr;
+
+		TextureMipMap level;
+		level.dimensions_size	= mip.dimensions_size;
+		level.byte_size			= mip.byte_size;
+		level.offset			= mip.offset;
+		data.mipmaps.push_back( level );
 	}
-	*/
+	return true;
+}
+
+void MakeWhiteTextureData( TextureData & data )
+{
+	data.format				= VK_FORMAT_B8G8R8A8_UNORM;
+	data.size				= { 1, 1 };
+	data.pixels.assign( 4, 0xff );
+
+	TextureMipMap level;
+	level.dimensions_size	= data.size;
+	level.byte_size			= uint32_t( data.pixels.size() );
+	level.offset			= 0;
+	data.mipmaps.assign( 1, level );
+}
+
+Texture::Texture( Renderer * renderer, std::wstring path )
+{
+	_ref_renderer			= renderer;
+	_ref_vk_device			= _ref_renderer->GetVulkanDevice();
+
+	TextureData data;
+	if( !LoadTextureData( path, data ) ) {
+		assert( 0 && "Couldn't load image." );
+		return;
+	}
+	_InitImage( data );
+}
+
+Texture::Texture( Renderer * renderer, const TextureData & data )
+{
+	_ref_renderer			= renderer;
+	_ref_vk_device			= _ref_renderer->GetVulkanDevice();
+
+	_InitImage( data );
+}
+
+void Texture::_InitImage( const TextureData & data )
+{
+	assert( !data.mipmaps.empty() );
+	_image_format			= data.format;
+	_size					= data.size;
+	auto & mipmaps			= data.mipmaps;
+
+	uint32_t request_buffer_size	= uint32_t( data.pixels.size() );
+
 	VkBuffer		staging_buffer			= VK_NULL_HANDLE;
 	VkDeviceMemory	staging_buffer_memory	= VK_NULL_HANDLE;
 	{
@@ -111,19 +155,12 @@ Texture::Texture( Renderer * renderer, std::wstring path )
 		ErrorCheck( vkAllocateMemory( _ref_vk_device, &memory_allocate_info, nullptr, &staging_buffer_memory ) );
 		ErrorCheck( vkBindBufferMemory( _ref_vk_device, staging_buffer, staging_buffer_memory, 0 ) );
 		{
-			uint8_t * data = nullptr;
-			ErrorCheck( vkMapMemory( _ref_vk_device, staging_buffer_memory, 0, memory_requirements.size, 0, (void**)&data ) );
-			for( auto & mip : mipmaps ) {
-				uint32_t mip_byte_size = mip.dimensions_size.width * mip.dimensions_size.height * ( fi_bpp / 8 );
-				std::memcpy( &data[ mip.offset ], FreeImage_GetBits( mip.image ), mip_byte_size );
-			}
+			uint8_t * mapped = nullptr;
+			ErrorCheck( vkMapMemory( _ref_vk_device, staging_buffer_memory, 0, memory_requirements.size, 0, (void**)&mapped ) );
+			std::memcpy( mapped, data.pixels.data(), data.pixels.size() );
 			vkUnmapMemory( _ref_vk_device, staging_buffer_memory );
 		}
 	}
-	for( auto & mip : mipmaps ) {
-		FreeImage_Unload( mip.image );
-		mip.image = nullptr;
-	}
 
 	// Create on-device image
 	{
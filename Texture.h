@@ -2,12 +2,38 @@
 
 #include "Platform.h"
 
+#include <vector>
+
 class Renderer;
 
+struct TextureMipMap
+{
+	VkExtent2D					dimensions_size			= { 0, 0 };
+	uint32_t					byte_size				= 0;
+	uint32_t					offset					= 0;		// offset into TextureData::pixels
+};
+
+// CPU side image with all mip levels packed one after another, ready to be copied into a staging buffer
+struct TextureData
+{
+	VkExtent2D					size					= { 0, 0 };
+	VkFormat					format					= VK_FORMAT_UNDEFINED;
+	std::vector<TextureMipMap>	mipmaps;
+	std::vector<uint8_t>		pixels;
+};
+
+// Loads and decodes an image file and generates mipmaps, doesn't touch Vulkan so it can run on any thread.
+// returns false if the image couldn't be loaded
+bool LoadTextureData( std::wstring path, TextureData & data );
+
+// single opaque white pixel, stands in for images that couldn't be loaded
+void MakeWhiteTextureData( TextureData & data );
+
 class Texture
 {
 public:
 	Texture( Renderer * renderer, std::wstring path );
+	Texture( Renderer * renderer, const TextureData & data );		// uploads already decoded data, must be called on the render thread
 	~Texture();
 
 	VkImage						GetVulkanImage();
@@ -16,6 +42,8 @@ public:
 	VkFormat					GetFormat();
 
 private:
+	void						_InitImage( const TextureData & data );
+
 	Renderer				*	_ref_renderer			= nullptr;
 	VkDevice					_ref_vk_device			= VK_NULL_HANDLE;
 
@@ -0,0 +1,251 @@
+#include "TransformBatch.h"
+
+#include <assert.h>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define TRANSFORM_BATCH_SSE2	1
+#include <emmintrin.h>
+#else
+#define TRANSFORM_BATCH_SSE2	0
+#endif
+
+#if TRANSFORM_BATCH_SSE2 && defined( __AVX__ )
+#define TRANSFORM_BATCH_AVX		1
+#include <immintrin.h>
+#else
+#define TRANSFORM_BATCH_AVX		0
+#endif
+
+glm::mat4 Transform_CalculateMatrix( const glm::vec3 & position, const glm::quat & rotation, const glm::vec3 & size )
+{
+	glm::mat4 ret = glm::mat4( 1 );
+	ret = glm::translate( ret, position );
+	ret *= glm::mat4_cast( rotation );
+	ret = glm::scale( ret, size );
+	return ret;
+}
+
+size_t TransformBatch::GetCount() const
+{
+	return position[ 0 ].size();
+}
+
+void TransformBatch::Resize( size_t count )
+{
+	for( auto & p : position ) p.resize( count, 0.0f );
+	for( auto & s : size ) s.resize( count, 1.0f );
+	for( size_t c=0; c < 3; ++c ) rotation[ c ].resize( count, 0.0f );
+	rotation[ 3 ].resize( count, 1.0f );
+}
+
+void TransformBatch::Set( size_t index, const glm::vec3 & position, const glm::quat & rotation, const glm::vec3 & size )
+{
+	assert( index < GetCount() );
+	for( int c=0; c < 3; ++c ) {
+		this->position[ c ][ index ]	= position[ c ];
+		this->size[ c ][ index ]		= size[ c ];
+	}
+	this->rotation[ 0 ][ index ]		= rotation.x;
+	this->rotation[ 1 ][ index ]		= rotation.y;
+	this->rotation[ 2 ][ index ]		= rotation.z;
+	this->rotation[ 3 ][ index ]		= rotation.w;
+}
+
+void TransformBatch::Remove( size_t index )
+{
+	assert( index < GetCount() );
+	for( auto & p : position ) {
+		p[ index ]	= p.back();
+		p.pop_back();
+	}
+	for( auto & s : size ) {
+		s[ index ]	= s.back();
+		s.pop_back();
+	}
+	for( auto & r : rotation ) {
+		r[ index ]	= r.back();
+		r.pop_back();
+	}
+}
+
+// One float per object, the kernel is written once against these and runs at every width.
+// StoreMatrices gets the 16 column major matrix elements, each holding WIDTH objects.
+struct TransformLanes1
+{
+	static constexpr size_t			WIDTH			= 1;
+	float							v;
+
+	static TransformLanes1			Load( const float * src )	{ return { *src }; }
+	static TransformLanes1			Splat( float value )		{ return { value }; }
+
+	static void StoreMatrices( const TransformLanes1 elements[ 16 ], uint8_t * dst, size_t dst_stride )
+	{
+		float * matrix = reinterpret_cast<float*>( dst );
+		for( size_t e=0; e < 16; ++e ) {
+			matrix[ e ]	= elements[ e ].v;
+		}
+	}
+};
+inline TransformLanes1 operator+( TransformLanes1 a, TransformLanes1 b ) { return { a.v + b.v }; }
+inline TransformLanes1 operator-( TransformLanes1 a, TransformLanes1 b ) { return { a.v - b.v }; }
+inline TransformLanes1 operator*( TransformLanes1 a, TransformLanes1 b ) { return { a.v * b.v }; }
+
+#if TRANSFORM_BATCH_SSE2
+
+struct TransformLanes4
+{
+	static constexpr size_t			WIDTH			= 4;
+	__m128							v;
+
+	static TransformLanes4			Load( const float * src )	{ return { _mm_loadu_ps( src ) }; }
+	static TransformLanes4			Splat( float value )		{ return { _mm_set1_ps( value ) }; }
+
+	static void StoreMatrices( const TransformLanes4 elements[ 16 ], uint8_t * dst, size_t dst_stride )
+	{
+		for( size_t c=0; c < 4; ++c ) {
+			// rows of one column for 4 objects become that column for each object
+			__m128 r0	= elements[ c * 4 + 0 ].v;
+			__m128 r1	= elements[ c * 4 + 1 ].v;
+			__m128 r2	= elements[ c * 4 + 2 ].v;
+			__m128 r3	= elements[ c * 4 + 3 ].v;
+			_MM_TRANSPOSE4_PS( r0, r1, r2, r3 );
+			_mm_storeu_ps( reinterpret_cast<float*>( dst + 0 * dst_stride ) + c * 4, r0 );
+			_mm_storeu_ps( reinterpret_cast<float*>( dst + 1 * dst_stride ) + c * 4, r1 );
+			_mm_storeu_ps( reinterpret_cast<float*>( dst + 2 * dst_stride ) + c * 4, r2 );
+			_mm_storeu_ps( reinterpret_cast<float*>( dst + 3 * dst_stride ) + c * 4, r3 );
+		}
+	}
+};
+inline TransformLanes4 operator+( TransformLanes4 a, TransformLanes4 b ) { return { _mm_add_ps( a.v, b.v ) }; }
+inline TransformLanes4 operator-( TransformLanes4 a, TransformLanes4 b ) { return { _mm_sub_ps( a.v, b.v ) }; }
+inline TransformLanes4 operator*( TransformLanes4 a, TransformLanes4 b ) { return { _mm_mul_ps( a.v, b.v ) }; }
+
+#endif // TRANSFORM_BATCH_SSE2
+
+#if TRANSFORM_BATCH_AVX
+
+struct TransformLanes8
+{
+	static constexpr size_t			WIDTH			= 8;
+	__m256							v;
+
+	static TransformLanes8			Load( const float * src )	{ return { _mm256_loadu_ps( src ) }; }
+	static TransformLanes8			Splat( float value )		{ return { _mm256_set1_ps( value ) }; }
+
+	// each half goes through the 4 wide transpose, there's no cheaper 8x4 one
+	static void StoreMatrices( const TransformLanes8 elements[ 16 ], uint8_t * dst, size_t dst_stride )
+	{
+		TransformLanes4 low[ 16 ];
+		TransformLanes4 high[ 16 ];
+		for( size_t e=0; e < 16; ++e ) {
+			low[ e ].v	= _mm256_castps256_ps128( elements[ e ].v );
+			high[ e ].v	= _mm256_extractf128_ps( elements[ e ].v, 1 );
+		}
+		TransformLanes4::StoreMatrices( low, dst, dst_stride );
+		TransformLanes4::StoreMatrices( high, dst + 4 * dst_stride, dst_stride );
+	}
+};
+inline TransformLanes8 operator+( TransformLanes8 a, TransformLanes8 b ) { return { _mm256_add_ps( a.v, b.v ) }; }
+inline TransformLanes8 operator-( TransformLanes8 a, TransformLanes8 b ) { return { _mm256_sub_ps( a.v, b.v ) }; }
+inline TransformLanes8 operator*( TransformLanes8 a, TransformLanes8 b ) { return { _mm256_mul_ps( a.v, b.v ) }; }
+
+#endif // TRANSFORM_BATCH_AVX
+
+// Calculates as many whole batches of Lanes::WIDTH objects as fit in [ begin, end ) and returns where it stopped.
+// Same operations in the same order as glm's translate, mat4_cast and scale, so results match Transform_CalculateMatrix.
+template<typename Lanes>
+size_t TransformBatch_CalculateMatricesRange( const TransformBatch & transforms, size_t begin, size_t end,
+	const glm::mat4 * pre_transform, uint8_t * dst, size_t dst_stride )
+{
+	Lanes pre[ 16 ];
+	if( nullptr != pre_transform ) {
+		for( int c=0; c < 4; ++c ) {
+			for( int r=0; r < 4; ++r ) {
+				pre[ c * 4 + r ]	= Lanes::Splat( ( *pre_transform )[ c ][ r ] );
+			}
+		}
+	}
+	const Lanes zero	= Lanes::Splat( 0.0f );
+	const Lanes one		= Lanes::Splat( 1.0f );
+	const Lanes two		= Lanes::Splat( 2.0f );
+
+	size_t i = begin;
+	for( ; i + Lanes::WIDTH <= end; i += Lanes::WIDTH ) {
+		Lanes x		= Lanes::Load( transforms.rotation[ 0 ].data() + i );
+		Lanes y		= Lanes::Load( transforms.rotation[ 1 ].data() + i );
+		Lanes z		= Lanes::Load( transforms.rotation[ 2 ].data() + i );
+		Lanes w		= Lanes::Load( transforms.rotation[ 3 ].data() + i );
+		Lanes sx	= Lanes::Load( transforms.size[ 0 ].data() + i );
+		Lanes sy	= Lanes::Load( transforms.size[ 1 ].data() + i );
+		Lanes sz	= Lanes::Load( transforms.size[ 2 ].data() + i );
+
+		Lanes xx	= x * x;
+		Lanes yy	= y * y;
+		Lanes zz	= z * z;
+		Lanes xz	= x * z;
+		Lanes xy	= x * y;
+		Lanes yz	= y * z;
+		Lanes wx	= w * x;
+		Lanes wy	= w * y;
+		Lanes wz	= w * z;
+
+		Lanes m[ 16 ];
+		m[ 0 ]		= ( one - two * ( yy + zz ) ) * sx;
+		m[ 1 ]		= two * ( xy + wz ) * sx;
+		m[ 2 ]		= two * ( xz - wy ) * sx;
+		m[ 3 ]		= zero;
+		m[ 4 ]		= two * ( xy - wz ) * sy;
+		m[ 5 ]		= ( one - two * ( xx + zz ) ) * sy;
+		m[ 6 ]		= two * ( yz + wx ) * sy;
+		m[ 7 ]		= zero;
+		m[ 8 ]		= two * ( xz + wy ) * sz;
+		m[ 9 ]		= two * ( yz - wx ) * sz;
+		m[ 10 ]		= ( one - two * ( xx + yy ) ) * sz;
+		m[ 11 ]		= zero;
+		m[ 12 ]		= Lanes::Load( transforms.position[ 0 ].data() + i );
+		m[ 13 ]		= Lanes::Load( transforms.position[ 1 ].data() + i );
+		m[ 14 ]		= Lanes::Load( transforms.position[ 2 ].data() + i );
+		m[ 15 ]		= one;
+
+		if( nullptr != pre_transform ) {
+			Lanes result[ 16 ];
+			for( int c=0; c < 4; ++c ) {
+				for( int r=0; r < 4; ++r ) {
+					result[ c * 4 + r ]	= pre[ 0 * 4 + r ] * m[ c * 4 + 0 ] + pre[ 1 * 4 + r ] * m[ c * 4 + 1 ]
+						+ pre[ 2 * 4 + r ] * m[ c * 4 + 2 ] + pre[ 3 * 4 + r ] * m[ c * 4 + 3 ];
+				}
+			}
+			Lanes::StoreMatrices( result, dst + ( i - begin ) * dst_stride, dst_stride );
+		} else {
+			Lanes::StoreMatrices( m, dst + ( i - begin ) * dst_stride, dst_stride );
+		}
+	}
+	return i;
+}
+
+void TransformBatch_CalculateMatrices( const TransformBatch & transforms, size_t begin, size_t end,
+	const glm::mat4 * pre_transform, void * dst, size_t dst_stride )
+{
+	assert( end <= transforms.GetCount() );
+	assert( dst_stride >= sizeof( glm::mat4 ) );
+	uint8_t * out	= static_cast<uint8_t*>( dst );
+	size_t i		= begin;
+#if TRANSFORM_BATCH_AVX
+	i = TransformBatch_CalculateMatricesRange<TransformLanes8>( transforms, i, end, pre_transform, out + ( i - begin ) * dst_stride, dst_stride );
+#endif
+#if TRANSFORM_BATCH_SSE2
+	i = TransformBatch_CalculateMatricesRange<TransformLanes4>( transforms, i, end, pre_transform, out + ( i - begin ) * dst_stride, dst_stride );
+#endif
+	TransformBatch_CalculateMatricesRange<TransformLanes1>( transforms, i, end, pre_transform, out + ( i - begin ) * dst_stride, dst_stride );
+}
+
+const char * TransformBatch_GetKernelName()
+{
+#if TRANSFORM_BATCH_AVX
+	return "AVX";
+#elif TRANSFORM_BATCH_SSE2
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
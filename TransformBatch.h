@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Platform.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Matrix of one object the way SceneObject builds it: translation * rotation * scale.
+glm::mat4 Transform_CalculateMatrix( const glm::vec3 & position, const glm::quat & rotation, const glm::vec3 & size );
+
+// Positions, sizes and rotations of many objects as structure of arrays, so the batch
+// kernel can load the same component of 4 or 8 objects with one instruction.
+struct TransformBatch
+{
+	std::vector<float>				position[ 3 ];
+	std::vector<float>				size[ 3 ];
+	std::vector<float>				rotation[ 4 ];					// x, y, z, w
+
+	size_t							GetCount() const;
+	void							Resize( size_t count );
+	void							Set( size_t index, const glm::vec3 & position, const glm::quat & rotation, const glm::vec3 & size );
+	// moves the last transform into index, the rest keep their places
+	void							Remove( size_t index );
+};
+
+// Writes the matrices of transforms [ begin, end ) to dst, one every dst_stride bytes, eg. straight into
+// mapped uniform buffers spaced by their offset alignment. When pre_transform is given every matrix is
+// multiplied by it from the left, eg. with a view projection matrix or the world matrix of a shared parent.
+// Runs 8 objects at a time with AVX, 4 with SSE2 and the rest one at a time, same results as Transform_CalculateMatrix.
+void TransformBatch_CalculateMatrices( const TransformBatch & transforms, size_t begin, size_t end,
+	const glm::mat4 * pre_transform, void * dst, size_t dst_stride );
+
+// "AVX", "SSE2" or "scalar", the widest kernel this build runs
+const char * TransformBatch_GetKernelName();
@@ -0,0 +1,161 @@
+#include "TransformBenchmark.h"
+
+#include "TransformBatch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <random>
+#include <vector>
+
+constexpr size_t TRANSFORM_BENCHMARK_SIZES[]				= { 1000, 10000, 100000 };
+// every size runs at least this many times and until this many objects went through, for stable timings
+constexpr uint32_t TRANSFORM_BENCHMARK_MIN_ITERATIONS		= 10;
+constexpr size_t TRANSFORM_BENCHMARK_MIN_OBJECTS			= 10000000;
+// minUniformBufferOffsetAlignment is at most this on common GPUs, uniform ring elements are spaced by it
+constexpr size_t TRANSFORM_BENCHMARK_STRIDE				= 256;
+// largest difference allowed between the two paths, only the model view projection product may round differently
+constexpr float TRANSFORM_BENCHMARK_TOLERANCE				= 1e-4f;
+
+// Stand in for the per object path, allocated one at a time and reached through a list of
+// base pointers like Scene keeps them, the matrix comes through a virtual call.
+class TransformBenchmarkObjectBase
+{
+public:
+	virtual ~TransformBenchmarkObjectBase() {}
+	virtual glm::mat4				CalculateModelMatrix() const = 0;
+};
+
+class TransformBenchmarkObject : public TransformBenchmarkObjectBase
+{
+public:
+	glm::mat4 CalculateModelMatrix() const
+	{
+		return Transform_CalculateMatrix( position, rotation, size );
+	}
+
+	glm::vec3						position;
+	glm::vec3						size;
+	glm::quat						rotation;
+};
+
+struct TransformBenchmarkScene
+{
+	std::list<std::unique_ptr<TransformBenchmarkObjectBase>>	objects;
+	TransformBatch												batch;
+};
+
+void TransformBenchmark_Generate( TransformBenchmarkScene & scene, size_t object_count )
+{
+	std::mt19937 generator( static_cast<uint32_t>( object_count ) );
+	std::uniform_real_distribution<float> position( -100.0f, 100.0f );
+	std::uniform_real_distribution<float> size( 0.1f, 10.0f );
+	std::uniform_real_distribution<float> angle( -3.14159265f, 3.14159265f );
+
+	scene.batch.Resize( object_count );
+	for( size_t i=0; i < object_count; ++i ) {
+		std::unique_ptr<TransformBenchmarkObject> object( new TransformBenchmarkObject );
+		object->position	= glm::vec3( position( generator ), position( generator ), position( generator ) );
+		object->size		= glm::vec3( size( generator ), size( generator ), size( generator ) );
+		object->rotation	= glm::quat( glm::vec3( angle( generator ), angle( generator ), angle( generator ) ) );
+		scene.batch.Set( i, object->position, object->rotation, object->size );
+		scene.objects.push_back( std::move( object ) );
+	}
+}
+
+// returns wall clock time of all iterations in milliseconds
+double TransformBenchmark_MeasurePerObject( const TransformBenchmarkScene & scene, const glm::mat4 * view_projection, uint32_t iterations, uint8_t * dst )
+{
+	namespace chrono	= std::chrono;
+	auto start_time		= chrono::steady_clock::now();
+	for( uint32_t i=0; i < iterations; ++i ) {
+		uint8_t * out	= dst;
+		for( auto & o : scene.objects ) {
+			glm::mat4 matrix	= o->CalculateModelMatrix();
+			if( nullptr != view_projection ) matrix = *view_projection * matrix;
+			std::memcpy( out, &matrix, sizeof( matrix ) );
+			out			+= TRANSFORM_BENCHMARK_STRIDE;
+		}
+	}
+	return chrono::duration<double, std::milli>( chrono::steady_clock::now() - start_time ).count();
+}
+
+double TransformBenchmark_MeasureBatch( const TransformBenchmarkScene & scene, const glm::mat4 * view_projection, uint32_t iterations, uint8_t * dst )
+{
+	namespace chrono	= std::chrono;
+	auto start_time		= chrono::steady_clock::now();
+	for( uint32_t i=0; i < iterations; ++i ) {
+		TransformBatch_CalculateMatrices( scene.batch, 0, scene.batch.GetCount(), view_projection, dst, TRANSFORM_BENCHMARK_STRIDE );
+	}
+	return chrono::duration<double, std::milli>( chrono::steady_clock::now() - start_time ).count();
+}
+
+bool TransformBenchmark_Compare( const std::vector<uint8_t> & a, const std::vector<uint8_t> & b, size_t object_count )
+{
+	for( size_t i=0; i < object_count; ++i ) {
+		glm::mat4 ma, mb;
+		std::memcpy( &ma, a.data() + i * TRANSFORM_BENCHMARK_STRIDE, sizeof( ma ) );
+		std::memcpy( &mb, b.data() + i * TRANSFORM_BENCHMARK_STRIDE, sizeof( mb ) );
+		for( int c=0; c < 4; ++c ) {
+			for( int r=0; r < 4; ++r ) {
+				float scale	= std::max( 1.0f, std::abs( ma[ c ][ r ] ) );
+				if( std::abs( ma[ c ][ r ] - mb[ c ][ r ] ) > TRANSFORM_BENCHMARK_TOLERANCE * scale ) return false;
+			}
+		}
+	}
+	return true;
+}
+
+void TransformBenchmark_Report( std::ostream & report, const char * path, size_t object_count, const char * matrices, uint32_t iterations, double milliseconds, double per_object_milliseconds )
+{
+	report << path << ","
+		<< object_count << ","
+		<< matrices << ","
+		<< iterations << ","
+		<< milliseconds << ","
+		<< milliseconds * 1000000.0 / ( double( object_count ) * iterations ) << ","
+		<< per_object_milliseconds / std::max( milliseconds, 0.000001 ) << std::endl;
+}
+
+int RunTransformBenchmark( std::ostream & report )
+{
+	int failures = 0;
+
+	// something like a camera a bit back from the origin, only the cost matters
+	glm::mat4 view_projection	= glm::perspective( glm::radians( 60.0f ), 16.0f / 9.0f, 0.01f, 1000.0f )
+		* glm::translate( glm::mat4( 1.0f ), glm::vec3( 0.0f, 0.0f, 200.0f ) );
+
+	report << "# batch kernel: " << TransformBatch_GetKernelName() << ", destination stride " << TRANSFORM_BENCHMARK_STRIDE << " bytes" << std::endl;
+	report << "path,objects,matrices,iterations,milliseconds,nanoseconds_per_object,speedup" << std::endl;
+	for( auto object_count : TRANSFORM_BENCHMARK_SIZES ) {
+		TransformBenchmarkScene scene;
+		TransformBenchmark_Generate( scene, object_count );
+		uint32_t iterations		= uint32_t( std::max<size_t>( TRANSFORM_BENCHMARK_MIN_ITERATIONS, TRANSFORM_BENCHMARK_MIN_OBJECTS / object_count ) );
+
+		std::vector<uint8_t> per_object_dst( object_count * TRANSFORM_BENCHMARK_STRIDE );
+		std::vector<uint8_t> batch_dst( object_count * TRANSFORM_BENCHMARK_STRIDE );
+		bool matches			= true;
+		for( auto mvp : { false, true } ) {
+			const glm::mat4 * pre_transform	= mvp ? &view_projection : nullptr;
+			const char * matrices			= mvp ? "model_view_projection" : "model";
+
+			// first runs touch every destination page and check the results, they're not timed
+			TransformBenchmark_MeasurePerObject( scene, pre_transform, 1, per_object_dst.data() );
+			TransformBenchmark_MeasureBatch( scene, pre_transform, 1, batch_dst.data() );
+			matches					= matches && TransformBenchmark_Compare( per_object_dst, batch_dst, object_count );
+
+			double per_object		= TransformBenchmark_MeasurePerObject( scene, pre_transform, iterations, per_object_dst.data() );
+			double batch			= TransformBenchmark_MeasureBatch( scene, pre_transform, iterations, batch_dst.data() );
+			TransformBenchmark_Report( report, "per_object", object_count, matrices, iterations, per_object, per_object );
+			TransformBenchmark_Report( report, "batch", object_count, matrices, iterations, batch, per_object );
+		}
+		if( !matches ) {
+			report << "# batch matrices of " << object_count << " objects don't match the per object ones" << std::endl;
+			++failures;
+		}
+	}
+	return failures;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <ostream>
+
+// Measures model and model view projection matrix calculation for 1K, 10K and 100K objects,
+// once per object through a virtual call like scene objects do and once with the
+// TransformBatch kernel. Both write into a buffer spaced like uniform ring elements.
+//
+// Results are written to report as CSV, one row per measurement:
+// path,objects,matrices,iterations,milliseconds,nanoseconds_per_object,speedup
+// speedup is relative to the per object path. Lines starting with # are comments.
+// Returns the number of sizes whose batch results didn't match the per object ones, 0 on success.
+int RunTransformBenchmark( std::ostream & report );
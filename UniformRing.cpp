@@ -0,0 +1,97 @@
+#include "UniformRing.h"
+
+#include "Shared.h"
+
+#include <algorithm>
+
+UniformRing::UniformRing( Renderer * renderer, DESCRIPTOR_SET_TYPE descriptor_set_type, VkDeviceSize element_size, uint32_t elements_per_chunk, uint32_t frame_count )
+{
+	assert( nullptr != renderer );
+	assert( element_size > 0 );
+	assert( elements_per_chunk > 0 );
+	assert( frame_count > 0 );
+	_ref_renderer			= renderer;
+	_descriptor_set_type	= descriptor_set_type;
+	_element_size			= element_size;
+	_elements_per_chunk		= elements_per_chunk;
+
+	VkDeviceSize alignment	= std::max<VkDeviceSize>( _ref_renderer->GetVulkanPhysicalDeviceProperties().limits.minUniformBufferOffsetAlignment, 1 );
+	_element_stride			= ( element_size + alignment - 1 ) / alignment * alignment;
+
+	_frames.resize( frame_count );
+	for( auto & chunks : _frames ) {
+		_AddChunk( chunks );
+	}
+}
+
+UniformRing::~UniformRing()
+{
+	auto device = _ref_renderer->GetVulkanDevice();
+	for( auto & chunks : _frames ) {
+		for( auto & chunk : chunks ) {
+			_ref_renderer->FreeDescriptorSet( chunk.descriptor_set );
+			vkUnmapMemory( device, chunk.memory );
+			vkDestroyBuffer( device, chunk.buffer, nullptr );
+			vkFreeMemory( device, chunk.memory, nullptr );
+		}
+	}
+}
+
+void UniformRing::BeginFrame()
+{
+	_frame		= ( _frame + 1 ) % uint32_t( _frames.size() );
+	_chunk		= 0;
+	_element	= 0;
+}
+
+UniformRingAllocation UniformRing::Allocate()
+{
+	auto & chunks = _frames[ _frame ];
+	if( _element == _elements_per_chunk ) {
+		// chunks stay with the frame, later frames with as many elements don't allocate anything
+		++_chunk;
+		_element	= 0;
+		if( _chunk == chunks.size() ) _AddChunk( chunks );
+	}
+
+	auto & chunk = chunks[ _chunk ];
+	UniformRingAllocation allocation;
+	allocation.descriptor_set	= chunk.descriptor_set;
+	allocation.dynamic_offset	= uint32_t( _element * _element_stride );
+	allocation.data				= chunk.mapped + allocation.dynamic_offset;
+	++_element;
+	return allocation;
+}
+
+void UniformRing::_AddChunk( std::vector<Chunk> & chunks )
+{
+	auto device = _ref_renderer->GetVulkanDevice();
+
+	// coherent so writes need no flushing, mapped for as long as the chunk lives
+	Chunk chunk;
+	VkDeviceSize size = _element_stride * _elements_per_chunk;
+	CreateBuffer( device, &_ref_renderer->GetVulkanPhysicalDeviceMemoryProperties(), size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &chunk.buffer, &chunk.memory );
+	ErrorCheck( vkMapMemory( device, chunk.memory, 0, VK_WHOLE_SIZE, 0, (void**)&chunk.mapped ) );
+
+	chunk.descriptor_set = _ref_renderer->AllocateDescriptorSet( _descriptor_set_type );
+
+	VkDescriptorBufferInfo write_buffer_info {};
+	write_buffer_info.buffer			= chunk.buffer;
+	write_buffer_info.offset			= 0;
+	write_buffer_info.range				= _element_size;
+
+	VkWriteDescriptorSet write_set {};
+	write_set.sType						= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write_set.dstSet					= chunk.descriptor_set;
+	write_set.dstBinding				= 0;
+	write_set.dstArrayElement			= 0;
+	write_set.descriptorCount			= 1;
+	write_set.descriptorType			= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	write_set.pImageInfo				= nullptr;
+	write_set.pBufferInfo				= &write_buffer_info;
+	write_set.pTexelBufferView			= nullptr;
+	vkUpdateDescriptorSets( device, 1, &write_set, 0, nullptr );
+
+	chunks.push_back( chunk );
+}
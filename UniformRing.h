@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Platform.h"
+#include "Renderer.h"
+
+#include <vector>
+
+// per frame space, more chunks are added when a frame needs more
+constexpr uint32_t UNIFORM_RING_ELEMENTS_PER_CHUNK				= 1024;
+// frames whose uniforms may still be read by the GPU
+constexpr uint32_t UNIFORM_RING_FRAME_COUNT						= 2;
+
+// Where one element landed, bind descriptor_set with dynamic_offset and write to data until the frame is submitted.
+struct UniformRingAllocation
+{
+	VkDescriptorSet					descriptor_set					= VK_NULL_HANDLE;
+	uint32_t						dynamic_offset					= 0;
+	void						*	data							= nullptr;
+};
+
+// Persistently mapped uniform buffers handing out space for one element at a time, eg. one object's
+// transformation every draw. Elements are addressed with dynamic offsets so every element in a chunk shares
+// one descriptor set and one allocation. Every frame uses its own chunks so the CPU never writes what the
+// GPU may still be reading from an earlier frame in flight.
+class UniformRing
+{
+public:
+	UniformRing( Renderer * renderer, DESCRIPTOR_SET_TYPE descriptor_set_type, VkDeviceSize element_size,
+		uint32_t elements_per_chunk = UNIFORM_RING_ELEMENTS_PER_CHUNK, uint32_t frame_count = UNIFORM_RING_FRAME_COUNT );
+	~UniformRing();
+
+	// moves to the next frame's chunks, call once per frame after the GPU is done with that frame
+	void							BeginFrame();
+	UniformRingAllocation			Allocate();
+
+private:
+	struct Chunk
+	{
+		VkBuffer					buffer							= VK_NULL_HANDLE;
+		VkDeviceMemory				memory							= VK_NULL_HANDLE;
+		VkDescriptorSet				descriptor_set					= VK_NULL_HANDLE;
+		uint8_t					*	mapped							= nullptr;
+	};
+
+	void							_AddChunk( std::vector<Chunk> & chunks );
+
+	Renderer					*	_ref_renderer					= nullptr;
+	DESCRIPTOR_SET_TYPE				_descriptor_set_type			= DESCRIPTOR_SET_TYPE::SCENE_OBJECT;
+	VkDeviceSize					_element_size					= 0;
+	VkDeviceSize					_element_stride					= 0;		// element size rounded up to the offset alignment of the GPU
+	uint32_t						_elements_per_chunk				= 0;
+
+	std::vector<std::vector<Chunk>>	_frames;
+	uint32_t						_frame							= 0;
+	size_t							_chunk							= 0;		// in use in the current frame
+	uint32_t						_element						= 0;		// next free one in that chunk
+};
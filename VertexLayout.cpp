@@ -0,0 +1,268 @@
+#include "VertexLayout.h"
+
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <assert.h>
+
+constexpr float VERTEX_LAYOUT_SNORM16_MAX				= 32767.0f;
+constexpr float VERTEX_LAYOUT_SNORM16_LIMIT				= 1.0f + 0.5f / VERTEX_LAYOUT_SNORM16_MAX;	// rounding of the box itself still fits
+
+int16_t VertexLayout_FloatToSnorm16( float value )
+{
+	return int16_t( std::round( std::min( std::max( value, -1.0f ), 1.0f ) * VERTEX_LAYOUT_SNORM16_MAX ) );
+}
+
+uint16_t VertexLayout_UVToUnorm16( float value )
+{
+	// undoes ME3D_ShortToFloat, the shader's scale maps 65535 back to VERTEX_LAYOUT_UV_SCALE
+	return uint16_t( std::round( std::min( std::max( value * VERTEX_LAYOUT_SNORM16_MAX, 0.0f ), 65535.0f ) ) );
+}
+
+uint16_t VertexLayout_FloatToHalf( float value )
+{
+	uint32_t bits = 0;
+	std::memcpy( &bits, &value, sizeof( bits ) );
+
+	uint32_t sign		= ( bits >> 16 ) & 0x8000;
+	int32_t exponent	= int32_t( ( bits >> 23 ) & 0xff ) - 127 + 15;
+	uint32_t mantissa	= bits & 0x007fffff;
+
+	if( ( ( bits >> 23 ) & 0xff ) == 0xff ) {
+		// infinity stays infinity, nan stays nan
+		return uint16_t( sign | 0x7c00 | ( mantissa ? 0x0200 : 0 ) );
+	}
+	if( exponent >= 0x1f ) {
+		return uint16_t( sign | 0x7c00 );
+	}
+	if( exponent <= 0 ) {
+		// subnormal or zero
+		if( exponent < -10 ) return uint16_t( sign );
+		mantissa		|= 0x00800000;
+		uint32_t shift	= uint32_t( 14 - exponent );
+		uint32_t half	= mantissa >> shift;
+		uint32_t rest	= mantissa & ( ( 1u << shift ) - 1 );
+		uint32_t middle	= 1u << ( shift - 1 );
+		if( rest > middle || ( rest == middle && ( half & 1 ) ) ) ++half;
+		return uint16_t( sign | half );
+	}
+
+	// round to nearest even, a carry out of the mantissa correctly bumps the exponent
+	uint32_t half		= sign | ( uint32_t( exponent ) << 10 ) | ( mantissa >> 13 );
+	uint32_t rest		= mantissa & 0x1fff;
+	if( rest > 0x1000 || ( rest == 0x1000 && ( half & 1 ) ) ) ++half;
+	return uint16_t( half );
+}
+
+float VertexLayout_HalfToFloat( uint16_t value )
+{
+	uint32_t sign		= uint32_t( value & 0x8000 ) << 16;
+	uint32_t exponent	= ( value >> 10 ) & 0x1f;
+	uint32_t mantissa	= value & 0x03ff;
+
+	uint32_t bits;
+	if( 0x1f == exponent ) {
+		bits			= sign | 0x7f800000 | ( mantissa << 13 );
+	} else if( 0 != exponent ) {
+		bits			= sign | ( ( exponent + 127 - 15 ) << 23 ) | ( mantissa << 13 );
+	} else if( 0 != mantissa ) {
+		// subnormal, normalize it for the float
+		exponent		= 127 - 15 + 1;
+		while( 0 == ( mantissa & 0x0400 ) ) {
+			mantissa	<<= 1;
+			--exponent;
+		}
+		bits			= sign | ( exponent << 23 ) | ( ( mantissa & 0x03ff ) << 13 );
+	} else {
+		bits			= sign;
+	}
+	float result;
+	std::memcpy( &result, &bits, sizeof( result ) );
+	return result;
+}
+
+size_t VertexLayout_GetStride( VERTEX_LAYOUT layout )
+{
+	switch( layout ) {
+	case VERTEX_LAYOUT::FLOAT32:
+		return sizeof( Vertex );
+	case VERTEX_LAYOUT::COMPACT_HALF:
+		return sizeof( VertexCompactHalf );
+	case VERTEX_LAYOUT::COMPACT_SNORM16:
+		return sizeof( VertexCompactSnorm16 );
+	default:
+		assert( 0 && "Unknown vertex layout." );
+		return 0;
+	}
+}
+
+const char * VertexLayout_GetName( VERTEX_LAYOUT layout )
+{
+	switch( layout ) {
+	case VERTEX_LAYOUT::FLOAT32:
+		return "float32";
+	case VERTEX_LAYOUT::COMPACT_HALF:
+		return "compact_half";
+	case VERTEX_LAYOUT::COMPACT_SNORM16:
+		return "compact_snorm16";
+	default:
+		assert( 0 && "Unknown vertex layout." );
+		return "";
+	}
+}
+
+bool VertexLayout_FromName( const std::string & name, VERTEX_LAYOUT * layout )
+{
+	for( auto l : { VERTEX_LAYOUT::FLOAT32, VERTEX_LAYOUT::COMPACT_HALF, VERTEX_LAYOUT::COMPACT_SNORM16 } ) {
+		if( name != VertexLayout_GetName( l ) ) continue;
+		*layout = l;
+		return true;
+	}
+	return false;
+}
+
+void VertexLayout_Encode( VERTEX_LAYOUT layout, const std::vector<Vertex> & vertices, std::vector<uint8_t> & dst, VertexDequantization * dequantization )
+{
+	assert( nullptr != dequantization );
+	*dequantization		= VertexDequantization();
+	dst.resize( vertices.size() * VertexLayout_GetStride( layout ) );
+	if( vertices.empty() ) return;
+
+	if( VERTEX_LAYOUT::COMPACT_SNORM16 == layout ) {
+		// positions are stored relative to the center of the bounding box, -1 to 1 covers the box
+		float min_position[ 3 ];
+		float max_position[ 3 ];
+		for( size_t c=0; c < 3; ++c ) {
+			min_position[ c ]		= vertices[ 0 ].position[ c ];
+			max_position[ c ]		= vertices[ 0 ].position[ c ];
+		}
+		for( auto & v : vertices ) {
+			for( size_t c=0; c < 3; ++c ) {
+				min_position[ c ]	= std::min( min_position[ c ], v.position[ c ] );
+				max_position[ c ]	= std::max( max_position[ c ], v.position[ c ] );
+			}
+		}
+		for( size_t c=0; c < 3; ++c ) {
+			dequantization->offset[ c ]	= ( min_position[ c ] + max_position[ c ] ) * 0.5f;
+			dequantization->scale[ c ]	= ( max_position[ c ] - min_position[ c ] ) * 0.5f;
+		}
+	}
+
+	bool encoded = VertexLayout_EncodeRange( layout, vertices, 0, vertices.size(), dst, *dequantization );
+	assert( encoded );
+}
+
+bool VertexLayout_EncodeRange( VERTEX_LAYOUT layout, const std::vector<Vertex> & vertices, size_t first_vertex, size_t vertex_count, std::vector<uint8_t> & dst, const VertexDequantization & dequantization )
+{
+	assert( first_vertex + vertex_count <= vertices.size() );
+	assert( vertices.size() * VertexLayout_GetStride( layout ) == dst.size() );
+	if( 0 == vertex_count ) return true;
+
+	switch( layout ) {
+	case VERTEX_LAYOUT::FLOAT32:
+		std::memcpy( dst.data() + first_vertex * sizeof( Vertex ), vertices.data() + first_vertex, vertex_count * sizeof( Vertex ) );
+		break;
+
+	case VERTEX_LAYOUT::COMPACT_HALF:
+	{
+		auto out = reinterpret_cast<VertexCompactHalf*>( dst.data() );
+		for( size_t i=first_vertex; i < first_vertex + vertex_count; ++i ) {
+			auto & src = vertices[ i ];
+			out[ i ].position[ 0 ]	= VertexLayout_FloatToHalf( src.position[ 0 ] );
+			out[ i ].position[ 1 ]	= VertexLayout_FloatToHalf( src.position[ 1 ] );
+			out[ i ].position[ 2 ]	= VertexLayout_FloatToHalf( src.position[ 2 ] );
+			out[ i ].position[ 3 ]	= VertexLayout_FloatToHalf( 1.0f );
+			out[ i ].uv[ 0 ]		= VertexLayout_UVToUnorm16( src.uv[ 0 ] );
+			out[ i ].uv[ 1 ]		= VertexLayout_UVToUnorm16( src.uv[ 1 ] );
+		}
+	}
+		break;
+
+	case VERTEX_LAYOUT::COMPACT_SNORM16:
+	{
+		float inverse_scale[ 3 ];
+		for( size_t c=0; c < 3; ++c ) {
+			inverse_scale[ c ]			= dequantization.scale[ c ] > 0.0f ? 1.0f / dequantization.scale[ c ] : 0.0f;
+		}
+		// moved vertices may have left the box the mesh was quantized in, check before anything is written
+		for( size_t i=first_vertex; i < first_vertex + vertex_count; ++i ) {
+			for( size_t c=0; c < 3; ++c ) {
+				float p			= vertices[ i ].position[ c ];
+				float encoded	= ( p - dequantization.offset[ c ] ) * inverse_scale[ c ];
+				if( std::abs( encoded ) > VERTEX_LAYOUT_SNORM16_LIMIT ) return false;
+				if( 0.0f == inverse_scale[ c ] && p != dequantization.offset[ c ] ) return false;
+			}
+		}
+
+		auto out = reinterpret_cast<VertexCompactSnorm16*>( dst.data() );
+		for( size_t i=first_vertex; i < first_vertex + vertex_count; ++i ) {
+			auto & src = vertices[ i ];
+			for( size_t c=0; c < 3; ++c ) {
+				out[ i ].position[ c ]	= VertexLayout_FloatToSnorm16( ( src.position[ c ] - dequantization.offset[ c ] ) * inverse_scale[ c ] );
+			}
+			out[ i ].position[ 3 ]	= VertexLayout_FloatToSnorm16( 1.0f );
+			out[ i ].uv[ 0 ]		= VertexLayout_UVToUnorm16( src.uv[ 0 ] );
+			out[ i ].uv[ 1 ]		= VertexLayout_UVToUnorm16( src.uv[ 1 ] );
+		}
+	}
+		break;
+
+	default:
+		assert( 0 && "Unknown vertex layout." );
+		break;
+	}
+	return true;
+}
+
+void VertexLayout_Decode( VERTEX_LAYOUT layout, const std::vector<uint8_t> & src, const VertexDequantization & dequantization, std::vector<Vertex> & vertices )
+{
+	size_t stride			= VertexLayout_GetStride( layout );
+	assert( stride > 0 && src.size() % stride == 0 );
+	vertices.resize( src.size() / stride );
+	if( vertices.empty() ) return;
+
+	// the same multiplication ME3D_ShortToFloat does, raw file values come back exactly
+	const float uv_scale	= 1.0f / VERTEX_LAYOUT_SNORM16_MAX;
+	switch( layout ) {
+	case VERTEX_LAYOUT::FLOAT32:
+		std::memcpy( vertices.data(), src.data(), src.size() );
+		break;
+
+	case VERTEX_LAYOUT::COMPACT_HALF:
+	{
+		auto in = reinterpret_cast<const VertexCompactHalf*>( src.data() );
+		for( size_t i=0; i < vertices.size(); ++i ) {
+			auto & dst = vertices[ i ];
+			for( size_t c=0; c < 3; ++c ) {
+				dst.position[ c ]	= VertexLayout_HalfToFloat( in[ i ].position[ c ] );
+				dst.color[ c ]		= 0.5f;
+			}
+			dst.uv[ 0 ]				= uv_scale * in[ i ].uv[ 0 ];
+			dst.uv[ 1 ]				= uv_scale * in[ i ].uv[ 1 ];
+		}
+	}
+		break;
+
+	case VERTEX_LAYOUT::COMPACT_SNORM16:
+	{
+		auto in = reinterpret_cast<const VertexCompactSnorm16*>( src.data() );
+		for( size_t i=0; i < vertices.size(); ++i ) {
+			auto & dst = vertices[ i ];
+			for( size_t c=0; c < 3; ++c ) {
+				float encoded		= std::max( in[ i ].position[ c ] / VERTEX_LAYOUT_SNORM16_MAX, -1.0f );
+				dst.position[ c ]	= dequantization.offset[ c ] + encoded * dequantization.scale[ c ];
+				dst.color[ c ]		= 0.5f;
+			}
+			dst.uv[ 0 ]				= uv_scale * in[ i ].uv[ 0 ];
+			dst.uv[ 1 ]				= uv_scale * in[ i ].uv[ 1 ];
+		}
+	}
+		break;
+
+	default:
+		assert( 0 && "Unknown vertex layout." );
+		break;
+	}
+}
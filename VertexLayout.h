@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct Vertex;
+
+// How vertices are stored in a vertex buffer, pipelines are built for one layout
+// and every object drawn with them has its vertices encoded in that layout.
+enum class VERTEX_LAYOUT
+{
+	FLOAT32,					// Vertex as is, 32 bytes
+	COMPACT_HALF,				// half float position, UNORM16 uv, 12 bytes
+	COMPACT_SNORM16,			// SNORM16 position inside the mesh bounds, UNORM16 uv, 12 bytes
+};
+
+// Color is left out of the compact layouts, meshes loaded from files never have a real one.
+// UVs are the raw 16 bit values of ME3D files, which decode to 0 to 2 and not 0 to 1.
+// As UNORM16 they arrive in shaders as 0 to 1, the compact shaders multiply them
+// by VERTEX_LAYOUT_UV_SCALE to get the decoded UV back.
+constexpr float VERTEX_LAYOUT_UV_SCALE		= 65535.0f / 32767.0f;
+
+struct VertexCompactHalf
+{
+	uint16_t		position[ 4 ];		// w is 1.0
+	uint16_t		uv[ 2 ];
+};
+
+struct VertexCompactSnorm16
+{
+	int16_t			position[ 4 ];		// w is 1.0
+	uint16_t		uv[ 2 ];
+};
+
+// Position = offset + decoded * scale, identity for layouts that store the positions as they are.
+// Meant to be folded into the model matrix so shaders don't need to know about it.
+struct VertexDequantization
+{
+	float			offset[ 3 ]			= { 0.0f, 0.0f, 0.0f };
+	float			scale[ 3 ]			= { 1.0f, 1.0f, 1.0f };
+};
+
+size_t VertexLayout_GetStride( VERTEX_LAYOUT layout );
+
+// lower case names for cooked files and the command line, eg. "compact_snorm16"
+const char * VertexLayout_GetName( VERTEX_LAYOUT layout );
+bool VertexLayout_FromName( const std::string & name, VERTEX_LAYOUT * layout );		// false for unknown names
+
+// Converts vertices into the layout, dst is resized to fit.
+void VertexLayout_Encode( VERTEX_LAYOUT layout, const std::vector<Vertex> & vertices, std::vector<uint8_t> & dst, VertexDequantization * dequantization );
+
+// Re-encodes vertices [first_vertex, first_vertex + vertex_count) in place inside dst from an earlier
+// VertexLayout_Encode. Returns false without writing if a position doesn't fit the dequantization,
+// the whole mesh has to be encoded again then.
+bool VertexLayout_EncodeRange( VERTEX_LAYOUT layout, const std::vector<Vertex> & vertices, size_t first_vertex, size_t vertex_count, std::vector<uint8_t> & dst, const VertexDequantization & dequantization );
+
+// Back to mesh vertices, eg. for cooked files, positions only as precise as the layout keeps them.
+// The compact layouts have no color, it comes back as 0.5 like for every mesh loaded from a file.
+void VertexLayout_Decode( VERTEX_LAYOUT layout, const std::vector<uint8_t> & src, const VertexDequantization & dequantization, std::vector<Vertex> & vertices );
+
+uint16_t VertexLayout_FloatToHalf( float value );
+float VertexLayout_HalfToFloat( uint16_t value );
+uint16_t VertexLayout_UVToUnorm16( float value );		// exact for UVs decoded from ME3D files, clamped to 0 to VERTEX_LAYOUT_UV_SCALE
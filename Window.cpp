@@ -12,6 +12,7 @@ Contributors:
 #include "Window.h"
 #include "Renderer.h"
 #include "Shared.h"
+#include "UniformRing.h"
 
 #include <assert.h>
 #include <array>
@@ -61,6 +62,7 @@ bool Window::Update()
 void Window::BeginRender()
 {
 	ErrorCheck( vkQueueWaitIdle( _renderer->GetVulkanQueue() ) );
+	_renderer->GetObjectUniformRing()->BeginFrame();
 	ErrorCheck( vkAcquireNextImageKHR(
 		_renderer->GetVulkanDevice(),
 		_swapchain,
@@ -11,25 +11,35 @@ Contributors:
 
 #include <array>
 #include <chrono>
+#include <cstdlib>
 #include <iostream>
 
 #include "Shared.h"
+#include "CommandLineTools.h"
 #include "Renderer.h"
+#include "GeometryHeap.h"
 #include "Window.h"
 #include "Pipeline.h"
 #include "Surface_Plain.h"
 #include "Texture.h"
+#include "AssetLoader.h"
+#include "MeshRegistry.h"
 
 #include "Scene.h"
 #include "SceneObject_Camera.h"
 #include "SceneObject_DynamicObject.h"
+#include "SceneObject_InstancedObject.h"
 
 
 constexpr double PI				= 3.14159265358979323846;
 constexpr double CIRCLE_RAD		= PI * 2;
 
-int main()
+int main( int argc, char ** argv )
 {
+	// offline tools like the mesh cooker run without opening a window
+	int tool_exit_code		= 0;
+	if( RunCommandLineTool( argc, argv, &tool_exit_code ) ) return tool_exit_code;
+
 	namespace chrono		= std::chrono;
 	auto timer				= chrono::steady_clock();
 	auto program_start_time	= timer.now();
@@ -38,44 +48,108 @@ int main()
 
 	auto window = renderer.OpenWindow( 1600, 900, "Vulkan API Tutorial series forwards planning project" );
 
-	// textures, can be shared between surfaces
-	Texture logo_diff( &renderer, L"textures/Logo.png" );
-	Texture dragon_head_diff( &renderer, L"textures/DragonHead_diff.png" );
-	Texture monkey_diff( &renderer, L"textures/Monkey_diff.png" );
+	// load textures and meshes in parallel, textures can be shared between surfaces
+	AssetManifest manifest;
+	manifest.meshes		= { "models/BlackDragonHead.me3d", "models/Monkey.me3d" };
+	manifest.textures	= { L"textures/Logo.png", L"textures/DragonHead_diff.png", L"textures/Monkey_diff.png" };
+	manifest.weld_meshes	= true;
+	manifest.generate_lods	= true;
+
+	AssetLoader assets( &renderer );
+	assets.Load( manifest );
+	assets.PrintTimings( std::cout );
+
+	Texture * logo_diff			= assets.GetTexture( L"textures/Logo.png" );
+	Texture * dragon_head_diff	= assets.GetTexture( L"textures/DragonHead_diff.png" );
+	Texture * monkey_diff		= assets.GetTexture( L"textures/Monkey_diff.png" );
 
 	// graphics pipelines, can be shared between surfaces
 	/*	NOTE:	Graphics pipelines don't create descriptor set layouts, instead we provide already existing ones
 				from Renderer object or create new ones ourselves. The amount and types of descriptor sets we use
 				determine compatibility with shaders, cameras, objects, surfaces and other objects we may define in the future.
 				Usual arrangement for a scene object for now is: Camera, Object, Surface. The shader must comply to this.
+				Objects can get their data from push constants instead, the object set stays in the layout so the surface is still set 2.
 	*/
 	GraphicsPipeline plain_pipeline( &renderer, window, {
 		renderer.GetVulkanCameraDescriptorSetLayout(),
 		renderer.GetVulkanObjectDescriptorSetLayout(),
-		renderer.GetVulkanSurfacePlainDescriptorSetLayout() } );
+		renderer.GetVulkanSurfacePlainDescriptorSetLayout() },
+		VERTEX_LAYOUT::FLOAT32,
+		OBJECT_DATA_SOURCE::PUSH_CONSTANTS );
+
+	// same as above but reads 12 byte vertices, loaded models have no vertex colors anyway.
+	// Objects using it are drawn by the scene with indirect draws, their model matrices go to the scene's instance buffer
+	GraphicsPipeline compact_pipeline( &renderer, window, {
+		renderer.GetVulkanCameraDescriptorSetLayout(),
+		renderer.GetVulkanObjectDescriptorSetLayout(),
+		renderer.GetVulkanSurfacePlainDescriptorSetLayout() },
+		VERTEX_LAYOUT::COMPACT_SNORM16,
+		OBJECT_DATA_SOURCE::INSTANCE_BUFFER );
+
+	// many copies of one mesh in one draw, model matrices come from a per instance vertex buffer
+	GraphicsPipeline instanced_pipeline( &renderer, window, {
+		renderer.GetVulkanCameraDescriptorSetLayout(),
+		renderer.GetVulkanObjectDescriptorSetLayout(),
+		renderer.GetVulkanSurfacePlainDescriptorSetLayout() },
+		VERTEX_LAYOUT::FLOAT32,
+		OBJECT_DATA_SOURCE::INSTANCE_BUFFER );
 
 	// surfaces, can NOT be shared between objects, (could be called material)
-	Surface_Plain logo_surface( &renderer, &plain_pipeline, &logo_diff );
-	Surface_Plain dragon_head_surface( &renderer, &plain_pipeline, &dragon_head_diff );
-	Surface_Plain monkey_surface( &renderer, &plain_pipeline, &monkey_diff );
+	Surface_Plain logo_surface( &renderer, &plain_pipeline, logo_diff );
+	Surface_Plain dragon_head_surface( &renderer, &compact_pipeline, dragon_head_diff );
+	Surface_Plain monkey_surface( &renderer, &compact_pipeline, monkey_diff );
+	Surface_Plain debris_surface( &renderer, &instanced_pipeline, logo_diff );
+	Surface_Plain pillar_surface( &renderer, &compact_pipeline, logo_diff );
 
 
 	// camera
 	SceneObject_Camera camera( &renderer );
-	camera.position		= { 0.5, -0.8, -1.0 };
-	camera.rotation		= glm::vec3( -0.5, 0.0, 0.0 );
+	camera.SetPosition( { 0.5, -0.8, -1.0 } );
+	camera.SetRotation( glm::vec3( -0.5, 0.0, 0.0 ) );
+	float camera_fov	= 60.0f;
+	float camera_near	= 0.01f;
+	float camera_far	= 100.0f;
 
 	// scene objects
 	SceneObject_DynamicObject logo_object( &renderer, { &logo_surface }, MESH_OBJECT_SHAPE::PLANE );
-	logo_object.position.x			= -1;
-
-	SceneObject_DynamicObject dragon_head_object( &renderer, { &dragon_head_surface }, "models/BlackDragonHead.me3d" );
-	dragon_head_object.position.x	= 1;
-	dragon_head_object.size			= { 0.15, 0.15, 0.15 };
-
-	SceneObject_DynamicObject monkey_object( &renderer, { &monkey_surface }, "models/Monkey.me3d" );
-	monkey_object.position			= { 0, 0, 0.5 };
-	monkey_object.size				= { 0.35, 0.35, 0.35 };
+	logo_object.SetPosition( { -1, 0, 0 } );
+
+	SceneObject_DynamicObject dragon_head_object( &renderer, { &dragon_head_surface }, assets.TakeMesh( "models/BlackDragonHead.me3d" ) );
+	dragon_head_object.SetPosition( { 1, 0, 0 } );
+	dragon_head_object.SetSize( { 0.15, 0.15, 0.15 } );
+
+	SceneObject_DynamicObject monkey_object( &renderer, { &monkey_surface }, assets.TakeMesh( "models/Monkey.me3d" ) );
+	monkey_object.SetPosition( { 0, 0, 0.5 } );
+	monkey_object.SetSize( { 0.35, 0.35, 0.35 } );
+
+	// a field of small cubes under everything else
+	SceneObject_InstancedObject debris_object( &renderer, { &debris_surface }, MESH_OBJECT_SHAPE::CUBE );
+	debris_object.SetPosition( { 0, 0.5, 0.5 } );
+	for( int z=-32; z < 32; ++z ) {
+		for( int x=-32; x < 32; ++x ) {
+			glm::mat4 transform		= glm::translate( glm::mat4( 1.0f ), glm::vec3( x * 0.08f, 0.0f, z * 0.08f ) );
+			transform				= glm::rotate( transform, float( x * z ), glm::vec3( 0, 1, 0 ) );
+			debris_object.instance_transforms.push_back( glm::scale( transform, glm::vec3( 0.02f ) ) );
+		}
+	}
+	debris_object.MarkInstancesChanged();
+
+	// loaded models are drawn through the scene, it writes their draws into one buffer and binds pipelines and surfaces itself
+	Scene scene( &renderer, SCENE_SUBMISSION_MODE::INDIRECT_CULLED );
+	scene.SetMinProjectedSize( 2.0f );
+	scene.AddObject( &dragon_head_object );
+	scene.AddObject( &monkey_object );
+
+	// a wide field of thin pillars around everything, too many for scene objects of their own
+	auto pillar_mesh	= renderer.GetMeshRegistry()->AcquireShape( MESH_OBJECT_SHAPE::CUBE, compact_pipeline.GetVertexLayout() );
+	for( int z=-100; z < 100; ++z ) {
+		for( int x=-100; x < 100; ++x ) {
+			if( std::abs( x ) < 20 && std::abs( z ) < 20 ) continue;
+			float height	= 0.05f + 0.05f * float( ( x * 7 + z * 13 ) & 7 );
+			scene.AddMeshInstance( &pillar_surface, pillar_mesh, glm::vec3( x * 0.1f, 0.5f - height * 0.5f, z * 0.1f ),
+				glm::quat( 1, 0, 0, 0 ), glm::vec3( 0.01f, height, 0.01f ) );
+		}
+	}
 
 
 	// create command pool and buffer that are used for rendering
@@ -123,7 +197,9 @@ int main()
 			last_time		= timer.now();
 			fps				= frame_counter;
 			frame_counter	= 0;
-			std::cout << "FPS: " << fps << std::endl;
+			auto & culling	= scene.GetCullingStatistics();
+			std::cout << "FPS: " << fps << ", scene objects visible: " << culling.visible
+				<< ", outside the view: " << culling.outside << ", too small: " << culling.too_small << std::endl;
 		}
 
 		// Begin render
@@ -135,6 +211,28 @@ int main()
 		command_buffer_begin_info.flags				= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
 		vkBeginCommandBuffer( command_buffer, &command_buffer_begin_info );
+		renderer.GetGeometryHeap()->ResetBindings();
+
+		// move the camera and modify the objects rotation slightly
+		camera_rotator		+= 0.0055;
+		camera.SetPosition( { float( cos( camera_rotator ) / 2 ), camera.GetPosition().y, camera.GetPosition().z } );
+		rotator += 0.01;
+		logo_object.SetRotation( glm::vec3( 0, rotator, 0 ) );
+		dragon_head_object.SetRotation( glm::vec3( 0, rotator, 0 ) );
+		monkey_object.SetRotation( glm::vec3( 0, rotator, 0 ) );
+		scene.UpdateLogic();
+
+		// use less detail for distant objects and skip the parts of large meshes that are off screen or face away from the camera
+		float pixel_scale			= camera.CalculateProjectedPixelScale( camera_fov, window->GetVulkanSurfaceSize() );
+		glm::mat4 view_projection	= camera.CalculateProjectionMatrix( camera_fov, window->GetVulkanSurfaceSize(), camera_near, camera_far ) * camera.CalculateViewMatrix();
+		dragon_head_object.SelectLOD( camera.GetWorldPosition(), pixel_scale );
+		monkey_object.SelectLOD( camera.GetWorldPosition(), pixel_scale );
+		dragon_head_object.CullClusters( view_projection, camera.GetWorldPosition() );
+		monkey_object.CullClusters( view_projection, camera.GetWorldPosition() );
+
+		// scene objects are culled on the CPU first, compute culling of what's left and of mesh instances runs before the render pass
+		scene.SetCullingView( view_projection, camera.GetWorldPosition(), pixel_scale );
+		scene.CmdCull( command_buffer, view_projection );
 
 		VkRect2D render_area {};
 		render_area.offset.x		= 0;
@@ -160,22 +258,17 @@ int main()
 		vkCmdBeginRenderPass( command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE );
 
 		// update camera data, ubo and descriptor set, because all pipelines use this camera descriptor set we only need to do this once
-		camera_rotator		+= 0.0055;
-		camera.position.x	= cos( camera_rotator ) / 2;
-		camera.CmdUpdateUBOAndBindDescriptorSetsForPipeline( command_buffer, 60.0f, window->GetVulkanSurfaceSize(), 0.01f, 100.0f );
+		camera.CmdUpdateUBOAndBindDescriptorSetsForPipeline( command_buffer, camera_fov, window->GetVulkanSurfaceSize(), camera_near, camera_far );
 
+		// render objects individually, grouped by pipeline
 		vkCmdBindPipeline( command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, plain_pipeline.GetVulkanPipeline() );
+		logo_object.CmdRender( command_buffer );
 
-		// modify the objects rotation slightly
-		rotator += 0.01;
-		logo_object.rotation = glm::vec3( 0, rotator, 0 );
-		dragon_head_object.rotation = glm::vec3( 0, rotator, 0 );
-		monkey_object.rotation = glm::vec3( 0, rotator, 0 );
+		vkCmdBindPipeline( command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, instanced_pipeline.GetVulkanPipeline() );
+		debris_object.CmdRender( command_buffer );
 
-		// render objects individually
-		logo_object.CmdRender( command_buffer );
-		dragon_head_object.CmdRender( command_buffer );
-		monkey_object.CmdRender( command_buffer );
+		// the rest in as few draw calls as the scene can manage
+		scene.CmdRender( command_buffer );
 
 		vkCmdEndRenderPass( command_buffer );
 
@@ -0,0 +1,28 @@
+#version 450
+
+// Variant of compact.vert that gets the model matrix from push constants instead of descriptor set 1.
+// Positions arrive as floats from the vertex input stage, quantized ones are
+// scaled back to object space by the model matrix.
+layout(location=0) in vec3 Vertex_Location;
+layout(location=2) in vec2 Vertex_UV;			// UNORM16 of the raw ME3D value, see VERTEX_LAYOUT_UV_SCALE
+
+layout(set=0, binding=0) uniform ShaderData_Camera
+{
+	mat4 View_Matrix;
+	mat4 Projection_Matrix;
+} shader_data_camera;
+
+layout(push_constant) uniform PushConstants_Object
+{
+	mat4 Model_Matrix;
+} push_constants_object;
+
+layout(location=0) out vec3 Fragment_Color;
+layout(location=1) out vec2 Fragment_UV;
+
+void main()
+{
+	Fragment_Color 	= vec3( 0.5f );
+	Fragment_UV		= Vertex_UV * ( 65535.0f / 32767.0f );
+	gl_Position		= shader_data_camera.Projection_Matrix * shader_data_camera.View_Matrix * push_constants_object.Model_Matrix * vec4( Vertex_Location, 1.0f );
+}